@@ -0,0 +1,95 @@
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include "../CGExam/TexturePack.h"
+
+// Cooks every BMP in a directory into one texture pack that CGExam maps at startup
+//
+//   AssetCooker [inputDir] [outputPack] [--opaque name]... [--uncompressed] [--threads N]
+//
+// Images are color keyed unless listed with --opaque. Textures are block compressed, BC1 for color keyed
+// and opaque sheets and BC3 for anything with partial alpha, unless --uncompressed keeps them RGBA8. Without
+// paths it cooks ../Assets/graphics into ../Assets/cooked/graphics.pack, keeping galaxy2 opaque unless
+// --opaque names others.
+int main(int argc, char* args[]) {
+	std::string inputDir = "../Assets/graphics";
+	std::string outputPath = "../Assets/cooked/graphics.pack";
+	std::vector<std::string> opaque;
+	bool compress = true;
+	int threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(args[i], "--opaque") == 0 && i + 1 < argc)
+			opaque.push_back(args[++i]);
+		else if (std::strcmp(args[i], "--uncompressed") == 0)
+			compress = false;
+		else if (std::strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+			threads = std::max(1, std::atoi(args[++i]));
+		else
+			positional.push_back(args[i]);
+	}
+	if (positional.size() > 0)
+		inputDir = positional[0];
+	if (positional.size() > 1)
+		outputPath = positional[1];
+	if (positional.empty() && opaque.empty())
+		opaque.push_back("galaxy2");
+
+	// Sorted so the pack is byte for byte reproducible
+	std::vector<std::string> filepaths;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(inputDir, error)) {
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (entry.is_regular_file() && extension == ".bmp")
+			filepaths.push_back(entry.path().string());
+	}
+	if (error || filepaths.empty()) {
+		std::cerr << "No BMP files found in " << inputDir << std::endl;
+		return 1;
+	}
+	std::sort(filepaths.begin(), filepaths.end());
+
+	std::vector<bool> keyed;
+	for (const std::string& filepath : filepaths) {
+		std::string name = packTextureName(filepath.c_str());
+		keyed.push_back(std::find(opaque.begin(), opaque.end(), name) == opaque.end());
+	}
+
+	std::filesystem::path output(outputPath);
+	if (output.has_parent_path())
+		std::filesystem::create_directories(output.parent_path(), error);
+
+	glm::vec3 colorKey(255, 0, 255);
+	std::vector<CookedTextureStats> stats;
+	if (!cookTexturePack(filepaths, keyed, colorKey, outputPath.c_str(), compress, threads, &stats)) {
+		std::cerr << "Failed to cook " << outputPath << std::endl;
+		return 1;
+	}
+
+	// Level 0 quality of each sheet and what the chains cost in VRAM against RGBA8
+	size_t rgbaBytes = 0, bytes = 0;
+	std::cout << std::fixed << std::setprecision(2);
+	for (const CookedTextureStats& texture : stats) {
+		rgbaBytes += texture.rgbaBytes;
+		bytes += texture.bytes;
+		if (!compress)
+			continue;
+		std::cout << "  " << std::left << std::setw(18) << texture.name << std::right << std::setw(6) << textureFormatName(texture.format)
+			<< std::setw(6) << texture.width << "x" << std::left << std::setw(6) << texture.height << std::right
+			<< std::setw(8) << texture.psnr << " dB" << std::setw(10) << texture.rgbaBytes / 1024.0 << " KB ->"
+			<< std::setw(9) << texture.bytes / 1024.0 << " KB" << std::endl;
+	}
+	std::cout << "Cooked " << filepaths.size() << " textures into " << outputPath << ", " << bytes / (1024.0 * 1024.0) << " MB with mips";
+	if (compress)
+		std::cout << " (" << rgbaBytes / (1024.0 * 1024.0) << " MB as RGBA8, " << (double)rgbaBytes / bytes << "x smaller)";
+	std::cout << std::endl;
+	return 0;
+}
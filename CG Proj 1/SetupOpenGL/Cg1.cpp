@@ -9,15 +9,16 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include "../../CGExam/FrameScheduler.h"
+#include "../../CGExam/Headless.h"
 
 // Camera settings
 glm::vec3 cameraPos = glm::vec3(0.0f, 1.0f, 1.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.5f, 0.0f);
 
-float deltaTime = 0.0f;
-float lastFrameTime = SDL_GetTicks();
-
 float lastX = 400, lastY = 300;
 float pitch = 0.f;
 float yaw = -90.f;
@@ -186,14 +187,30 @@ GLuint loadTexture(const char* path)
 
 int main(int argc, char** argv)
 {
-	SDL_Init(SDL_INIT_VIDEO);
+	double tickRate = 120.0;
+	bool frameStats = false;
+	HeadlessRun headless = HeadlessRun();
+	for (int i = 1; i < argc; ++i)
+	{
+		if (parseHeadlessArg(headless, argc, argv, i))
+			continue;
+		if (std::strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+			tickRate = glm::max(1.0, std::atof(argv[++i]));
+		else if (std::strcmp(argv[i], "--frame-stats") == 0)
+			frameStats = true;
+	}
+
+	if (headless.frames > 0)
+		initHeadlessVideo();
+	else
+		SDL_Init(SDL_INIT_VIDEO);
 
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
 	SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
 
-	window = SDL_CreateWindow("Computer Graphics Project 1", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_OPENGL);
+	window = SDL_CreateWindow("Computer Graphics Project 1", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, screenWidth, screenHeight, SDL_WINDOW_OPENGL | (headless.frames > 0 ? SDL_WINDOW_HIDDEN : 0));
 	if (!window)
 	{
 		std::cerr << "Failed to create SDL Window" << std::endl;
@@ -210,6 +227,13 @@ int main(int argc, char** argv)
 		return -2;
 	}
 
+	// Headless runs draw everything into an FBO instead of the hidden window
+	if (headless.frames > 0 && !beginHeadlessRun(headless, (int)screenWidth, (int)screenHeight, true))
+	{
+		SDL_Quit();
+		return -3;
+	}
+
 	SDL_SetRelativeMouseMode(SDL_TRUE);
 
 	std::vector<glm::vec4> vertices;
@@ -417,13 +441,18 @@ int main(int argc, char** argv)
 	glClearColor(0.2f, 0.5f, 0.3f, 1.0f);
 	glEnable(GL_DEPTH_TEST);
 
+	// Movement runs at a fixed tick rate, the camera is drawn between the last two ticks
+	FrameScheduler scheduler;
+	initFrameScheduler(scheduler, tickRate);
+	if (headless.frames > 0)
+		setFixedTicksPerFrame(scheduler, 1);
+	glm::vec3 previousCameraPos = cameraPos;
+
 	bool gameIsRunning = true;
 	SDL_Event windowEvent;
 	while (gameIsRunning)
 	{
-		int now = SDL_GetTicks();
-		deltaTime = (now - lastFrameTime) / 1000.0f;
-		lastFrameTime = now;
+		int ticks = beginFrame(scheduler);
 
 		while (SDL_PollEvent(&windowEvent) != 0)
 		{
@@ -432,9 +461,17 @@ int main(int argc, char** argv)
 
 			processMouse(windowEvent);
 		}
-		processKeyboard(deltaTime);
+		endPhase(scheduler, FRAME_PHASE_INPUT);
 
-		glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+		for (int tick = 0; tick < ticks; ++tick)
+		{
+			previousCameraPos = cameraPos;
+			processKeyboard(tickDelta(scheduler));
+		}
+		endPhase(scheduler, FRAME_PHASE_UPDATE);
+
+		glm::vec3 renderCameraPos = glm::mix(previousCameraPos, cameraPos, interpolationAlpha(scheduler));
+		glm::mat4 view = glm::lookAt(renderCameraPos, renderCameraPos + cameraFront, cameraUp);
 		glUniformMatrix4fv(viewLocation, 1, GL_FALSE, glm::value_ptr(view));
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -462,7 +499,25 @@ int main(int argc, char** argv)
 		glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
 		glDrawElements(GL_TRIANGLES, floorIndices.size(), GL_UNSIGNED_INT, 0);
 
-		SDL_GL_SwapWindow(window);
+		endPhase(scheduler, FRAME_PHASE_RENDER);
+
+		if (headless.frames > 0)
+			gameIsRunning = finishHeadlessFrame(headless, scheduler.lastFrame) && gameIsRunning;
+		else
+			SDL_GL_SwapWindow(window);
+		endPhase(scheduler, FRAME_PHASE_PRESENT);
+
+		FrameReport report;
+		if (frameStats && takeFrameReport(scheduler, report))
+			printFrameReport(report);
+	}
+
+	if (headless.frames > 0)
+	{
+		FrameReport report;
+		if (takeFrameReport(scheduler, report, 0.0))
+			printFrameReport(report);
+		endHeadlessRun(headless);
 	}
 
 	SDL_GL_DeleteContext(context);
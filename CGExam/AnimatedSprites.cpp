@@ -0,0 +1,183 @@
+#include "AnimatedSprites.h"
+#include <cstddef>
+
+// Same frame math as the animation store: the frame is how many whole durations have passed since the
+// start, wrapped to the sheet. The rect is then cut from the sheet rect with rows counted from the top.
+static const char* animatedVertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
+    layout (location = 0) in vec2 position;
+    layout (location = 1) in vec2 texCoord;
+    layout (location = 2) in vec4 instanceRect;
+    layout (location = 3) in vec4 instanceSheet;
+    layout (location = 4) in vec4 instanceTiming;  // startTime, frameDuration, columns, rows
+    out vec2 TexCoord;
+    uniform float time;
+    void main() {
+        float frameCount = instanceTiming.z * instanceTiming.w;
+        float frame = mod(floor((time - instanceTiming.x) / instanceTiming.y), frameCount);
+        float column = mod(frame, instanceTiming.z);
+        float row = floor(frame / instanceTiming.z);
+        vec2 frameSize = (instanceSheet.zw - instanceSheet.xy) / instanceTiming.zw;
+        vec2 frameMin = vec2(instanceSheet.x + column * frameSize.x, instanceSheet.w - (row + 1.0) * frameSize.y);
+        TexCoord = frameMin + texCoord * frameSize;
+        gl_Position = projection * view * vec4(instanceRect.xy + position * instanceRect.zw, 0.0, 1.0);
+    })";
+
+static const char* animatedFragmentShaderSource = R"(#version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    void main() {
+        FragColor = texture(texture1, TexCoord);
+    })";
+
+// Point the instance attributes at the first instance of a group
+static void setInstanceAttributes(size_t firstInstance) {
+	const char* base = (const char*)(firstInstance * sizeof(AnimatedSpriteInstance));
+	GLsizei stride = sizeof(AnimatedSpriteInstance);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AnimatedSpriteInstance, x)));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AnimatedSpriteInstance, u0)));
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(AnimatedSpriteInstance, startTime)));
+}
+
+bool initAnimatedSpriteLayer(AnimatedSpriteLayer& layer) {
+	if (!createShaderProgram(layer.program, animatedVertexShaderSource, animatedFragmentShaderSource))
+		return false;
+	layer.timeLocation = uniformLocation(layer.program, "time");
+
+	float vertices[] = {
+		// Positions       // Texture Coords
+		-0.5f, -0.5f,     0.0f, 0.0f,  // Bottom-Left
+		 0.5f, -0.5f,     1.0f, 0.0f,  // Bottom-Right
+		 0.5f,  0.5f,     1.0f, 1.0f,  // Top-Right
+		-0.5f,  0.5f,     0.0f, 1.0f   // Top-Left
+	};
+	unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+	glGenVertexArrays(1, &layer.VAO);
+	glGenBuffers(1, &layer.VBO);
+	glGenBuffers(1, &layer.EBO);
+	glGenBuffers(1, &layer.instanceVBO);
+
+	glBindVertexArray(layer.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layer.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, layer.instanceVBO);
+	setInstanceAttributes(0);
+	for (GLuint attribute = 2; attribute <= 4; ++attribute) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	layer.dirty = false;
+	layer.stats = AnimatedSpriteStats();
+	return true;
+}
+
+void destroyAnimatedSpriteLayer(AnimatedSpriteLayer& layer) {
+	glDeleteVertexArrays(1, &layer.VAO);
+	glDeleteBuffers(1, &layer.VBO);
+	glDeleteBuffers(1, &layer.EBO);
+	glDeleteBuffers(1, &layer.instanceVBO);
+	destroyShaderProgram(layer.program);
+}
+
+void addAnimatedSprite(AnimatedSpriteLayer& layer, const SpriteAnimation& animation, float now) {
+	AnimatedSpriteInstance instance;
+	instance.x = animation.x;
+	instance.y = animation.y;
+	instance.width = animation.width;
+	instance.height = animation.height;
+	instance.u0 = animation.uvRect.x;
+	instance.v0 = animation.uvRect.y;
+	instance.u1 = animation.uvRect.z;
+	instance.v1 = animation.uvRect.w;
+	// Back-date the start so the sprite carries on from the frame it is in
+	instance.startTime = now - (animation.currentFrame * animation.frameDuration + animation.elapsedTime);
+	instance.frameDuration = animation.frameDuration;
+	instance.columns = (float)animation.columns;
+	instance.rows = (float)animation.rows;
+
+	layer.instances.push_back(instance);
+	layer.instanceTextures.push_back(animation.textureID);
+	layer.dirty = true;
+}
+
+void clearAnimatedSprites(AnimatedSpriteLayer& layer) {
+	layer.instances.clear();
+	layer.instanceTextures.clear();
+	layer.dirty = true;
+}
+
+// Group the instances by texture, keeping the order they were added in inside each group, and upload them
+static void uploadAnimatedSprites(AnimatedSpriteLayer& layer) {
+	layer.groupTextures.clear();
+	std::vector<int> groupOf(layer.instances.size());
+	for (size_t i = 0; i < layer.instances.size(); ++i) {
+		size_t group = 0;
+		while (group < layer.groupTextures.size() && layer.groupTextures[group] != layer.instanceTextures[i])
+			++group;
+		if (group == layer.groupTextures.size())
+			layer.groupTextures.push_back(layer.instanceTextures[i]);
+		groupOf[i] = (int)group;
+	}
+
+	size_t groupCount = layer.groupTextures.size();
+	layer.groupStarts.assign(groupCount + 1, 0);
+	for (int group : groupOf)
+		layer.groupStarts[group + 1]++;
+	for (size_t i = 1; i <= groupCount; ++i)
+		layer.groupStarts[i] += layer.groupStarts[i - 1];
+
+	std::vector<AnimatedSpriteInstance> sorted(layer.instances.size());
+	std::vector<int> cursor(layer.groupStarts.begin(), layer.groupStarts.end() - 1);
+	for (size_t i = 0; i < layer.instances.size(); ++i)
+		sorted[cursor[groupOf[i]]++] = layer.instances[i];
+
+	size_t bytes = sorted.size() * sizeof(AnimatedSpriteInstance);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, bytes, sorted.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	layer.stats.bytesUploaded = bytes;
+	layer.dirty = false;
+}
+
+void drawAnimatedSprites(AnimatedSpriteLayer& layer, float time) {
+	layer.stats = AnimatedSpriteStats();
+	if (layer.dirty)
+		uploadAnimatedSprites(layer);
+	if (layer.instances.empty())
+		return;
+
+	if (useShaderProgram(layer.program))
+		layer.stats.stateChanges++;
+	glUniform1f(layer.timeLocation, time);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(layer.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, layer.instanceVBO);
+	layer.stats.stateChanges += 3;  // Time, instance buffer and VAO
+
+	for (size_t group = 0; group < layer.groupTextures.size(); ++group) {
+		int first = layer.groupStarts[group];
+		setInstanceAttributes(first);
+		glBindTexture(GL_TEXTURE_2D, layer.groupTextures[group]);
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, layer.groupStarts[group + 1] - first);
+		layer.stats.drawCalls++;
+		layer.stats.stateChanges += 3;
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	layer.stats.sprites = (int)layer.instances.size();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include "ShaderProgram.h"
+#include "SpriteAnimation.h"
+
+// Per-instance data of a sprite whose frame the vertex shader works out from the time uniform
+struct AnimatedSpriteInstance {
+	float x, y;             // Center of the sprite
+	float width, height;    // Size of the sprite
+	float u0, v0, u1, v1;   // Rect of the whole sheet in the texture
+	float startTime;        // Time at which frame 0 started showing
+	float frameDuration;    // Must be > 0
+	float columns, rows;    // Frame grid of the sheet
+};
+
+// Counters for the last drawn frame
+struct AnimatedSpriteStats {
+	int sprites;
+	int drawCalls;
+	int stateChanges;      // Program, time uniform, buffer, VAO, texture and attribute pointer changes
+	size_t bytesUploaded;  // Only non-zero on the frame after sprites were added
+};
+
+// Sprites that never move once spawned. They are uploaded once, grouped by texture, and every frame
+// after that is one uniform and one instanced draw per texture with no CPU work per sprite.
+struct AnimatedSpriteLayer {
+	ShaderProgram program;
+	GLuint VAO, VBO, EBO, instanceVBO;
+	GLint timeLocation;
+
+	std::vector<AnimatedSpriteInstance> instances;  // In the order they were added
+	std::vector<GLuint> instanceTextures;           // Texture of each instance
+	std::vector<GLuint> groupTextures;              // Texture of each group in the uploaded buffer
+	std::vector<int> groupStarts;                   // Group i is [groupStarts[i], groupStarts[i + 1])
+	bool dirty;                                     // Instances changed since the last upload
+
+	AnimatedSpriteStats stats;
+};
+
+// Create the shader, quad and instance buffer
+bool initAnimatedSpriteLayer(AnimatedSpriteLayer& layer);
+
+// Release the GL objects owned by the layer
+void destroyAnimatedSpriteLayer(AnimatedSpriteLayer& layer);
+
+// Add a sprite in its current frame at time now, the layer is reuploaded on the next draw
+void addAnimatedSprite(AnimatedSpriteLayer& layer, const SpriteAnimation& animation, float now);
+
+// Remove every sprite
+void clearAnimatedSprites(AnimatedSpriteLayer& layer);
+
+// Draw every sprite as it looks at time, uploading first if sprites were added
+void drawAnimatedSprites(AnimatedSpriteLayer& layer, float time);
@@ -0,0 +1,103 @@
+#include "AnimationStore.h"
+#include <cmath>
+#include "CpuFeatures.h"
+
+int addAnimation(AnimationStore& store, int frameCount, float frameDuration, int currentFrame) {
+	store.elapsedTime.push_back(0.0f);
+	store.frameDuration.push_back(frameDuration);
+	store.currentFrame.push_back(currentFrame);
+	store.frameCount.push_back(frameCount);
+	return (int)store.frameCount.size() - 1;
+}
+
+int addAnimation(AnimationStore& store, const SpriteAnimation& animation) {
+	int index = addAnimation(store, animation.frameCount, animation.frameDuration, animation.currentFrame);
+	store.elapsedTime[index] = animation.elapsedTime;
+	return index;
+}
+
+// Frame arithmetic is done in float so the SIMD kernel needs no integer division;
+// frame counts and indices are far below 2^24, where float integers are exact
+static void updateAnimationsScalar(float* elapsedTime, const float* frameDuration, int* currentFrame, const int* frameCount,
+	size_t count, float deltaTime) {
+	for (size_t i = 0; i < count; ++i) {
+		float elapsed = elapsedTime[i] + deltaTime;
+		// Most ticks stay inside the current frame
+		if (elapsed < frameDuration[i] && elapsed >= 0.0f) {
+			elapsedTime[i] = elapsed;
+			continue;
+		}
+		float steps = std::floor(elapsed / frameDuration[i]);
+		elapsed = std::fmax(elapsed - steps * frameDuration[i], 0.0f);
+
+		float frames = (float)frameCount[i];
+		float frame = (float)currentFrame[i] + steps;
+		frame -= std::floor(frame / frames) * frames;
+		// The division can round across a multiple, pull the frame back into range
+		if (frame >= frames)
+			frame -= frames;
+		if (frame < 0.0f)
+			frame += frames;
+
+		elapsedTime[i] = elapsed;
+		currentFrame[i] = (int)frame;
+	}
+}
+
+#ifdef CPU_X86
+
+// Same arithmetic as the scalar kernel on 8 animations per step. It has no early out, but an elapsed time under
+// the duration divides to less than 1.0 and floors to 0 steps, so both give identical results
+TARGET_AVX2 static void updateAnimationsAVX2(float* elapsedTime, const float* frameDuration, int* currentFrame, const int* frameCount,
+	size_t count, float deltaTime) {
+	const __m256 delta = _mm256_set1_ps(deltaTime);
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 duration = _mm256_loadu_ps(frameDuration + i);
+		__m256 elapsed = _mm256_add_ps(_mm256_loadu_ps(elapsedTime + i), delta);
+		__m256 steps = _mm256_floor_ps(_mm256_div_ps(elapsed, duration));
+		elapsed = _mm256_max_ps(_mm256_sub_ps(elapsed, _mm256_mul_ps(steps, duration)), zero);
+
+		__m256 frames = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(frameCount + i)));
+		__m256 frame = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(currentFrame + i))), steps);
+		frame = _mm256_sub_ps(frame, _mm256_mul_ps(_mm256_floor_ps(_mm256_div_ps(frame, frames)), frames));
+		frame = _mm256_sub_ps(frame, _mm256_and_ps(_mm256_cmp_ps(frame, frames, _CMP_GE_OQ), frames));
+		frame = _mm256_add_ps(frame, _mm256_and_ps(_mm256_cmp_ps(frame, zero, _CMP_LT_OQ), frames));
+
+		_mm256_storeu_ps(elapsedTime + i, elapsed);
+		_mm256_storeu_si256((__m256i*)(currentFrame + i), _mm256_cvttps_epi32(frame));
+	}
+	updateAnimationsScalar(elapsedTime + i, frameDuration + i, currentFrame + i, frameCount + i, count - i, deltaTime);
+}
+
+#endif
+
+AnimationKernel bestAnimationKernel() {
+	return cpuHasAVX2() ? ANIMATION_KERNEL_AVX2 : ANIMATION_KERNEL_SCALAR;
+}
+
+const char* animationKernelName(AnimationKernel kernel) {
+	return (kernel == ANIMATION_KERNEL_BEST ? bestAnimationKernel() : kernel) == ANIMATION_KERNEL_AVX2 ? "AVX2" : "scalar";
+}
+
+void updateAnimations(AnimationStore& store, float deltaTime, AnimationKernel kernel) {
+	updateAnimationRange(store, 0, store.frameCount.size(), deltaTime, kernel);
+}
+
+void updateAnimationRange(AnimationStore& store, size_t begin, size_t end, float deltaTime, AnimationKernel kernel) {
+	size_t count = end - begin;
+	if (kernel == ANIMATION_KERNEL_BEST)
+		kernel = bestAnimationKernel();
+#ifdef CPU_X86
+	// Never run a kernel the CPU can't execute, even if asked for it
+	if (kernel == ANIMATION_KERNEL_AVX2 && cpuHasAVX2()) {
+		updateAnimationsAVX2(store.elapsedTime.data() + begin, store.frameDuration.data() + begin, store.currentFrame.data() + begin,
+			store.frameCount.data() + begin, count, deltaTime);
+		return;
+	}
+#endif
+	updateAnimationsScalar(store.elapsedTime.data() + begin, store.frameDuration.data() + begin, store.currentFrame.data() + begin,
+		store.frameCount.data() + begin, count, deltaTime);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "SpriteAnimation.h"
+
+// Implementations of the animation tick, picked at runtime from what the CPU supports
+enum AnimationKernel {
+	ANIMATION_KERNEL_SCALAR,
+	ANIMATION_KERNEL_AVX2,
+	ANIMATION_KERNEL_BEST
+};
+
+// Timing state of many animations, one contiguous array per field so the tick streams through memory
+struct AnimationStore {
+	std::vector<float> elapsedTime;
+	std::vector<float> frameDuration;  // Must be > 0
+	std::vector<int> currentFrame;
+	std::vector<int> frameCount;
+};
+
+// Append an animation and return its index
+int addAnimation(AnimationStore& store, int frameCount, float frameDuration, int currentFrame = 0);
+
+// Append the timing state of a sprite animation and return its index
+int addAnimation(AnimationStore& store, const SpriteAnimation& animation);
+
+// Best kernel this CPU can run
+AnimationKernel bestAnimationKernel();
+
+// Printable name of a kernel
+const char* animationKernelName(AnimationKernel kernel);
+
+// Advance every animation by deltaTime. Frames skipped by a long delta are counted and the
+// leftover time is kept, so the result doesn't depend on how the time was split into ticks.
+void updateAnimations(AnimationStore& store, float deltaTime, AnimationKernel kernel = ANIMATION_KERNEL_BEST);
+
+// Advance animations [begin, end) only, so separate ranges can be ticked on separate threads
+void updateAnimationRange(AnimationStore& store, size_t begin, size_t end, float deltaTime, AnimationKernel kernel = ANIMATION_KERNEL_BEST);
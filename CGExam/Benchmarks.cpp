@@ -0,0 +1,1246 @@
+#include "Benchmarks.h"
+#include "GLUtils.h"
+#include "Image.h"
+#include "BmpDecoder.h"
+#include "AnimationStore.h"
+#include "Quadtree.h"
+#include "Particles.h"
+#include "Broadphase.h"
+#include "CollisionMask.h"
+#include "ObjectPool.h"
+#include "Ecs.h"
+#include "SceneSystems.h"
+#include "JobSystem.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include <thread>
+#include <SDL.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+
+// Seconds elapsed since a performance counter value
+static double secondsSince(Uint64 start) {
+	return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+// Copies of the template animations scattered over the screen
+static std::vector<SpriteAnimation> spawnSprites(const std::vector<SpriteAnimation>& templates, size_t count, std::vector<int>* picks = NULL) {
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> posX(-400.0f, 400.0f);
+	std::uniform_real_distribution<float> posY(-300.0f, 300.0f);
+	std::uniform_int_distribution<size_t> pick(0, templates.size() - 1);
+
+	std::vector<SpriteAnimation> sprites;
+	sprites.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		size_t picked = pick(rng);
+		if (picks)
+			picks->push_back((int)picked);
+		SpriteAnimation sprite = templates[picked];
+		sprite.x = posX(rng);
+		sprite.y = posY(rng);
+		storePreviousPosition(sprite);
+		sprite.currentFrame = (int)(i % sprite.frameCount);
+		sprites.push_back(sprite);
+	}
+	return sprites;
+}
+
+// CPU side of a sprite frame: advance the animations, then cull each sprite against the view and write its
+// instance and key into space reserved in the batch. Split into jobs of SPRITE_FRAME_GRAIN sprites, the
+// fill jobs held back until every animation job is done.
+const size_t SPRITE_FRAME_GRAIN = 16384;
+
+struct SpriteFrame {
+	std::vector<SpriteAnimation>* sprites;
+	AnimationStore* times;
+	std::vector<GLuint> textures;  // Batch slot of each texture
+	std::vector<uint64_t> keys;    // Render key of each sprite, with those slots
+	glm::vec4 view;                // minX, minY, maxX, maxY
+	float deltaTime;
+
+	SpriteInstance* instances;
+	uint64_t* reservedKeys;
+};
+
+static void animateSpriteRange(void* context, size_t begin, size_t end) {
+	SpriteFrame& frame = *(SpriteFrame*)context;
+	updateAnimationRange(*frame.times, begin, end, frame.deltaTime);
+}
+
+static void fillSpriteRange(void* context, size_t begin, size_t end) {
+	SpriteFrame& frame = *(SpriteFrame*)context;
+	for (size_t i = begin; i < end; ++i) {
+		SpriteAnimation& sprite = (*frame.sprites)[i];
+		if (sprite.x + sprite.width * 0.5f < frame.view.x || sprite.x - sprite.width * 0.5f > frame.view.z
+			|| sprite.y + sprite.height * 0.5f < frame.view.y || sprite.y - sprite.height * 0.5f > frame.view.w) {
+			frame.reservedKeys[i] = RENDER_KEY_CULLED;
+			continue;
+		}
+		sprite.currentFrame = frame.times->currentFrame[i];
+		glm::vec4 uv = getFrameUV(sprite);
+		frame.instances[i] = { sprite.x, sprite.y, sprite.width, sprite.height, uv.x, uv.y, uv.z, uv.w };
+		frame.reservedKeys[i] = frame.keys[i];
+	}
+}
+
+// Queue the whole frame into a begun batch, returns once every sprite is written
+static void buildSpriteFrame(JobSystem& jobs, SpriteFrame& frame, SpriteBatch& batch) {
+	for (GLuint texture : frame.textures)
+		spriteTextureSlot(batch, texture);
+	size_t count = frame.sprites->size();
+	reserveSprites(batch, count, frame.instances, frame.reservedKeys);
+
+	JobCounter animated, filled;
+	std::vector<Job> animateJobs, fillJobs;
+	for (size_t begin = 0; begin < count; begin += SPRITE_FRAME_GRAIN) {
+		size_t end = std::min(count, begin + SPRITE_FRAME_GRAIN);
+		animateJobs.push_back({ animateSpriteRange, &frame, begin, end, &animated });
+		fillJobs.push_back({ fillSpriteRange, &frame, begin, end, &filled });
+	}
+	submitJobs(jobs, animateJobs.data(), animateJobs.size());
+	submitJobs(jobs, fillJobs.data(), fillJobs.size(), &animated);
+	waitForCounter(jobs, filled);
+}
+
+// Textures of the templates in order, each once
+static std::vector<GLuint> templateTextures(const std::vector<SpriteAnimation>& templates) {
+	std::vector<GLuint> textures;
+	for (const SpriteAnimation& anim : templates) {
+		if (std::find(textures.begin(), textures.end(), anim.textureID) == textures.end())
+			textures.push_back(anim.textureID);
+	}
+	return textures;
+}
+
+// Odd templates stand in for glowing effects, drawn additive over the world
+static uint64_t templateKey(const std::vector<SpriteAnimation>& templates, const std::vector<GLuint>& textures, int pick) {
+	unsigned short slot = (unsigned short)(std::find(textures.begin(), textures.end(), templates[pick].textureID) - textures.begin());
+	return pick % 2 ? spriteKey(slot, RENDER_LAYER_EFFECTS, BLEND_ADDITIVE) : spriteKey(slot, RENDER_LAYER_WORLD, BLEND_ALPHA);
+}
+
+// Frame over sprites spawned from the templates
+static SpriteFrame makeSpriteFrame(std::vector<SpriteAnimation>& sprites, AnimationStore& times, const std::vector<SpriteAnimation>& templates,
+	const std::vector<int>& picks, const glm::vec4& view, float deltaTime) {
+	SpriteFrame frame = SpriteFrame();
+	frame.sprites = &sprites;
+	frame.times = &times;
+	frame.textures = templateTextures(templates);
+	for (int pick : picks)
+		frame.keys.push_back(templateKey(templates, frame.textures, pick));
+	frame.view = view;
+	frame.deltaTime = deltaTime;
+	return frame;
+}
+
+void runSpriteBatchBenchmark(SpriteBatch& batch, const ShaderProgram& shaderProgram, GLuint VAO, GLuint VBO, float* vertices, size_t verticesSize,
+	const std::vector<SpriteAnimation>& templates) {
+	// Skip the full screen rock sheets, they would turn this into a fill rate test
+	std::vector<SpriteAnimation> actors;
+	for (const SpriteAnimation& anim : templates) {
+		if (anim.width <= 128.0f && anim.height <= 128.0f)
+			actors.push_back(anim);
+	}
+	if (actors.empty())
+		return;
+
+	const float deltaTime = 1.0f / 60.0f;
+	const size_t counts[] = { 1000, 10000, 100000 };
+
+	std::cout << std::left << std::setw(10) << "sprites" << std::setw(12) << "path" << std::setw(10) << "frames"
+		<< std::setw(14) << "draws/frame" << "ms/frame" << std::endl;
+
+	for (size_t count : counts) {
+		std::vector<SpriteAnimation> sprites = spawnSprites(actors, count);
+
+		// Keep the per-sprite path to roughly 200k draws per run
+		int legacyFrames = (int)std::min<size_t>(60, std::max<size_t>(3, 200000 / count));
+		glFinish();
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < legacyFrames; ++frame) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			for (auto& anim : sprites) {
+				updateSpriteAnimation(anim, deltaTime);
+				updateTextureCoords(anim, vertices);
+
+				glBindBuffer(GL_ARRAY_BUFFER, VBO);
+				glBufferData(GL_ARRAY_BUFFER, verticesSize, vertices, GL_STATIC_DRAW);
+
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(anim.x, anim.y, 0.0f));
+				model = glm::scale(model, glm::vec3(anim.width, anim.height, 1.0f));
+				renderObject(VAO, anim.textureID, model, shaderProgram);
+			}
+			glFinish();
+		}
+		double legacyMs = secondsSince(start) * 1000.0 / legacyFrames;
+
+		const int batchFrames = 60;
+		int batchDraws = 0;
+		glFinish();
+		start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < batchFrames; ++frame) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			beginSpriteBatch(batch);
+			for (auto& anim : sprites) {
+				updateSpriteAnimation(anim, deltaTime);
+				glm::vec4 uv = getFrameUV(anim);
+				drawSprite(batch, anim.textureID, { anim.x, anim.y, anim.width, anim.height, uv.x, uv.y, uv.z, uv.w });
+			}
+			endSpriteBatch(batch);
+			batchDraws = batch.stats.drawCalls;
+			glFinish();
+		}
+		double batchMs = secondsSince(start) * 1000.0 / batchFrames;
+
+		std::cout << std::setw(10) << count << std::setw(12) << "per-sprite" << std::setw(10) << legacyFrames
+			<< std::setw(14) << count << std::fixed << std::setprecision(3) << legacyMs << std::endl;
+		std::cout << std::setw(10) << count << std::setw(12) << "batched" << std::setw(10) << batchFrames
+			<< std::setw(14) << batchDraws << batchMs << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+void runStartupBenchmark(const TexturePack& pack, const char* sourceDir, const glm::vec3& colorKey) {
+	if (pack.textureCount == 0) {
+		std::cout << "Startup benchmark needs a cooked texture pack, run AssetCooker first" << std::endl;
+		return;
+	}
+
+	const int runs = 5;
+	std::vector<GLuint> textures(pack.textureCount);
+	double decodeSeconds = 0.0, cookedSeconds = 0.0;
+	size_t uploadedBytes = 0;
+
+	for (int run = 0; run < runs; ++run) {
+		// Source path: stb_image decode, color key loop and glGenerateMipmap
+		glFinish();
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (uint32_t i = 0; i < pack.textureCount; ++i) {
+			std::string filepath = std::string(sourceDir) + "/" + pack.textures[i].name + ".bmp";
+			textures[i] = loadTexture(filepath.c_str(), colorKey, pack.textures[i].keyed != 0);
+		}
+		glFinish();
+		decodeSeconds += secondsSince(start);
+		glDeleteTextures((GLsizei)textures.size(), textures.data());
+
+		// Cooked path: mip levels straight from the mapped file
+		start = SDL_GetPerformanceCounter();
+		for (uint32_t i = 0; i < pack.textureCount; ++i)
+			textures[i] = createPackedTexture(pack, pack.textures[i]);
+		glFinish();
+		cookedSeconds += secondsSince(start);
+		glDeleteTextures((GLsizei)textures.size(), textures.data());
+	}
+
+	for (uint32_t i = 0; i < pack.textureCount; ++i)
+		uploadedBytes += (size_t)pack.textures[i].dataSize;
+
+	double decodeMs = decodeSeconds * 1000.0 / runs;
+	double cookedMs = cookedSeconds * 1000.0 / runs;
+	std::cout << std::fixed << std::setprecision(2)
+		<< "Startup textures: " << pack.textureCount << " images, " << uploadedBytes / (1024.0 * 1024.0) << " MB with mips" << std::endl
+		<< "  decode + key + glGenerateMipmap: " << decodeMs << " ms" << std::endl
+		<< "  cooked pack upload:              " << cookedMs << " ms (" << decodeMs / cookedMs << "x faster)" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+void runTextureCacheBenchmark(const TexturePack& pack, const glm::vec3& colorKey) {
+	// Background and tileset first, then the sheets of the level; neighbouring levels share some
+	const std::vector<std::vector<const char*>> levels = {
+		{ "galaxy2", "Blocks", "LonerA", "LonerB", "drone", "rusher", "MAster96", "SAster96", "explode32" },
+		{ "galaxy2", "BlocksA", "LonerC", "Homing", "GAster96", "GAster64", "MAster64", "explode32", "smoke" },
+		{ "galaxy2", "BlocksB", "Ship1", "Ship2", "PUWeapon", "PULife", "PUShield", "SAster64", "GDust" },
+		{ "galaxy2", "Blocks", "LonerA", "drone", "MAster96A", "SAster96A", "MDust", "SDust", "explode64" }
+	};
+	const int visits[] = { 0, 1, 2, 1, 3, 0, 2, 3, 1, 0, 3, 2 };
+	const int visitCount = sizeof(visits) / sizeof(visits[0]);
+
+	// Bytes of every sheet and of the largest level, to size the tight budget
+	TextureCache cache;
+	initTextureCache(cache, pack.textureCount > 0 ? &pack : NULL, 0);
+	size_t largestLevel = 0;
+	for (const std::vector<const char*>& level : levels) {
+		std::vector<TextureHandle> handles;
+		for (const char* name : level) {
+			std::string filepath = std::string("../Assets/graphics/") + name + ".bmp";
+			handles.push_back(acquireTexture(cache, filepath.c_str(), colorKey, std::strcmp(name, "galaxy2") != 0));
+		}
+		size_t bytes = 0;
+		for (TextureHandle handle : handles) {
+			if (handle.generation != 0)
+				bytes += cache.textures[handle.slot].bytes;
+		}
+		largestLevel = std::max(largestLevel, bytes);
+		for (TextureHandle handle : handles)
+			releaseTexture(cache, handle);
+	}
+	size_t allSheets = cache.stats.bytes;
+	int distinctSheets = cache.stats.textures;
+	destroyTextureCache(cache);
+
+	struct Budget {
+		const char* name;
+		size_t bytes;
+	};
+	const Budget budgets[] = {
+		{ "no reuse", 1 },
+		{ "tight", largestLevel + allSheets / 4 },
+		{ "unlimited", 0 }
+	};
+
+	std::cout << std::fixed << std::setprecision(2) << "Texture cache: " << visitCount << " level changes over " << levels.size() << " levels, "
+		<< distinctSheets << " sheets, " << allSheets / (1024.0 * 1024.0) << " MB with mips, largest level " << largestLevel / (1024.0 * 1024.0)
+		<< " MB (" << (pack.textureCount > 0 ? "cooked pack" : "decoding sources") << ")" << std::endl;
+	for (const Budget& budget : budgets) {
+		initTextureCache(cache, pack.textureCount > 0 ? &pack : NULL, budget.bytes);
+		std::vector<TextureHandle> current, next;
+		double worstMs = 0.0;
+		glFinish();
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int visit = 0; visit < visitCount; ++visit) {
+			// The next level's sheets are referenced before the last level lets go, so shared ones stay loaded
+			Uint64 changeStart = SDL_GetPerformanceCounter();
+			next.clear();
+			for (const char* name : levels[visits[visit]]) {
+				std::string filepath = std::string("../Assets/graphics/") + name + ".bmp";
+				next.push_back(acquireTexture(cache, filepath.c_str(), colorKey, std::strcmp(name, "galaxy2") != 0));
+			}
+			for (TextureHandle handle : current)
+				releaseTexture(cache, handle);
+			current.swap(next);
+			glFinish();
+			worstMs = std::max(worstMs, secondsSince(changeStart) * 1000.0);
+		}
+		double totalMs = secondsSince(start) * 1000.0;
+		for (TextureHandle handle : current)
+			releaseTexture(cache, handle);
+
+		const TextureCacheStats& stats = cache.stats;
+		std::cout << "  " << std::left << std::setw(10) << budget.name << std::right;
+		if (budget.bytes > 1)
+			std::cout << std::setw(7) << budget.bytes / (1024.0 * 1024.0) << " MB";
+		else
+			std::cout << std::setw(10) << "";
+		std::cout << ": " << std::setw(7) << totalMs / visitCount << " ms per change (worst " << std::setw(7) << worstMs << "), "
+			<< std::setw(3) << stats.loads << " loads, " << std::setw(3) << stats.hits << " hits, " << std::setw(3) << stats.evictions
+			<< " evictions, peak " << stats.peakBytes / (1024.0 * 1024.0) << " MB, " << stats.textures << " kept" << std::endl;
+		destroyTextureCache(cache);
+	}
+	std::cout.unsetf(std::ios::fixed);
+}
+
+void runTextureCompressionBenchmark(const glm::vec3& colorKey) {
+	const char* files[] = { "Blocks", "galaxy2", "font16x16", "LonerA", "MAster96", "explode32", "smoke" };
+	const int runs = 3;
+	int threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	std::cout << std::fixed << std::setprecision(2) << "Block compression, " << threads << " thread(s), ms per level 0 encode:" << std::endl
+		<< "  sheet         format      size   scalar     SSE2  threads     PSNR    VRAM RGBA8 -> BC    upload RGBA8 -> BC" << std::endl;
+	size_t rgbaTotal = 0, blockTotal = 0;
+	for (const char* name : files) {
+		std::string filepath = std::string("../Assets/graphics/") + name + ".bmp";
+		int width, height;
+		unsigned char* image = loadImage(filepath.c_str(), colorKey, std::strcmp(name, "galaxy2") != 0, width, height);
+		if (!image)
+			continue;
+		TextureFormat format = chooseBlockFormat(image, width, height);
+		std::vector<unsigned char> scalarBlocks(textureLevelBytes(format, width, height)), blocks(scalarBlocks.size());
+
+		double scalarMs = 0.0, sse2Ms = 0.0, threadedMs = 0.0;
+		for (int run = 0; run < runs; ++run) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			compressImage(image, width, height, format, scalarBlocks.data(), 1, BLOCK_KERNEL_SCALAR);
+			scalarMs += secondsSince(start) * 1000.0 / runs;
+			start = SDL_GetPerformanceCounter();
+			compressImage(image, width, height, format, blocks.data(), 1, BLOCK_KERNEL_SSE2);
+			sse2Ms += secondsSince(start) * 1000.0 / runs;
+			start = SDL_GetPerformanceCounter();
+			compressImage(image, width, height, format, blocks.data(), threads, BLOCK_KERNEL_BEST);
+			threadedMs += secondsSince(start) * 1000.0 / runs;
+		}
+		bool identical = scalarBlocks == blocks;
+
+		std::vector<unsigned char> decoded((size_t)width * height * 4);
+		decompressImage(blocks.data(), width, height, format, decoded.data());
+		double psnr = imagePsnr(image, decoded.data(), width, height);
+
+		// Upload both ways, the RGBA8 one mipped by the driver as the scene did before
+		int mipLevels = mipLevelCount(width, height);
+		std::vector<unsigned char> chain = compressMipChain(image, width, height, format, threads);
+		glFinish();
+		Uint64 start = SDL_GetPerformanceCounter();
+		GLuint rgbaTexture = createTexture(image, width, height);
+		glFinish();
+		double rgbaUploadMs = secondsSince(start) * 1000.0;
+		start = SDL_GetPerformanceCounter();
+		GLuint blockTexture = createTextureLevels(chain.data(), width, height, mipLevels, format);
+		glFinish();
+		double blockUploadMs = secondsSince(start) * 1000.0;
+		glDeleteTextures(1, &rgbaTexture);
+		glDeleteTextures(1, &blockTexture);
+
+		size_t rgbaBytes = textureChainBytes(TEXTURE_FORMAT_RGBA8, width, height, mipLevels);
+		size_t blockBytes = textureChainBytes(gpuTextureFormat(format), width, height, mipLevels);
+		rgbaTotal += rgbaBytes;
+		blockTotal += blockBytes;
+		std::cout << "  " << std::left << std::setw(13) << name << std::setw(5) << textureFormatName(format) << std::right
+			<< std::setw(6) << width << "x" << std::left << std::setw(5) << height << std::right
+			<< std::setw(8) << scalarMs << std::setw(9) << sse2Ms << std::setw(9) << threadedMs << std::setw(7) << psnr << " dB"
+			<< std::setw(8) << rgbaBytes / 1024.0 << " -> " << std::setw(7) << blockBytes / 1024.0 << " KB"
+			<< std::setw(8) << rgbaUploadMs << " -> " << std::setw(6) << blockUploadMs << " ms" << (identical ? "" : "  SSE2 MISMATCH") << std::endl;
+		freeImage(image);
+	}
+	std::cout << "  VRAM with mips: " << rgbaTotal / (1024.0 * 1024.0) << " MB as RGBA8, " << blockTotal / (1024.0 * 1024.0) << " MB compressed ("
+		<< (double)rgbaTotal / blockTotal << "x less to store and fetch)" << (textureCompressionSupported() ? "" : ", expanded to RGBA8 on this driver") << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+void runBmpDecodeBenchmark(const glm::vec3& colorKey) {
+	const char* files[] = { "../Assets/graphics/Blocks.bmp", "../Assets/graphics/galaxy2.bmp" };
+	const BmpKernel kernels[] = { BMP_KERNEL_SCALAR, BMP_KERNEL_SSE2, BMP_KERNEL_AVX2 };
+	const int runs = 20;
+
+	std::cout << "Best BMP kernel on this CPU: " << bmpKernelName(BMP_KERNEL_BEST) << std::endl;
+	for (const char* filepath : files) {
+		int width, height;
+		unsigned char* reference = loadImageStb(filepath, colorKey, true, width, height);
+		if (!reference)
+			continue;
+		size_t bytes = (size_t)width * height * 4;
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int run = 0; run < runs; ++run)
+			freeImage(loadImageStb(filepath, colorKey, true, width, height));
+		double stbMs = secondsSince(start) * 1000.0 / runs;
+
+		std::cout << std::fixed << std::setprecision(3) << filepath << " (" << width << "x" << height << ")" << std::endl
+			<< "  stb_image + flip + key loop: " << stbMs << " ms" << std::endl;
+
+		for (BmpKernel kernel : kernels) {
+			if (kernel == BMP_KERNEL_AVX2 && bestBmpKernel() != BMP_KERNEL_AVX2)
+				continue;
+
+			// Read the file each run as well, like loadImage does
+			unsigned char* image = NULL;
+			start = SDL_GetPerformanceCounter();
+			for (int run = 0; run < runs; ++run) {
+				std::ifstream in(filepath, std::ios::binary | std::ios::ate);
+				std::vector<unsigned char> file((size_t)in.tellg());
+				in.seekg(0);
+				in.read((char*)file.data(), file.size());
+				freeImage(image);
+				image = decodeBmp24(file.data(), file.size(), colorKey, true, width, height, kernel);
+			}
+			double kernelMs = secondsSince(start) * 1000.0 / runs;
+			bool matches = image && std::memcmp(image, reference, bytes) == 0;
+			freeImage(image);
+
+			std::cout << "  fused " << std::setw(6) << bmpKernelName(kernel) << ":                " << kernelMs << " ms ("
+				<< stbMs / kernelMs << "x)" << (matches ? "" : " MISMATCH") << std::endl;
+		}
+		std::cout.unsetf(std::ios::fixed);
+		freeImage(reference);
+	}
+}
+
+void runAnimationBenchmark() {
+	const size_t count = 1000000;
+	const int ticks = 200;
+	const float deltaTime = 1.0f / 60.0f;
+	const int frameCounts[] = { 1, 4, 8, 16, 24, 25, 32 };
+
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> pickFrames(0, (int)(sizeof(frameCounts) / sizeof(frameCounts[0])) - 1);
+	std::uniform_real_distribution<float> pickDuration(0.05f, 0.25f);
+
+	AnimationStore store;
+	std::vector<SpriteAnimation> objects;
+	objects.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		int frames = frameCounts[pickFrames(rng)];
+		float duration = pickDuration(rng);
+		int frame = (int)(i % frames);
+		addAnimation(store, frames, duration, frame);
+		objects.push_back(SpriteAnimation(0, 1, frames, duration, 1.0f, 1.0f, 0.0f, 0.0f));
+		objects.back().currentFrame = frame;
+	}
+
+	std::cout << "Best animation kernel on this CPU: " << animationKernelName(ANIMATION_KERNEL_BEST) << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int tick = 0; tick < ticks; ++tick) {
+		for (SpriteAnimation& anim : objects)
+			updateSpriteAnimation(anim, deltaTime);
+	}
+	double objectMs = secondsSince(start) * 1000.0 / ticks;
+	std::cout << count << " animations, " << ticks << " ticks" << std::endl
+		<< "  per-object update: " << objectMs << " ms/tick" << std::endl;
+
+	AnimationStore reference;
+	const AnimationKernel kernels[] = { ANIMATION_KERNEL_SCALAR, ANIMATION_KERNEL_AVX2 };
+	for (AnimationKernel kernel : kernels) {
+		if (kernel == ANIMATION_KERNEL_AVX2 && bestAnimationKernel() != ANIMATION_KERNEL_AVX2)
+			continue;
+
+		AnimationStore run = store;
+		start = SDL_GetPerformanceCounter();
+		for (int tick = 0; tick < ticks; ++tick)
+			updateAnimations(run, deltaTime, kernel);
+		double kernelMs = secondsSince(start) * 1000.0 / ticks;
+
+		// Every kernel must land on the same frames as the scalar one
+		bool matches = true;
+		if (kernel == ANIMATION_KERNEL_SCALAR)
+			reference = run;
+		else
+			matches = run.currentFrame == reference.currentFrame && run.elapsedTime == reference.elapsedTime;
+
+		std::cout << "  SoA " << std::setw(6) << animationKernelName(kernel) << ":        " << kernelMs << " ms/tick ("
+			<< objectMs / kernelMs << "x)" << (matches ? "" : " MISMATCH") << std::endl;
+	}
+
+	// A 1.05 s hitch on a 16 frame, 0.1 s animation must skip 10 frames and keep 0.05 s
+	AnimationStore hitch;
+	addAnimation(hitch, 16, 0.1f);
+	updateAnimations(hitch, 1.05f);
+	bool carried = hitch.currentFrame[0] == 10 && std::abs(hitch.elapsedTime[0] - 0.05f) < 1e-4f;
+	std::cout << "  long delta carry: " << (carried ? "ok" : "WRONG") << " (frame " << hitch.currentFrame[0]
+		<< ", elapsed " << hitch.elapsedTime[0] << " s)" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
+
+void runCullingBenchmark() {
+	const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+	const int frames = 100;
+	const float worldHalfWidth = 6400.0f, worldHalfHeight = 4800.0f;  // 16 x 16 screens
+	const float viewHalfWidth = 400.0f, viewHalfHeight = 300.0f;
+
+	std::cout << std::left << std::setw(10) << "entities" << std::setw(10) << "build ms" << std::setw(11) << "update ms"
+		<< std::setw(10) << "query ms" << std::setw(10) << "brute ms" << std::setw(9) << "visible" << std::setw(8) << "nodes" << "tested" << std::endl;
+
+	for (size_t count : counts) {
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> posX(-worldHalfWidth, worldHalfWidth);
+		std::uniform_real_distribution<float> posY(-worldHalfHeight, worldHalfHeight);
+		std::uniform_real_distribution<float> size(16.0f, 96.0f);
+		std::uniform_real_distribution<float> speed(-4.0f, 4.0f);
+
+		std::vector<QuadtreeBounds> bounds(count);
+		std::vector<float> velocityX(count), velocityY(count);
+		for (size_t i = 0; i < count; ++i) {
+			float extent = size(rng);
+			bounds[i] = spriteBounds(posX(rng), posY(rng), extent, extent);
+			velocityX[i] = speed(rng);
+			velocityY[i] = speed(rng);
+		}
+
+		Uint64 start = SDL_GetPerformanceCounter();
+		LooseQuadtree tree;
+		initQuadtree(tree, 0.0f, 0.0f, std::max(worldHalfWidth, worldHalfHeight));
+		for (const QuadtreeBounds& b : bounds)
+			insertQuadtreeItem(tree, b);
+		double buildMs = secondsSince(start) * 1000.0;
+
+		// A tenth of the entities move every frame while the camera pans across the world
+		double updateSeconds = 0.0, querySeconds = 0.0, bruteSeconds = 0.0;
+		long long visible = 0, nodesVisited = 0, itemsTested = 0;
+		bool matches = true;
+		std::vector<int> found, brute;
+		found.reserve(count);
+		brute.reserve(count);
+		for (int frame = 0; frame < frames; ++frame) {
+			start = SDL_GetPerformanceCounter();
+			for (size_t i = frame % 10; i < count; i += 10) {
+				float dx = velocityX[i], dy = velocityY[i];
+				bounds[i] = { bounds[i].minX + dx, bounds[i].minY + dy, bounds[i].maxX + dx, bounds[i].maxY + dy };
+				updateQuadtreeItem(tree, (int)i, bounds[i]);
+			}
+			updateSeconds += secondsSince(start);
+
+			float cameraX = -worldHalfWidth + 2.0f * worldHalfWidth * frame / frames;
+			float cameraY = worldHalfHeight * 0.5f * std::sin(frame * 0.1f);
+			QuadtreeBounds view = { cameraX - viewHalfWidth, cameraY - viewHalfHeight, cameraX + viewHalfWidth, cameraY + viewHalfHeight };
+
+			found.clear();
+			start = SDL_GetPerformanceCounter();
+			queryQuadtree(tree, view, found);
+			querySeconds += secondsSince(start);
+			visible += found.size();
+			nodesVisited += tree.stats.nodesVisited;
+			itemsTested += tree.stats.itemsTested;
+
+			brute.clear();
+			start = SDL_GetPerformanceCounter();
+			for (size_t i = 0; i < count; ++i) {
+				const QuadtreeBounds& b = bounds[i];
+				if (b.minX <= view.maxX && b.maxX >= view.minX && b.minY <= view.maxY && b.maxY >= view.minY)
+					brute.push_back((int)i);
+			}
+			bruteSeconds += secondsSince(start);
+
+			// The tree must find exactly what the linear scan finds
+			std::sort(found.begin(), found.end());
+			matches = matches && found == brute;
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << count << std::setw(10) << buildMs
+			<< std::setw(11) << updateSeconds * 1000.0 / frames << std::setw(10) << querySeconds * 1000.0 / frames
+			<< std::setw(10) << bruteSeconds * 1000.0 / frames << std::setprecision(0) << std::setw(9) << (double)visible / frames
+			<< std::setw(8) << (double)nodesVisited / frames << (double)itemsTested / frames << (matches ? "" : " MISMATCH") << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+void runParticleBenchmark() {
+	const size_t capacity = 1000000;
+	const int ticks = 200;
+	const float deltaTime = 1.0f / 60.0f;
+
+	// Dust-like particles living 2 to 4 s, topped back up to a full pool every tick
+	ParticleEmitter emitter = ParticleEmitter();
+	emitter.columns = 4;
+	emitter.rows = 1;
+	emitter.speedMin = 20.0f;
+	emitter.speedMax = 200.0f;
+	emitter.lifeMin = 2.0f;
+	emitter.lifeMax = 4.0f;
+	emitter.sizeMin = emitter.sizeMax = 8.0f;
+	emitter.gravity = -30.0f;
+	emitter.drag = 0.5f;
+
+	std::cout << capacity << " particles, " << ticks << " ticks, best kernel on this CPU: " << animationKernelName(ANIMATION_KERNEL_BEST) << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	std::vector<ParticleInstance> instances(capacity);
+	ParticleSystem reference;
+	const AnimationKernel kernels[] = { ANIMATION_KERNEL_SCALAR, ANIMATION_KERNEL_AVX2 };
+	for (AnimationKernel kernel : kernels) {
+		if (kernel == ANIMATION_KERNEL_AVX2 && bestAnimationKernel() != ANIMATION_KERNEL_AVX2)
+			continue;
+
+		ParticleSystem system;
+		initParticleSystem(system);
+		int pool = addParticlePool(system, emitter, capacity);
+		emitParticles(system, pool, 0.0f, 0.0f, capacity);
+
+		double updateSeconds = 0.0, emitSeconds = 0.0, writeSeconds = 0.0;
+		size_t retired = 0;
+		for (int tick = 0; tick < ticks; ++tick) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			updateParticles(system, deltaTime, kernel);
+			updateSeconds += secondsSince(start);
+
+			start = SDL_GetPerformanceCounter();
+			retired += emitParticles(system, pool, 0.0f, 0.0f, capacity - liveParticles(system));
+			emitSeconds += secondsSince(start);
+
+			start = SDL_GetPerformanceCounter();
+			writeParticleInstances(system.pools[pool], instances.data());
+			writeSeconds += secondsSince(start);
+		}
+
+		// Both kernels must retire the same particles and leave them in the same places
+		bool matches = true;
+		if (kernel == ANIMATION_KERNEL_SCALAR)
+			reference = system;
+		else {
+			const ParticlePool& a = reference.pools[pool];
+			const ParticlePool& b = system.pools[pool];
+			matches = a.count == b.count && a.x == b.x && a.y == b.y && a.age == b.age;
+		}
+
+		std::cout << "  " << std::setw(6) << animationKernelName(kernel) << ": update " << updateSeconds * 1000.0 / ticks << " ms/tick, respawn "
+			<< emitSeconds * 1000.0 / ticks << " ms/tick (" << retired / ticks << " per tick), instance write " << writeSeconds * 1000.0 / ticks
+			<< " ms/frame, " << liveParticles(system) << " live" << (matches ? "" : " MISMATCH") << std::endl;
+	}
+	std::cout.unsetf(std::ios::fixed);
+}
+
+// Every pair over every entity, the reference the broadphase has to match
+static void bruteForcePairs(const std::vector<BroadphaseProxy>& proxies, std::vector<CollisionPair>& pairs) {
+	pairs.clear();
+	for (size_t i = 0; i < proxies.size(); ++i) {
+		const BroadphaseProxy& a = proxies[i];
+		for (size_t j = i + 1; j < proxies.size(); ++j) {
+			const BroadphaseProxy& b = proxies[j];
+			if (layersCollide(a.layer, a.mask, b.layer, b.mask) && a.bounds.minX <= b.bounds.maxX && a.bounds.maxX >= b.bounds.minX
+				&& a.bounds.minY <= b.bounds.maxY && a.bounds.maxY >= b.bounds.minY)
+				pairs.push_back({ (int)i, (int)j });
+		}
+	}
+}
+
+static bool pairLess(const CollisionPair& a, const CollisionPair& b) {
+	return a.a != b.a ? a.a < b.a : a.b < b.b;
+}
+
+void runBroadphaseBenchmark() {
+	const size_t counts[] = { 1000, 10000, 100000 };
+	const int frames = 60;
+
+	// Shots and enemies make up most of a busy screen
+	struct LayerMix { unsigned int layer, mask; };
+	const LayerMix mix[] = {
+		{ COLLISION_LAYER_PLAYER_SHOT, COLLISION_LAYER_ENEMY | COLLISION_LAYER_ASTEROID },
+		{ COLLISION_LAYER_PLAYER_SHOT, COLLISION_LAYER_ENEMY | COLLISION_LAYER_ASTEROID },
+		{ COLLISION_LAYER_ENEMY, COLLISION_LAYER_PLAYER | COLLISION_LAYER_PLAYER_SHOT },
+		{ COLLISION_LAYER_ENEMY, COLLISION_LAYER_PLAYER | COLLISION_LAYER_PLAYER_SHOT },
+		{ COLLISION_LAYER_ENEMY_SHOT, COLLISION_LAYER_PLAYER },
+		{ COLLISION_LAYER_ASTEROID, COLLISION_LAYER_PLAYER | COLLISION_LAYER_PLAYER_SHOT },
+		{ COLLISION_LAYER_PICKUP, COLLISION_LAYER_PLAYER },
+		{ COLLISION_LAYER_PLAYER, 0 }
+	};
+
+	// The first frame sorts every entry from scratch and is timed on its own; sap ms, swaps and tested are
+	// per frame over the ones after it
+	std::cout << std::left << std::setw(10) << "entities" << std::setw(11) << "build ms" << std::setw(11) << "sap ms" << std::setw(11)
+		<< "brute ms" << std::setw(10) << "speedup" << std::setw(10) << "swaps" << std::setw(10) << "tested" << "pairs" << std::endl;
+
+	for (size_t count : counts) {
+		// Same density at every count, about one 80x80 cell per entity
+		float half = 40.0f * std::sqrt((float)count);
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-half, half);
+		std::uniform_real_distribution<float> size(8.0f, 64.0f);
+		std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+		std::uniform_int_distribution<int> pickLayer(0, (int)(sizeof(mix) / sizeof(mix[0])) - 1);
+
+		SweepAndPrune sap = SweepAndPrune();
+		std::vector<float> velocityX(count), velocityY(count);
+		for (size_t i = 0; i < count; ++i) {
+			float extent = size(rng);
+			const LayerMix& layer = mix[pickLayer(rng)];
+			addCollisionProxy(sap, spriteBounds(position(rng), position(rng), extent, extent), layer.layer, layer.mask);
+			velocityX[i] = speed(rng);
+			velocityY[i] = speed(rng);
+		}
+
+		std::vector<CollisionPair> pairs;
+		double buildSeconds = 0.0, sapSeconds = 0.0;
+		size_t swaps = 0, tested = 0;
+		for (int frame = 0; frame < frames; ++frame) {
+			for (size_t i = 0; i < count; ++i) {
+				QuadtreeBounds b = sap.proxies[i].bounds;
+				moveCollisionProxy(sap, (int)i, { b.minX + velocityX[i], b.minY + velocityY[i], b.maxX + velocityX[i], b.maxY + velocityY[i] });
+			}
+			Uint64 start = SDL_GetPerformanceCounter();
+			findCollisionPairs(sap, pairs);
+			if (frame == 0) {
+				buildSeconds = secondsSince(start);
+				continue;
+			}
+			sapSeconds += secondsSince(start);
+			swaps += sap.stats.swaps;
+			tested += sap.stats.pairsTested;
+		}
+
+		// Brute force is quadratic, a few frames are enough to time it
+		int bruteFrames = (int)std::max<size_t>(1, std::min<size_t>(frames, 500000000 / (count * count)));
+		std::vector<CollisionPair> brute;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < bruteFrames; ++frame)
+			bruteForcePairs(sap.proxies, brute);
+		double bruteMs = secondsSince(start) * 1000.0 / bruteFrames;
+
+		std::sort(pairs.begin(), pairs.end(), pairLess);
+		std::sort(brute.begin(), brute.end(), pairLess);
+		bool matches = pairs.size() == brute.size();
+		for (size_t i = 0; matches && i < pairs.size(); ++i)
+			matches = pairs[i].a == brute[i].a && pairs[i].b == brute[i].b;
+
+		double sapMs = sapSeconds * 1000.0 / (frames - 1);
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << count << std::setw(11) << buildSeconds * 1000.0 << std::setw(11)
+			<< sapMs << std::setw(11) << bruteMs
+			<< std::setprecision(1) << std::setw(10) << bruteMs / sapMs << std::setprecision(0) << std::setw(10) << (double)swaps / (frames - 1)
+			<< std::setw(10) << (double)tested / (frames - 1) << pairs.size() << (matches ? "" : " MISMATCH") << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+// Per-pixel reference for the mask test
+static bool masksOverlapReference(const CollisionMask& a, int ax, int ay, const CollisionMask& b, int bx, int by) {
+	for (int y = 0; y < b.height; ++y) {
+		for (int x = 0; x < b.width; ++x) {
+			int px = bx + x - ax, py = by + y - ay;
+			if (px >= 0 && px < a.width && py >= 0 && py < a.height && collisionMaskBit(b, x, y) && collisionMaskBit(a, px, py))
+				return true;
+		}
+	}
+	return false;
+}
+
+void runCollisionMaskBenchmark(const glm::vec3& colorKey) {
+	// Sheets with their layout and the size their frames are drawn at, like the scene
+	struct MaskSheet { const char* filepath; int rows, columns; int width, height; };
+	const MaskSheet sheets[] = {
+		{ "../Assets/graphics/ShipIdle.bmp", 1, 1, 64, 64 },
+		{ "../Assets/graphics/missileA.bmp", 1, 1, 65, 64 },
+		{ "../Assets/graphics/missileB.bmp", 1, 1, 65, 64 },
+		{ "../Assets/graphics/MAster96.bmp", 5, 5, 64, 64 },
+		{ "../Assets/graphics/MAster64.bmp", 3, 8, 64, 64 },
+		{ "../Assets/graphics/SAster96.bmp", 5, 5, 64, 64 },
+		{ "../Assets/graphics/GAster96.bmp", 5, 5, 64, 64 }
+	};
+	const AnimationKernel kernels[] = { ANIMATION_KERNEL_SCALAR, ANIMATION_KERNEL_AVX2 };
+	const int pairCount = 1000000;
+	const int checkedPairs = 20000;
+
+	std::vector<CollisionMask> frames;
+	double buildMs = 0.0, frameMs = 0.0;
+	size_t maskBytes = 0;
+	for (const MaskSheet& sheet : sheets) {
+		int width, height;
+		unsigned char* pixels = loadImage(sheet.filepath, colorKey, true, width, height);
+		if (!pixels)
+			continue;
+		CollisionMask sheetMask;
+		Uint64 start = SDL_GetPerformanceCounter();
+		buildCollisionMask(sheetMask, pixels, width, height);
+		buildMs += secondsSince(start) * 1000.0;
+		freeImage(pixels);
+
+		start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < sheet.rows * sheet.columns; ++frame) {
+			frames.push_back(CollisionMask());
+			frameCollisionMask(frames.back(), sheetMask, sheet.rows, sheet.columns, frame, sheet.width, sheet.height);
+			maskBytes += frames.back().bits.size() * sizeof(uint64_t);
+		}
+		frameMs += secondsSince(start) * 1000.0;
+	}
+	if (frames.empty())
+		return;
+
+	std::cout << std::fixed << std::setprecision(3) << "Sheet masks built in " << buildMs << " ms, " << frames.size() << " frame masks cut in "
+		<< frameMs << " ms (" << maskBytes / 1024 << " KB)" << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+
+	// Random frame pairs whose bounding boxes overlap, which is all the broadphase hands over
+	struct MaskPair { int a, b; int dx, dy; };
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> pickFrame(0, (int)frames.size() - 1);
+	std::vector<MaskPair> pairs(pairCount);
+	for (MaskPair& pair : pairs) {
+		pair.a = pickFrame(rng);
+		pair.b = pickFrame(rng);
+		std::uniform_int_distribution<int> offsetX(1 - frames[pair.b].width, frames[pair.a].width - 1);
+		std::uniform_int_distribution<int> offsetY(1 - frames[pair.b].height, frames[pair.a].height - 1);
+		pair.dx = offsetX(rng);
+		pair.dy = offsetY(rng);
+	}
+
+	std::vector<char> reference(checkedPairs);
+	for (int i = 0; i < checkedPairs; ++i) {
+		const MaskPair& pair = pairs[i];
+		reference[i] = masksOverlapReference(frames[pair.a], 0, 0, frames[pair.b], pair.dx, pair.dy);
+	}
+
+	std::cout << "Best kernel on this CPU: " << animationKernelName(bestAnimationKernel()) << std::endl;
+	std::cout << std::left << std::setw(10) << "kernel" << std::setw(12) << "ns/pair" << std::setw(12) << "hits" << "check" << std::endl;
+	for (AnimationKernel kernel : kernels) {
+		if (kernel == ANIMATION_KERNEL_AVX2 && bestAnimationKernel() != ANIMATION_KERNEL_AVX2)
+			continue;
+
+		int hits = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (const MaskPair& pair : pairs)
+			hits += collisionMasksOverlap(frames[pair.a], 0, 0, frames[pair.b], pair.dx, pair.dy, kernel);
+		double ns = secondsSince(start) * 1e9 / pairCount;
+
+		bool matches = true;
+		for (int i = 0; matches && i < checkedPairs; ++i) {
+			const MaskPair& pair = pairs[i];
+			matches = collisionMasksOverlap(frames[pair.a], 0, 0, frames[pair.b], pair.dx, pair.dy, kernel) == (reference[i] != 0);
+		}
+
+		std::cout << std::fixed << std::setprecision(1) << std::setw(10) << animationKernelName(kernel) << std::setw(12) << ns
+			<< std::setw(12) << hits << (matches ? "ok" : "MISMATCH") << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+void runObjectPoolBenchmark() {
+	const size_t counts[] = { 1000, 10000, 100000 };
+	const int frames = 600;
+	const size_t churnDivisor = 10;  // A tenth of the entities die and respawn every frame
+
+	std::cout << std::left << std::setw(10) << "entities" << std::setw(14) << "vector ns/op" << std::setw(12) << "pool ns/op"
+		<< std::setw(10) << "speedup" << std::setw(12) << "vector grow" << std::setw(12) << "pool grow" << "stale" << std::endl;
+
+	for (size_t count : counts) {
+		size_t churn = std::max<size_t>(1, count / churnDivisor);
+		const SpriteAnimation prototype(0, 1, 1, 0.1f, 24.0f, 24.0f, 0.0f, 0.0f);
+
+		// The same sequence of deaths for both, as fractions of the live count
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<double> pick(0.0, 1.0);
+		std::vector<double> deaths((size_t)frames * churn);
+		for (double& death : deaths)
+			death = pick(rng);
+
+		// Entities as values in a vector, the way the scene holds them: despawning erases, spawning appends.
+		// Erasing is linear in the count, fewer frames are enough to time the large counts.
+		std::vector<SpriteAnimation> entities;
+		int vectorGrows = 0;
+		const SpriteAnimation* storage = entities.data();
+		for (size_t i = 0; i < count; ++i) {
+			entities.push_back(prototype);
+			if (entities.data() != storage) {
+				storage = entities.data();
+				++vectorGrows;
+			}
+		}
+		int vectorFrames = (int)std::max<size_t>(1, std::min<size_t>(frames, 2000000000 / (count * churn)));
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < vectorFrames; ++frame) {
+			for (size_t k = 0; k < churn; ++k) {
+				size_t index = (size_t)(deaths[(size_t)frame * churn + k] * entities.size());
+				entities.erase(entities.begin() + index);
+			}
+			for (size_t k = 0; k < churn; ++k) {
+				entities.push_back(prototype);
+				if (entities.data() != storage) {
+					storage = entities.data();
+					++vectorGrows;
+				}
+			}
+		}
+		double vectorNs = secondsSince(start) * 1e9 / ((double)vectorFrames * churn * 2);
+
+		ObjectPool<SpriteAnimation> pool;
+		initObjectPool(pool, count);
+		std::vector<PoolHandle> despawned;
+		despawned.reserve(churn);
+		for (size_t i = 0; i < count; ++i)
+			spawnObject(pool, prototype);
+		const SpriteAnimation* poolStorage = pool.objects.data();
+		size_t stale = 0;
+		start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < frames; ++frame) {
+			despawned.clear();
+			for (size_t k = 0; k < churn; ++k) {
+				PoolHandle handle = objectHandle(pool, (size_t)(deaths[(size_t)frame * churn + k] * pool.count));
+				despawnObject(pool, handle);
+				despawned.push_back(handle);
+			}
+			for (size_t k = 0; k < churn; ++k)
+				spawnObject(pool, prototype);
+			// Handles kept past despawn must not reach the object now living in their slot
+			for (const PoolHandle& handle : despawned)
+				stale += getObject(pool, handle) == NULL;
+		}
+		double poolNs = secondsSince(start) * 1e9 / ((double)frames * churn * 2);
+		int poolGrows = pool.objects.data() != poolStorage;
+
+		std::cout << std::fixed << std::setprecision(1) << std::setw(10) << count << std::setw(14) << vectorNs << std::setw(12) << poolNs
+			<< std::setw(10) << vectorNs / poolNs << std::setw(12) << vectorGrows << std::setw(12) << poolGrows
+			<< stale << "/" << (size_t)frames * churn << (pool.stats.failed ? " FULL" : "") << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+// Everything an entity might need in one struct, the way a single SpriteAnimation vector would grow
+struct FusedEntity {
+	SpriteAnimation sprite;
+	float velocityX, velocityY;
+	float health, maxHealth;
+	bool moves, hasHealth;
+};
+
+static void runHealthRegen(Archetype& archetype, size_t begin, size_t end, void* context) {
+	float amount = 5.0f * ((TickContext*)context)->deltaTime;
+	HealthComponent* healths = archetype.healths.data();
+	for (size_t i = begin; i < end; ++i)
+		healths[i].current = std::min(healths[i].max, healths[i].current + amount);
+}
+
+// Fill a world with mixed archetypes: static and moving sprites, enemies with health and invisible movers
+static void spawnEcsBenchmarkWorld(EcsWorld& world, std::vector<FusedEntity>* fused, size_t count) {
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-2000.0f, 2000.0f);
+	std::uniform_real_distribution<float> speed(-60.0f, 60.0f);
+	std::uniform_int_distribution<int> frames(1, 32);
+	std::uniform_real_distribution<float> duration(0.05f, 0.25f);
+	const unsigned int sprite = COMPONENT_POSITION | COMPONENT_SIZE | COMPONENT_SPRITE | COMPONENT_ANIMATION;
+	const unsigned int kinds[] = {
+		sprite, sprite, sprite, sprite,
+		sprite | COMPONENT_VELOCITY, sprite | COMPONENT_VELOCITY, sprite | COMPONENT_VELOCITY,
+		sprite | COMPONENT_VELOCITY | COMPONENT_HEALTH, sprite | COMPONENT_VELOCITY | COMPONENT_HEALTH,
+		COMPONENT_POSITION | COMPONENT_VELOCITY | COMPONENT_HEALTH
+	};
+
+	initEcsWorld(world);
+	for (size_t i = 0; i < count; ++i) {
+		int frameCount = frames(rng);
+		SpriteAnimation anim(0, 1, frameCount, duration(rng), 32.0f, 32.0f, position(rng), position(rng));
+		EntityDesc desc = spriteEntityDesc(anim);
+		desc.components = kinds[i % (sizeof(kinds) / sizeof(kinds[0]))];
+		desc.velocity = { speed(rng), speed(rng) };
+		desc.health = { 50.0f, 100.0f };
+		createEntity(world, desc);
+		if (fused) {
+			bool moves = (desc.components & COMPONENT_VELOCITY) != 0, hasHealth = (desc.components & COMPONENT_HEALTH) != 0;
+			fused->push_back({ anim, desc.velocity.x, desc.velocity.y, desc.health.current, desc.health.max, moves, hasHealth });
+		}
+	}
+}
+
+void runEcsBenchmark() {
+	const size_t count = 100000;
+	const int ticks = 200;
+	const float deltaTime = 1.0f / 120.0f;
+	int threads = std::max(2, defaultWorkerThreads());  // Run threaded even on small machines, to check the result
+
+	EcsWorld world;
+	std::vector<FusedEntity> fused;
+	fused.reserve(count);
+	spawnEcsBenchmarkWorld(world, &fused, count);
+	std::cout << count << " entities in " << world.archetypes.size() << " archetypes, " << ticks << " ticks" << std::endl;
+
+	// One struct per entity, every field of every entity streams through the cache each tick
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int tick = 0; tick < ticks; ++tick) {
+		for (FusedEntity& entity : fused) {
+			if (entity.moves) {
+				storePreviousPosition(entity.sprite);
+				entity.sprite.x += entity.velocityX * deltaTime;
+				entity.sprite.y += entity.velocityY * deltaTime;
+			}
+			updateSpriteAnimation(entity.sprite, deltaTime);
+			if (entity.hasHealth)
+				entity.health = std::min(entity.maxHealth, entity.health + 5.0f * deltaTime);
+		}
+	}
+	double fusedMs = secondsSince(start) * 1000.0 / ticks;
+	std::cout << std::fixed << std::setprecision(3) << "  fused struct vector:       " << fusedMs << " ms/tick" << std::endl;
+
+	// Movement, animation and health don't conflict, the schedule puts them in one stage
+	TickContext tick = { deltaTime, ANIMATION_KERNEL_BEST };
+	EcsSchedule schedule;
+	initEcsSchedule(schedule, 8192);
+	addEcsSystem(schedule, movementSystem(&tick));
+	addEcsSystem(schedule, animationSystem(&tick));
+	addEcsSystem(schedule, { "health regen", 0, COMPONENT_HEALTH, false, runHealthRegen, &tick });
+
+	EcsWorld reference;
+	const int threadCounts[] = { 0, threads };
+	for (int i = 0; i < 2; ++i) {
+		EcsWorld run;
+		spawnEcsBenchmarkWorld(run, NULL, count);
+		JobSystem jobs;
+		initJobSystem(jobs, threadCounts[i]);
+		start = SDL_GetPerformanceCounter();
+		for (int t = 0; t < ticks; ++t)
+			runEcsSchedule(schedule, run, jobs);
+		double ecsMs = secondsSince(start) * 1000.0 / ticks;
+		destroyJobSystem(jobs);
+
+		// The threaded run must land on exactly the same state as the serial one
+		bool matches = true;
+		if (i == 0)
+			reference = run;
+		for (size_t a = 0; i > 0 && matches && a < run.archetypes.size(); ++a) {
+			const Archetype& x = run.archetypes[a];
+			const Archetype& y = reference.archetypes[a];
+			matches = x.animations.currentFrame == y.animations.currentFrame && x.animations.elapsedTime == y.animations.elapsedTime
+				&& x.positions.size() == y.positions.size() && x.healths.size() == y.healths.size();
+			for (size_t r = 0; matches && r < x.positions.size(); ++r)
+				matches = x.positions[r].x == y.positions[r].x && x.positions[r].y == y.positions[r].y;
+			for (size_t r = 0; matches && r < x.healths.size(); ++r)
+				matches = x.healths[r].current == y.healths[r].current;
+		}
+
+		std::cout << "  archetype ECS, " << threadCounts[i] << " workers: " << ecsMs << " ms/tick (" << fusedMs / ecsMs << "x), "
+			<< schedule.stats.stages << " stage(s), " << schedule.stats.jobs << " jobs" << (matches ? "" : " MISMATCH") << std::endl;
+	}
+	std::cout.unsetf(std::ios::fixed);
+}
+
+// Value at fraction p of an ascending list
+static double percentile(const std::vector<double>& sorted, double p) {
+	return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+void runSpriteStressBenchmark(SpriteBatch& batch, TextRenderer& text, AnimatedSpriteLayer* layer, const std::vector<SpriteAnimation>& templates,
+	const std::vector<size_t>& counts, int frames, SDL_Window* window, JobSystem& jobs) {
+	if (templates.empty() || frames <= 0)
+		return;
+
+	const float deltaTime = 1.0f / 60.0f;
+	std::cout << std::left << std::setw(10) << "sprites" << std::setw(8) << "frames" << std::setw(10) << "fps"
+		<< std::setw(9) << "avg ms" << std::setw(9) << "p50" << std::setw(9) << "p95" << std::setw(9) << "p99" << std::setw(9) << "max"
+		<< std::setw(9) << "cpu ms" << std::setw(8) << "draws" << std::setw(9) << "changes" << std::setw(12) << "bytes/frame"
+		<< std::setw(10) << "unsorted" << "changes" << std::endl;
+
+	for (size_t count : counts) {
+		std::vector<int> picks;
+		std::vector<SpriteAnimation> sprites = spawnSprites(templates, count, &picks);
+		AnimationStore times;
+		for (const SpriteAnimation& sprite : sprites)
+			addAnimation(times, sprite);
+		SpriteFrame spriteFrame = makeSpriteFrame(sprites, times, templates, picks, glm::vec4(-400.0f, -300.0f, 400.0f, 300.0f), deltaTime);
+		if (layer) {
+			clearAnimatedSprites(*layer);
+			for (const SpriteAnimation& sprite : sprites)
+				addAnimatedSprite(*layer, sprite, 0.0f);
+		}
+
+		std::vector<double> frameMs;
+		frameMs.reserve(frames);
+		double cpuMs = 0.0;
+		long long drawCalls = 0, stateChanges = 0, unsortedDrawCalls = 0, unsortedStateChanges = 0;
+		size_t bytesUploaded = 0;
+		char label[64];
+		int labelLength = std::snprintf(label, sizeof(label), "%zu sprites", count);
+
+		glFinish();
+		Uint64 runStart = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < frames; ++frame) {
+			Uint64 start = SDL_GetPerformanceCounter();
+			glClear(GL_COLOR_BUFFER_BIT);
+
+			if (layer)
+				drawAnimatedSprites(*layer, (frame + 1) * deltaTime);
+			else {
+				beginSpriteBatch(batch);
+				buildSpriteFrame(jobs, spriteFrame, batch);
+				endSpriteBatch(batch, &jobs);
+			}
+
+			beginText(text);
+			drawText(text, std::string_view(label, labelLength), -396.0f, 280.0f, 16.0f, glm::vec4(1.0f));
+			endText(text);
+			cpuMs += secondsSince(start) * 1000.0;
+
+			// Swap and wait so every frame pays for its own GPU work
+			SDL_GL_SwapWindow(window);
+			glFinish();
+			frameMs.push_back(secondsSince(start) * 1000.0);
+
+			if (layer) {
+				drawCalls += layer->stats.drawCalls + text.stats.drawCalls;
+				stateChanges += layer->stats.stateChanges + text.stats.stateChanges;
+				bytesUploaded += layer->stats.bytesUploaded + text.stats.bytesUploaded;
+			}
+			else {
+				drawCalls += batch.stats.drawCalls + text.stats.drawCalls;
+				stateChanges += batch.stats.stateChanges + text.stats.stateChanges;
+				bytesUploaded += batch.stats.bytesUploaded + text.stats.bytesUploaded;
+				unsortedDrawCalls += batch.stats.unsortedDrawCalls + text.stats.drawCalls;
+				unsortedStateChanges += batch.stats.unsortedStateChanges + text.stats.stateChanges;
+			}
+		}
+		double totalSeconds = secondsSince(runStart);
+
+		std::vector<double> sorted = frameMs;
+		std::sort(sorted.begin(), sorted.end());
+		double averageMs = totalSeconds * 1000.0 / frames;
+		std::cout << std::fixed << std::setprecision(2) << std::setw(10) << count << std::setw(8) << frames << std::setw(10) << frames / totalSeconds
+			<< std::setprecision(3) << std::setw(9) << averageMs << std::setw(9) << percentile(sorted, 0.5) << std::setw(9) << percentile(sorted, 0.95)
+			<< std::setw(9) << percentile(sorted, 0.99) << std::setw(9) << sorted.back() << std::setw(9) << cpuMs / frames
+			<< std::setprecision(1) << std::setw(8) << (double)drawCalls / frames << std::setw(9) << (double)stateChanges / frames
+			<< std::setprecision(0) << std::setw(12) << (double)bytesUploaded / frames;
+		if (!layer)
+			std::cout << std::setprecision(1) << std::setw(10) << (double)unsortedDrawCalls / frames << (double)unsortedStateChanges / frames;
+		std::cout << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+}
+
+void runJobSystemBenchmark() {
+	const size_t count = 1000000;
+	const int frames = 30;
+	const float deltaTime = 1.0f / 60.0f;
+
+	// Stand-ins for the enemy and asteroid sheets, no GL needed. They are scattered over twice the view in
+	// each direction, so about three in four are culled.
+	std::vector<SpriteAnimation> templates;
+	for (GLuint texture = 1; texture <= 7; ++texture)
+		templates.push_back(SpriteAnimation(texture, 1 + texture % 4, 4 + texture % 5, 0.1f, 32.0f + 8.0f * texture, 32.0f, 0.0f, 0.0f));
+	std::vector<int> picks;
+	std::vector<SpriteAnimation> sprites = spawnSprites(templates, count, &picks);
+	for (SpriteAnimation& sprite : sprites) {
+		sprite.x *= 2.0f;
+		sprite.y *= 2.0f;
+	}
+	std::vector<SpriteAnimation> reference = sprites;
+	std::vector<GLuint> textures = templateTextures(templates);
+	const glm::vec4 view(-400.0f, -300.0f, 400.0f, 300.0f);
+	std::vector<SpriteInstance> sorted(count), expected(count);
+	size_t expectedCount = 0;
+
+	std::vector<uint64_t> keys;
+	for (int pick : picks)
+		keys.push_back(templateKey(templates, textures, pick));
+
+	// Plain loop on one thread: tick, cull and queue each sprite, sort by key at the end
+	AnimationStore times;
+	for (const SpriteAnimation& sprite : sprites)
+		addAnimation(times, sprite);
+	SpriteBatch batch;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int frame = 0; frame < frames; ++frame) {
+		updateAnimations(times, deltaTime);
+		beginSpriteBatch(batch);
+		for (GLuint texture : textures)
+			spriteTextureSlot(batch, texture);
+		for (size_t i = 0; i < reference.size(); ++i) {
+			SpriteAnimation& sprite = reference[i];
+			if (sprite.x + sprite.width * 0.5f < view.x || sprite.x - sprite.width * 0.5f > view.z
+				|| sprite.y + sprite.height * 0.5f < view.y || sprite.y - sprite.height * 0.5f > view.w)
+				continue;
+			sprite.currentFrame = times.currentFrame[i];
+			glm::vec4 uv = getFrameUV(sprite);
+			drawSprite(batch, sprite.textureID, { sprite.x, sprite.y, sprite.width, sprite.height, uv.x, uv.y, uv.z, uv.w },
+				renderKeyLayer(keys[i]), renderKeyBlend(keys[i]));
+		}
+		expectedCount = sortSpriteBatch(batch, expected.data());
+	}
+	double serialMs = secondsSince(start) * 1000.0 / frames;
+	std::cout << count << " sprites, " << expectedCount << " visible, " << frames << " frames, "
+		<< batch.queue.stats.passes << " radix passes" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "  serial loop:   " << serialMs << " ms/frame" << std::endl;
+
+	// The same frame through the job system: animation, cull and fill jobs, then the chunked radix sort
+	const int threadCounts[] = { 1, 2, 4, 8 };
+	for (int threads : threadCounts) {
+		AnimationStore jobTimes;
+		for (const SpriteAnimation& sprite : sprites)
+			addAnimation(jobTimes, sprite);
+		std::vector<SpriteAnimation> jobSprites = sprites;
+		SpriteFrame spriteFrame = makeSpriteFrame(jobSprites, jobTimes, templates, picks, view, deltaTime);
+
+		JobSystem jobs;
+		initJobSystem(jobs, threads - 1);
+		size_t kept = 0;
+		start = SDL_GetPerformanceCounter();
+		for (int frame = 0; frame < frames; ++frame) {
+			beginSpriteBatch(batch);
+			buildSpriteFrame(jobs, spriteFrame, batch);
+			kept = sortSpriteBatch(batch, sorted.data(), &jobs);
+		}
+		double jobMs = secondsSince(start) * 1000.0 / frames;
+		size_t steals = jobs.stats.steals.load(), jobCount = jobs.stats.jobs.load();
+		destroyJobSystem(jobs);
+
+		bool matches = kept == expectedCount;
+		for (size_t i = 0; matches && i < kept; ++i) {
+			const SpriteInstance& a = sorted[i];
+			const SpriteInstance& b = expected[i];
+			matches = a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height
+				&& a.u0 == b.u0 && a.v0 == b.v0 && a.u1 == b.u1 && a.v1 == b.v1;
+		}
+		std::cout << "  " << threads << " thread(s):   " << jobMs << " ms/frame (" << serialMs / jobMs << "x), "
+			<< (double)jobCount / frames << " jobs/frame, " << (double)steals / frames << " steals/frame"
+			<< (matches ? "" : " MISMATCH") << std::endl;
+	}
+	std::cout.unsetf(std::ios::fixed);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <glad/glad.h>
+#include <SDL.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "SpriteAnimation.h"
+#include "SpriteBatch.h"
+#include "AnimatedSprites.h"
+#include "TextRenderer.h"
+#include "TexturePack.h"
+#include "JobSystem.h"
+
+// Compare the per-sprite draw loop with the instanced sprite batch at 1k/10k/100k sprites
+void runSpriteBatchBenchmark(SpriteBatch& batch, const ShaderProgram& shaderProgram, GLuint VAO, GLuint VBO, float* vertices, size_t verticesSize,
+	const std::vector<SpriteAnimation>& templates);
+
+// Time uploading every texture in the pack against decoding and keying its source image
+void runStartupBenchmark(const TexturePack& pack, const char* sourceDir, const glm::vec3& colorKey);
+
+// Play a run of level changes where each level needs its own set of sheets, some shared with others,
+// through the texture cache with no reuse, a budget smaller than all the sheets and no budget; reports
+// loads, cache hits, evictions and peak texture memory per budget
+void runTextureCacheBenchmark(const TexturePack& pack, const glm::vec3& colorKey);
+
+// Block compress the largest sheets and a few sprite sheets with the scalar and SSE2 encoders on one thread
+// and the SSE2 one on every core, check both write the same blocks, and report PSNR, VRAM with mips and
+// upload time against RGBA8 with glGenerateMipmap
+void runTextureCompressionBenchmark(const glm::vec3& colorKey);
+
+// Time the stb_image + color key loop path against each fused BMP kernel on the largest sheets
+void runBmpDecodeBenchmark(const glm::vec3& colorKey);
+
+// Tick 1M animations with the per-object update, then the SoA store with each kernel
+void runAnimationBenchmark();
+
+// Update a full pool of 1M particles with each kernel, respawning the ones that die, and pack them as instances
+void runParticleBenchmark();
+
+// Find the colliding pairs among 1k to 100k moving entities with sort-and-sweep and with brute force
+void runBroadphaseBenchmark();
+
+// Build the collision masks of the ship, missile and asteroid sheets, then time the exact overlap test
+// with each kernel on random overlapping frame pairs and check it against a per-pixel reference
+void runCollisionMaskBenchmark(const glm::vec3& colorKey);
+
+// Despawn and respawn a tenth of 1k to 100k entities every frame, held as values in a vector and in a
+// generational pool, and count reallocations and stale handles caught
+void runObjectPoolBenchmark();
+
+// Tick 100k entities of mixed archetypes (movement, animation, health) stored as one fused struct per
+// entity, then in the archetype ECS on the calling thread and on the worker threads
+void runEcsBenchmark();
+
+// Tick, cull and queue 1M sprites per frame and sort them by render key, as a plain loop on one thread and
+// split over the job system with 1, 2, 4 and 8 threads; the jobs must produce the loop's instances
+void runJobSystemBenchmark();
+
+// Query the visible set of 1k to 1M moving entities with the loose quadtree against a linear scan,
+// including the cost of building the tree and of the incremental updates
+void runCullingBenchmark();
+
+// Render each count of animated sprites from the templates for a fixed number of frames and report
+// fps, frame time percentiles, CPU submit time, draw calls, state changes and bytes uploaded per frame,
+// and the draws and state changes the batch would need without sorting its commands.
+// With a layer the sprites are animated on the GPU instead of ticked and batched every frame, otherwise
+// ticking, culling and filling the batch are split over the job system. Run it with vsync off; the
+// camera buffer must already hold the view.
+void runSpriteStressBenchmark(SpriteBatch& batch, TextRenderer& text, AnimatedSpriteLayer* layer, const std::vector<SpriteAnimation>& templates,
+	const std::vector<size_t>& counts, int frames, SDL_Window* window, JobSystem& jobs);
@@ -0,0 +1,157 @@
+#include "BmpDecoder.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "CpuFeatures.h"
+
+// Converts one row of width pixels; key is the keyed color as R | G << 8 | B << 16, or ~0 to disable keying
+typedef void (*BmpRowKernel)(const unsigned char* src, unsigned char* dst, int width, uint32_t key);
+
+static inline uint32_t readU16(const unsigned char* p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static inline uint32_t readU32(const unsigned char* p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void convertRowScalar(const unsigned char* src, unsigned char* dst, int width, uint32_t key) {
+	for (int x = 0; x < width; ++x, src += 3, dst += 4) {
+		uint32_t rgb = (uint32_t)src[2] | ((uint32_t)src[1] << 8) | ((uint32_t)src[0] << 16);
+		if (rgb == key) {
+			std::memset(dst, 0, 4);
+		}
+		else {
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = 255;
+		}
+	}
+}
+
+#ifdef CPU_X86
+
+static inline int32_t loadPixel(const unsigned char* p) {
+	int32_t value;
+	std::memcpy(&value, p, 4);
+	return value;
+}
+
+// 4 pixels per step; SSE2 has no byte shuffle, so B and R are swapped with shifts inside 32-bit lanes
+static void convertRowSSE2(const unsigned char* src, unsigned char* dst, int width, uint32_t key) {
+	const __m128i lowByte = _mm_set1_epi32(0xFF);
+	const __m128i midByte = _mm_set1_epi32(0xFF00);
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	const __m128i keyVector = _mm_set1_epi32((int)key);
+
+	int x = 0;
+	// Each lane load reads one byte past its pixel, so stop one pixel early
+	for (; x + 5 <= width; x += 4, src += 12, dst += 16) {
+		__m128i bgr = _mm_set_epi32(loadPixel(src + 9), loadPixel(src + 6), loadPixel(src + 3), loadPixel(src));
+		__m128i r = _mm_and_si128(_mm_srli_epi32(bgr, 16), lowByte);
+		__m128i g = _mm_and_si128(bgr, midByte);
+		__m128i b = _mm_slli_epi32(_mm_and_si128(bgr, lowByte), 16);
+		__m128i rgb = _mm_or_si128(_mm_or_si128(r, g), b);
+		__m128i keyed = _mm_cmpeq_epi32(rgb, keyVector);
+		__m128i rgba = _mm_andnot_si128(keyed, _mm_or_si128(rgb, alpha));
+		_mm_storeu_si128((__m128i*)dst, rgba);
+	}
+	convertRowScalar(src, dst, width - x, key);
+}
+
+// 8 pixels per step, each 128-bit half shuffles 12 bytes of BGR into 16 bytes of RGBA
+TARGET_AVX2 static void convertRowAVX2(const unsigned char* src, unsigned char* dst, int width, uint32_t key) {
+	const __m256i shuffle = _mm256_setr_epi8(
+		2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+		2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+	const __m256i keyVector = _mm256_set1_epi32((int)key);
+
+	int x = 0;
+	// The upper 16-byte load runs 4 bytes past the 24 we use, so keep 2 pixels in hand
+	for (; x + 10 <= width; x += 8, src += 24, dst += 32) {
+		__m128i low = _mm_loadu_si128((const __m128i*)src);
+		__m128i high = _mm_loadu_si128((const __m128i*)(src + 12));
+		__m256i bgr = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+		__m256i rgb = _mm256_shuffle_epi8(bgr, shuffle);
+		__m256i keyed = _mm256_cmpeq_epi32(rgb, keyVector);
+		__m256i rgba = _mm256_andnot_si256(keyed, _mm256_or_si256(rgb, alpha));
+		_mm256_storeu_si256((__m256i*)dst, rgba);
+	}
+	convertRowScalar(src, dst, width - x, key);
+}
+
+#endif
+
+BmpKernel bestBmpKernel() {
+#ifdef CPU_X86
+	static const BmpKernel best = cpuHasAVX2() ? BMP_KERNEL_AVX2 : BMP_KERNEL_SSE2;
+	return best;
+#else
+	return BMP_KERNEL_SCALAR;
+#endif
+}
+
+const char* bmpKernelName(BmpKernel kernel) {
+	switch (kernel == BMP_KERNEL_BEST ? bestBmpKernel() : kernel) {
+	case BMP_KERNEL_SSE2: return "SSE2";
+	case BMP_KERNEL_AVX2: return "AVX2";
+	default: return "scalar";
+	}
+}
+
+static BmpRowKernel rowKernel(BmpKernel kernel) {
+	if (kernel == BMP_KERNEL_BEST)
+		kernel = bestBmpKernel();
+#ifdef CPU_X86
+	// Never hand out a kernel the CPU can't run, even if asked for it
+	if (kernel == BMP_KERNEL_AVX2 && bestBmpKernel() == BMP_KERNEL_AVX2)
+		return convertRowAVX2;
+	if (kernel == BMP_KERNEL_SSE2 || kernel == BMP_KERNEL_AVX2)
+		return convertRowSSE2;
+#endif
+	return convertRowScalar;
+}
+
+unsigned char* decodeBmp24(const unsigned char* file, size_t size, const glm::vec3& colorKey, bool applyColorKey,
+	int& width, int& height, BmpKernel kernel) {
+	// BITMAPFILEHEADER (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes)
+	if (size < 54 || file[0] != 'B' || file[1] != 'M')
+		return NULL;
+
+	uint32_t dataOffset = readU32(file + 10);
+	uint32_t headerSize = readU32(file + 14);
+	int32_t fileWidth = (int32_t)readU32(file + 18);
+	int32_t fileHeight = (int32_t)readU32(file + 22);
+	uint32_t bitsPerPixel = readU16(file + 28);
+	uint32_t compression = readU32(file + 30);
+	if (headerSize < 40 || bitsPerPixel != 24 || compression != 0 || fileWidth <= 0 || fileHeight == 0 || fileHeight == INT32_MIN)
+		return NULL;
+
+	// Rows are stored bottom-up unless the height is negative, GL wants bottom-up
+	bool topDown = fileHeight < 0;
+	width = fileWidth;
+	height = topDown ? -fileHeight : fileHeight;
+	size_t stride = ((size_t)width * 3 + 3) & ~(size_t)3;
+	if (dataOffset > size || stride * height > size - dataOffset)
+		return NULL;
+
+	unsigned char* image = (unsigned char*)std::malloc((size_t)width * height * 4);
+	if (!image)
+		return NULL;
+
+	uint32_t key = 0xFFFFFFFF;
+	if (applyColorKey) {
+		key = (uint32_t)static_cast<unsigned char>(colorKey.r) |
+			((uint32_t)static_cast<unsigned char>(colorKey.g) << 8) |
+			((uint32_t)static_cast<unsigned char>(colorKey.b) << 16);
+	}
+
+	BmpRowKernel convertRow = rowKernel(kernel);
+	for (int y = 0; y < height; ++y) {
+		int srcRow = topDown ? height - 1 - y : y;
+		convertRow(file + dataOffset + stride * srcRow, image + (size_t)y * width * 4, width, key);
+	}
+	return image;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// Row converters for 24-bit BMPs, picked at runtime from what the CPU supports
+enum BmpKernel {
+	BMP_KERNEL_SCALAR,
+	BMP_KERNEL_SSE2,
+	BMP_KERNEL_AVX2,
+	BMP_KERNEL_BEST
+};
+
+// Best kernel this CPU can run
+BmpKernel bestBmpKernel();
+
+// Printable name of a kernel
+const char* bmpKernelName(BmpKernel kernel);
+
+// Decode an uncompressed 24-bit BMP in one pass: BGR to premultiplied RGBA, rows bottom to top, color key applied.
+// Returns NULL for anything else so the caller can fall back to stb_image. Free the result with freeImage.
+unsigned char* decodeBmp24(const unsigned char* file, size_t size, const glm::vec3& colorKey, bool applyColorKey,
+	int& width, int& height, BmpKernel kernel = BMP_KERNEL_BEST);
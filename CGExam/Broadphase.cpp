@@ -0,0 +1,98 @@
+#include "Broadphase.h"
+#include <algorithm>
+
+int addCollisionProxy(SweepAndPrune& sap, const QuadtreeBounds& bounds, unsigned int layer, unsigned int mask) {
+	int proxy;
+	if (!sap.freeProxies.empty()) {
+		proxy = sap.freeProxies.back();
+		sap.freeProxies.pop_back();
+	}
+	else {
+		proxy = (int)sap.proxies.size();
+		sap.proxies.push_back(BroadphaseProxy());
+	}
+	sap.proxies[proxy] = { bounds, layer, mask, true };
+
+	// New entries go on the end, the next findCollisionPairs sorts and merges them in
+	sap.entries.push_back({ bounds, layer, mask, proxy });
+	sap.newEntries++;
+	return proxy;
+}
+
+void moveCollisionProxy(SweepAndPrune& sap, int proxy, const QuadtreeBounds& bounds) {
+	sap.proxies[proxy].bounds = bounds;
+}
+
+void removeCollisionProxy(SweepAndPrune& sap, int proxy) {
+	sap.proxies[proxy].active = false;
+	sap.removedProxies.push_back(proxy);
+}
+
+static bool sweepEntryLess(const SweepEntry& a, const SweepEntry& b) {
+	return a.bounds.minX < b.bounds.minX;
+}
+
+void findCollisionPairs(SweepAndPrune& sap, std::vector<CollisionPair>& pairs) {
+	sap.stats = BroadphaseStats();
+	pairs.clear();
+
+	// Drop removed entries, keeping the order, then pull the latest bounds in
+	size_t sorted = sap.entries.size() - sap.newEntries;
+	if (!sap.removedProxies.empty()) {
+		size_t kept = 0, keptSorted = 0;
+		for (size_t i = 0; i < sap.entries.size(); ++i) {
+			if (i == sorted)
+				keptSorted = kept;
+			if (sap.proxies[sap.entries[i].proxy].active)
+				sap.entries[kept++] = sap.entries[i];
+		}
+		sorted = sorted == sap.entries.size() ? kept : keptSorted;
+		sap.entries.resize(kept);
+		sap.freeProxies.insert(sap.freeProxies.end(), sap.removedProxies.begin(), sap.removedProxies.end());
+		sap.removedProxies.clear();
+	}
+	for (SweepEntry& entry : sap.entries) {
+		const BroadphaseProxy& proxy = sap.proxies[entry.proxy];
+		entry.bounds = proxy.bounds;
+		entry.layer = proxy.layer;
+		entry.mask = proxy.mask;
+	}
+
+	// Insertion sort of the entries that were already in order, linear when little moved since the last frame
+	SweepEntry* entries = sap.entries.data();
+	size_t count = sap.entries.size();
+	for (size_t i = 1; i < sorted; ++i) {
+		SweepEntry entry = entries[i];
+		size_t j = i;
+		while (j > 0 && entries[j - 1].bounds.minX > entry.bounds.minX) {
+			entries[j] = entries[j - 1];
+			--j;
+		}
+		if (j != i) {
+			entries[j] = entry;
+			sap.stats.swaps += i - j;
+		}
+	}
+
+	// New entries have no order to keep, sort them outright and merge them in
+	if (sorted < count) {
+		std::sort(entries + sorted, entries + count, sweepEntryLess);
+		std::inplace_merge(entries, entries + sorted, entries + count, sweepEntryLess);
+		sap.stats.added = count - sorted;
+	}
+	sap.newEntries = 0;
+
+	// Sweep: everything starting before an entry ends on x overlaps it on x
+	for (size_t i = 0; i < count; ++i) {
+		const SweepEntry& a = entries[i];
+		for (size_t j = i + 1; j < count && entries[j].bounds.minX <= a.bounds.maxX; ++j) {
+			const SweepEntry& b = entries[j];
+			if (!layersCollide(a.layer, a.mask, b.layer, b.mask))
+				continue;
+			sap.stats.pairsTested++;
+			if (a.bounds.minY <= b.bounds.maxY && a.bounds.maxY >= b.bounds.minY)
+				pairs.push_back({ std::min(a.proxy, b.proxy), std::max(a.proxy, b.proxy) });
+		}
+	}
+	sap.stats.pairs = pairs.size();
+}
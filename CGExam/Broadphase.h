@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Quadtree.h"
+
+// What an entity is, as a bit so a mask can name several
+enum CollisionLayer {
+	COLLISION_LAYER_PLAYER = 1 << 0,
+	COLLISION_LAYER_PLAYER_SHOT = 1 << 1,
+	COLLISION_LAYER_ENEMY = 1 << 2,
+	COLLISION_LAYER_ENEMY_SHOT = 1 << 3,
+	COLLISION_LAYER_ASTEROID = 1 << 4,
+	COLLISION_LAYER_PICKUP = 1 << 5
+};
+
+// Two proxies whose bounds overlap and whose layers want to hear about it, a < b
+struct CollisionPair {
+	int a, b;
+};
+
+// One entity in sweep order, bounds and layers are copied in so the sweep reads a single array
+struct SweepEntry {
+	QuadtreeBounds bounds;
+	unsigned int layer, mask;
+	int proxy;
+};
+
+struct BroadphaseProxy {
+	QuadtreeBounds bounds;
+	unsigned int layer;  // CollisionLayer bit of the entity
+	unsigned int mask;   // Layers it collides with
+	bool active;
+};
+
+// Counters of the last findCollisionPairs
+struct BroadphaseStats {
+	size_t swaps;        // Insertion sort moves, small when entities move little between frames
+	size_t pairsTested;  // Overlaps checked on y after passing on x
+	size_t pairs;
+	size_t added;        // Entries sorted in from scratch because they were new
+};
+
+// Sort-and-sweep broadphase. Entries stay sorted on minX between frames, so re-sorting after movement
+// is an insertion sort over an almost sorted list instead of a full sort. Entries added since the last
+// frame are sorted on their own and merged in, so a bulk add doesn't make the insertion sort quadratic.
+struct SweepAndPrune {
+	std::vector<BroadphaseProxy> proxies;  // Indexed by proxy id
+	std::vector<int> freeProxies;
+	std::vector<int> removedProxies;       // Still have an entry in the list, their ids are freed once it's gone
+	std::vector<SweepEntry> entries;       // Sorted on bounds.minX after findCollisionPairs
+	size_t newEntries;                     // Added since the last findCollisionPairs, at the end of entries
+	BroadphaseStats stats;
+};
+
+// Add an entity and return its proxy id
+int addCollisionProxy(SweepAndPrune& sap, const QuadtreeBounds& bounds, unsigned int layer, unsigned int mask);
+
+// Update an entity's bounds, picked up by the next findCollisionPairs
+void moveCollisionProxy(SweepAndPrune& sap, int proxy, const QuadtreeBounds& bounds);
+
+// Remove an entity, its id may be handed out again
+void removeCollisionProxy(SweepAndPrune& sap, int proxy);
+
+// Re-sort on x and replace pairs with every overlapping pair where either side's mask has the other's layer
+void findCollisionPairs(SweepAndPrune& sap, std::vector<CollisionPair>& pairs);
+
+// Whether two entities' layers and masks let them collide
+inline bool layersCollide(unsigned int layerA, unsigned int maskA, unsigned int layerB, unsigned int maskB) {
+	return (layerA & maskB) != 0 || (layerB & maskA) != 0;
+}
@@ -1,33 +1,45 @@
 #include <iostream>
 #include <glad/glad.h>
 #include <SDL.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
-
-// Structure to hold information about an animated sprite
-struct SpriteAnimation {
-	GLuint textureID;
-	int rows, columns, frameCount, currentFrame;
-	float frameDuration, elapsedTime;
-	float width, height;
-	float x, y;  // Position on the screen
-
-	SpriteAnimation(GLuint texID, int r, int c, float duration, float frameWidth, float frameHeight, float posX, float posY)
-		: textureID(texID), rows(r), columns(c), frameCount(r* c), currentFrame(0),
-		frameDuration(duration), elapsedTime(0.0f), width(frameWidth), height(frameHeight),
-		x(posX), y(posY) {}
-};
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "GLUtils.h"
+#include "ShaderProgram.h"
+#include "SpriteAnimation.h"
+#include "AnimationStore.h"
+#include "SpriteBatch.h"
+#include "AnimatedSprites.h"
+#include "Quadtree.h"
+#include "Tilemap.h"
+#include "Particles.h"
+#include "CollisionMask.h"
+#include "Broadphase.h"
+#include "ObjectPool.h"
+#include "Ecs.h"
+#include "SceneSystems.h"
+#include "JobSystem.h"
+#include "TextRenderer.h"
+#include "TextureAtlas.h"
+#include "TexturePack.h"
+#include "TextureLoader.h"
+#include "TextureCache.h"
+#include "Benchmarks.h"
+#include "FrameScheduler.h"
+#include "Headless.h"
+#include "Profiler.h"
 
 // Shader source code
-const char* vertexShaderSource = R"(#version 330 core
+const char* vertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
     layout (location = 0) in vec2 position;
     layout (location = 1) in vec2 texCoord;
     out vec2 TexCoord;
-    uniform mat4 model, view, projection;
+    uniform mat4 model;
     void main() {
         TexCoord = texCoord;
         gl_Position = projection * view * model * vec4(position, 0.0, 1.0);
@@ -41,180 +53,119 @@ const char* fragmentShaderSource = R"(#version 330 core
         FragColor = texture(texture1, TexCoord);
     })";
 
-// Compile shader and handle errors
-GLuint compileShader(const char* source, GLenum shaderType) {
-	GLuint shader = glCreateShader(shaderType);
-	glShaderSource(shader, 1, &source, NULL);
-	glCompileShader(shader);
-
-	GLint success;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetShaderInfoLog(shader, 512, NULL, infoLog);
-		std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-	return shader;
-}
-
-// Link shaders into a program
-GLuint linkShaderProgram(GLuint vertexShader, GLuint fragmentShader) {
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glLinkProgram(shaderProgram);
-
-	GLint success;
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success) {
-		GLchar infoLog[512];
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-	}
-
-	return shaderProgram;
-}
-
-// Load texture with color keying
-GLuint loadTexture(const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
-	stbi_set_flip_vertically_on_load(true);
-	int width, height, channels;
-	unsigned char* image = stbi_load(filepath, &width, &height, &channels, STBI_rgb_alpha);
-	if (!image) {
-		std::cerr << "Failed to load texture: " << filepath << ". Reason: " << stbi_failure_reason() << std::endl;
-		return 0;
-	}
-	//runs all pixels to see which have pink rgb to set it transparent
-	if (applyColorKey) {
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				int index = (y * width + x) * 4;
-				if (image[index] == static_cast<unsigned char>(colorKey.r) &&
-					image[index + 1] == static_cast<unsigned char>(colorKey.g) &&
-					image[index + 2] == static_cast<unsigned char>(colorKey.b)) {
-					image[index + 3] = 0; // Make the color transparent
-				}
+int main(int argc, char* args[]) {
+	bool benchBatch = false;
+	bool benchStartup = false;
+	bool benchTextures = false;
+	bool benchCompress = false;
+	std::vector<size_t> stressCounts;
+	int stressFrames = 300;
+	bool usePack = true;
+	bool compressTextures = true;
+	bool vsync = true;
+	bool frameStats = false;
+	bool gpuAnimation = false;
+	double tickRate = 120.0;
+	HeadlessRun headless = HeadlessRun();
+	bool showProfile = false;
+	const char* profileCsv = NULL;
+	int loaderThreads = defaultLoaderThreads();
+	int workerThreads = defaultWorkerThreads();
+	size_t textureBudget = (size_t)256 << 20;
+	for (int i = 1; i < argc; ++i) {
+		if (parseHeadlessArg(headless, argc, args, i))
+			continue;
+		if (std::strcmp(args[i], "--bench-batch") == 0)
+			benchBatch = true;
+		else if (std::strcmp(args[i], "--bench-startup") == 0)
+			benchStartup = true;
+		else if (std::strcmp(args[i], "--bench-textures") == 0)
+			benchTextures = true;
+		else if (std::strcmp(args[i], "--bench-compress") == 0)
+			benchCompress = true;
+		else if (std::strcmp(args[i], "--bench-sprites") == 0 && i + 1 < argc) {
+			// Comma separated sprite counts, e.g. 1000,10000,100000,1000000
+			for (char* count = args[++i]; *count; ) {
+				char* end;
+				size_t value = std::strtoull(count, &end, 10);
+				if (value > 0)
+					stressCounts.push_back(value);
+				count = *end ? end + 1 : end;
 			}
 		}
+		else if (std::strcmp(args[i], "--bench-frames") == 0 && i + 1 < argc)
+			stressFrames = std::max(1, std::atoi(args[++i]));
+		else if (std::strcmp(args[i], "--no-pack") == 0)
+			usePack = false;
+		else if (std::strcmp(args[i], "--no-compress") == 0)
+			compressTextures = false;
+		else if (std::strcmp(args[i], "--threads") == 0 && i + 1 < argc)
+			loaderThreads = std::max(1, std::atoi(args[++i]));
+		else if (std::strcmp(args[i], "--workers") == 0 && i + 1 < argc)
+			workerThreads = std::max(0, std::atoi(args[++i]));
+		else if (std::strcmp(args[i], "--texture-budget") == 0 && i + 1 < argc)
+			textureBudget = (size_t)std::max(0, std::atoi(args[++i])) << 20;  // MB, 0 for no limit
+		else if (std::strcmp(args[i], "--tick-rate") == 0 && i + 1 < argc)
+			tickRate = std::max(1.0, std::atof(args[++i]));
+		else if (std::strcmp(args[i], "--no-vsync") == 0)
+			vsync = false;
+		else if (std::strcmp(args[i], "--frame-stats") == 0)
+			frameStats = true;
+		else if (std::strcmp(args[i], "--gpu-anim") == 0)
+			gpuAnimation = true;
+		else if (std::strcmp(args[i], "--profile") == 0)
+			showProfile = true;
+		else if (std::strcmp(args[i], "--profile-csv") == 0 && i + 1 < argc)
+			profileCsv = args[++i];
+		else if (std::strcmp(args[i], "--bench-bmp") == 0) {
+			// CPU only, no window needed
+			runBmpDecodeBenchmark(glm::vec3(255, 0, 255));
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-anim") == 0) {
+			runAnimationBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-particles") == 0) {
+			runParticleBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-broadphase") == 0) {
+			runBroadphaseBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-ecs") == 0) {
+			runEcsBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-jobs") == 0) {
+			runJobSystemBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-pools") == 0) {
+			runObjectPoolBenchmark();
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-masks") == 0) {
+			runCollisionMaskBenchmark(glm::vec3(255, 0, 255));
+			return 0;
+		}
+		else if (std::strcmp(args[i], "--bench-cull") == 0) {
+			runCullingBenchmark();
+			return 0;
+		}
 	}
 
-	GLuint texture;
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	stbi_image_free(image);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	return texture;
-}
-
-// Update sprite animation frame
-void updateSpriteAnimation(SpriteAnimation& animation, float deltaTime) {
-	animation.elapsedTime += deltaTime;
-	if (animation.elapsedTime >= animation.frameDuration) {
-		animation.currentFrame = (animation.currentFrame + 1) % animation.frameCount;
-		animation.elapsedTime = 0.0f;
-	}
-}
-
-// Update texture coordinates for a sprite animation
-void updateTextureCoords(SpriteAnimation& animation, float* vertices) {
-	//Determine current frame row and column
-	int frameRow = animation.currentFrame / animation.columns;
-	int frameCol = animation.currentFrame % animation.columns;
-
-	//calculate size of each frame in text coord
-	float uSize = 1.0f / animation.columns;
-	float vSize = 1.0f / animation.rows;
-
-	//calculate the text coord of the current frame
-	float frameU = frameCol * uSize;
-	float frameV = 1.0f - ((frameRow + 1) * vSize);
-
-	//update text coord in the vertex array
-	vertices[2] = frameU;           vertices[3] = frameV;           // Bottom-Left
-	vertices[6] = frameU + uSize;   vertices[7] = frameV;           // Bottom-Right
-	vertices[10] = frameU + uSize;  vertices[11] = frameV + vSize;  // Top-Right
-	vertices[14] = frameU;          vertices[15] = frameV + vSize;  // Top-Left
-}
-
-// Render any textured object (in this case for the animations and background)
-void renderObject(GLuint VAO, GLuint texture, const glm::mat4& model, GLuint shaderProgram, const glm::mat4& view, const glm::mat4& projection) {
-	glUseProgram(shaderProgram);
-
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-}
-
-// Render text using the sprite sheet
-void RenderText(GLuint shaderProgram, GLuint texture, std::string text, float x, float y, float scale, glm::vec3 color, GLuint VAO, GLuint VBO, int charWidth, int charHeight, int textureWidth, int textureHeight) {
-	//setup the shader program and texture
-	glUseProgram(shaderProgram);
-	glUniform3f(glGetUniformLocation(shaderProgram, "textColor"), color.x, color.y, color.z);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-
-	glBindVertexArray(VAO);
-
-	//calculate normalized character dimensions
-	float charWidthNormalized = charWidth / (float)textureWidth;
-	float charHeightNormalized = charHeight / (float)textureHeight;
-
-	//loop through each char in the text string
-	for (char c : text) {
-		int ascii = c - 32;  // Offset to map to the correct glyph in the sprite sheet
-		int row = ascii / 8; // 8 columns per row
-		int col = ascii % 8;
-
-		//calculate txt coords for the char
-		float tx = col * charWidthNormalized;
-		float ty = 1.0f - (row + 1) * charHeightNormalized;  // Flip the texture vertically
-
-		//Define the vertex data for the char quad
-		float vertices[6][4] = {
-			{ x,                    y + charHeight * scale,   tx,                      ty + charHeightNormalized }, // Top-left
-			{ x,                    y,                        tx,                      ty },                        // Bottom-left
-			{ x + charWidth * scale, y,                        tx + charWidthNormalized,ty },                        // Bottom-right
-
-			{ x,                    y + charHeight * scale,   tx,                      ty + charHeightNormalized }, // Top-left
-			{ x + charWidth * scale, y,                        tx + charWidthNormalized,ty },                        // Bottom-right
-			{ x + charWidth * scale, y + charHeight * scale,   tx + charWidthNormalized,ty + charHeightNormalized }  // Top-right
-		};
-
-		//update the vertex buffer with the quad data
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-
-		//render the quad
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		x += charWidth * scale;
-	}
-
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-int main(int argc, char* args[]) {
-	// Initialize SDL
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+	// Initialize SDL, without a display in headless runs
+	bool videoReady = headless.frames > 0 ? initHeadlessVideo() : SDL_Init(SDL_INIT_VIDEO) == 0;
+	if (!videoReady) {
 		std::cerr << "SDL couldn't initialize: " << SDL_GetError() << std::endl;
 		return 1;
 	}
+	Uint64 startupCounter = SDL_GetPerformanceCounter();
 
 	// Create SDL window
-	SDL_Window* window = SDL_CreateWindow("CGExam Especial", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_OPENGL);
+	SDL_Window* window = SDL_CreateWindow("CGExam Especial", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 800, 600, SDL_WINDOW_OPENGL | (headless.frames > 0 ? SDL_WINDOW_HIDDEN : 0));
 	if (!window) {
 		std::cerr << "Window couldn't be created: " << SDL_GetError() << std::endl;
 		SDL_Quit();
@@ -230,13 +181,27 @@ int main(int argc, char* args[]) {
 		return 1;
 	}
 
-	// Compile and link shaders
-	GLuint vertexShader = compileShader(vertexShaderSource, GL_VERTEX_SHADER);
-	GLuint fragmentShader = compileShader(fragmentShaderSource, GL_FRAGMENT_SHADER);
-	GLuint shaderProgram = linkShaderProgram(vertexShader, fragmentShader);
+	// Present at the display rate instead of spinning as fast as the GPU allows; benchmarks measure with vsync off
+	bool benchmarkOnly = benchBatch || benchStartup || benchTextures || benchCompress || !stressCounts.empty();
+	if (benchmarkOnly)
+		SDL_GL_SetSwapInterval(0);
+	else if (vsync && headless.frames == 0 && SDL_GL_SetSwapInterval(-1) < 0)
+		SDL_GL_SetSwapInterval(1);
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	// Headless runs draw everything into an FBO instead of the hidden window
+	if (headless.frames > 0 && !beginHeadlessRun(headless, 800, 600, false)) {
+		SDL_GL_DeleteContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
+	}
+
+	// Compile and link shaders, uniform locations are cached on the program
+	ShaderProgram shaderProgram;
+	createShaderProgram(shaderProgram, vertexShaderSource, fragmentShaderSource);
+
+	// View/projection live in a uniform buffer shared by every program
+	GLuint cameraBuffer = createCameraBuffer();
 
 	// Vertices for a quad
 	float vertices[] = {
@@ -291,49 +256,87 @@ int main(int argc, char* args[]) {
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 	glEnableVertexAttribArray(1);
 
-	// Text rendering setup (separate VAO/VBO)
-	GLuint textVAO, textVBO;
-	glGenVertexArrays(1, &textVAO);
-	glGenBuffers(1, &textVBO);
-
-	glBindVertexArray(textVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-
 #pragma region LoadTextures
-	// Load textures
+	// Load textures, from the cooked pack when AssetCooker has been run
 	glm::vec3 colorKey(255, 0, 255);
-	GLuint backgroundTexture = loadTexture("../Assets/graphics/galaxy2.bmp", colorKey, false);
-
-	GLuint bgRockL = loadTexture("../Assets/graphics/BlocksB.bmp", colorKey, true);
-	GLuint bgRockR = loadTexture("../Assets/graphics/BlocksA.bmp", colorKey, true);
-
-	GLuint loner = loadTexture("../Assets/graphics/LonerA.bmp", colorKey, true);
-	GLuint loner2 = loadTexture("../Assets/graphics/LonerC.bmp", colorKey, true);
-	GLuint drone = loadTexture("../Assets/graphics/drone.bmp", colorKey, true);
-	GLuint rusher = loadTexture("../Assets/graphics/rusher.bmp", colorKey, true);
+	TexturePack pack = TexturePack();
+	if (usePack && !openTexturePack(pack, "../Assets/cooked/graphics.pack"))
+		std::cout << "No cooked texture pack, decoding source images" << std::endl;
+
+	if (benchStartup)
+		runStartupBenchmark(pack, "../Assets/graphics", colorKey);
+	if (benchTextures)
+		runTextureCacheBenchmark(pack, colorKey);
+	if (benchCompress)
+		runTextureCompressionBenchmark(colorKey);
+
+	// Images are decoded on worker threads and uploaded here as they finish
+	TextureLoader loader;
+	int backgroundRequest = requestTexture(loader, "../Assets/graphics/galaxy2.bmp", colorKey, false);
+
+	// The rock walls are a tilemap over the 32x32 block tileset
+	int blocksRequest = requestTexture(loader, "../Assets/graphics/Blocks.bmp", colorKey, true);
+
+	// Sprite sheets are packed into a texture atlas so the scene needs few texture binds
+	TextureAtlas atlas;
+	int loner = requestAtlasImage(loader, atlas, "../Assets/graphics/LonerA.bmp", colorKey, true);
+	int loner2 = requestAtlasImage(loader, atlas, "../Assets/graphics/LonerC.bmp", colorKey, true);
+	int drone = requestAtlasImage(loader, atlas, "../Assets/graphics/drone.bmp", colorKey, true);
+	int rusher = requestAtlasImage(loader, atlas, "../Assets/graphics/rusher.bmp", colorKey, true);
+
+	// The ship, missiles and asteroids keep a mask of their opaque pixels for exact hit tests
+	CollisionMask steelAsteroidMask, steelAsteroid2Mask, rockAsteroidMask, rockAsteroid2Mask, shipMask, missileMask, missile2Mask;
+
+	int steelAsteroid = requestAtlasImage(loader, atlas, "../Assets/graphics/MAster96.bmp", colorKey, true, &steelAsteroidMask);
+	int steelAsteroid2 = requestAtlasImage(loader, atlas, "../Assets/graphics/MAster64.bmp", colorKey, true, &steelAsteroid2Mask);
+	int rockAsteroid = requestAtlasImage(loader, atlas, "../Assets/graphics/SAster96.bmp", colorKey, true, &rockAsteroidMask);
+	int rockAsteroid2 = requestAtlasImage(loader, atlas, "../Assets/graphics/GAster96.bmp", colorKey, true, &rockAsteroid2Mask);
+
+	int ship = requestAtlasImage(loader, atlas, "../Assets/graphics/ShipIdle.bmp", colorKey, true, &shipMask);
+	int clone = requestAtlasImage(loader, atlas, "../Assets/graphics/clone.bmp", colorKey, true);
+	int shipJet = requestAtlasImage(loader, atlas, "../Assets/graphics/Burner1.bmp", colorKey, true);
+	int missile = requestAtlasImage(loader, atlas, "../Assets/graphics/missileA.bmp", colorKey, true, &missileMask);
+	int missile2 = requestAtlasImage(loader, atlas, "../Assets/graphics/missileB.bmp", colorKey, true, &missile2Mask);
+
+	int life = requestAtlasImage(loader, atlas, "../Assets/graphics/PULife.bmp", colorKey, true);
+
+	int explosion = requestAtlasImage(loader, atlas, "../Assets/graphics/explode32.bmp", colorKey, true);
+	int smoke = requestAtlasImage(loader, atlas, "../Assets/graphics/smoke.bmp", colorKey, true);
+	int dust = requestAtlasImage(loader, atlas, "../Assets/graphics/GDust.bmp", colorKey, true);
 
-	GLuint steelAsteroid = loadTexture("../Assets/graphics/MAster96.bmp", colorKey, true);
-	GLuint steelAsteroid2 = loadTexture("../Assets/graphics/MAster64.bmp", colorKey, true);
-	GLuint rockAsteroid = loadTexture("../Assets/graphics/SAster96.bmp", colorKey, true);
-	GLuint rockAsteroid2 = loadTexture("../Assets/graphics/GAster96.bmp", colorKey, true);
-
-	GLuint ship = loadTexture("../Assets/graphics/ShipIdle.bmp", colorKey, true);
-	GLuint clone = loadTexture("../Assets/graphics/clone.bmp", colorKey, true);
-	GLuint shipJet = loadTexture("../Assets/graphics/Burner1.bmp", colorKey, true);
-	GLuint missile = loadTexture("../Assets/graphics/missileA.bmp", colorKey, true);
-	GLuint missile2 = loadTexture("../Assets/graphics/missileB.bmp", colorKey, true);
+	// Load font texture for text rendering
+	int textRequest = requestTexture(loader, "../Assets/graphics/font16x16.bmp", colorKey, true);
+
+	loadTextures(loader, pack, loaderThreads);
+
+	// Standalone textures belong to the cache from here on, it frees them and counts their memory
+	TextureCache textureCache;
+	initTextureCache(textureCache, &pack, textureBudget);
+	TextureHandle backgroundHandle = adoptLoadedTexture(textureCache, loader.requests[backgroundRequest]);
+	TextureHandle textHandle = adoptLoadedTexture(textureCache, loader.requests[textRequest]);
+	TextureHandle blocksHandle = adoptLoadedTexture(textureCache, loader.requests[blocksRequest]);
+	GLuint backgroundTexture = cachedTextureID(textureCache, backgroundHandle);
+	GLuint textTexture = cachedTextureID(textureCache, textHandle);
+	GLuint blocksTexture = cachedTextureID(textureCache, blocksHandle);
+
+	// Sprite pages take the cooked BC1/BC3 blocks of each sheet as they are, --no-compress keeps them RGBA8
+	if (!buildTextureAtlas(atlas, 2048, 2, compressTextures, loaderThreads)) {
+		std::cerr << "Failed to build texture atlas" << std::endl;
+		destroyTextureAtlas(atlas);
+		destroyTextureCache(textureCache);
+		closeTexturePack(pack);
+		SDL_GL_DeleteContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
+	}
+	setPinnedTextureBytes(textureCache, textureAtlasBytes(atlas));
+	const std::vector<AtlasRegion>& sheets = atlas.regions;
 
-	GLuint life = loadTexture("../Assets/graphics/PULife.bmp", colorKey, true);
+	// The tilemap cuts its tiles out of the sheet as it was loaded
+	int blocksWidth = 0, blocksHeight = 0;
+	cachedTextureSize(textureCache, blocksHandle, blocksWidth, blocksHeight);
 
-	// Load font texture for text rendering
-	GLuint textTexture = loadTexture("../Assets/graphics/font16x16.bmp", colorKey, true);
 	int txtTextureWidth = 128;
 	int txtTextureHeight = 192;
 	const int charWidth = 16;
@@ -345,47 +348,150 @@ int main(int argc, char* args[]) {
 
 	// Create animations
 	std::vector<SpriteAnimation> animations = {
-		SpriteAnimation(bgRockL, 1, 1, 1.f, 1024.0f, 1024.0f, -150.0f, -290.0f),
-		SpriteAnimation(bgRockR, 1, 1, 1.f, 1024.0f, 1024.0f, 500.0f, -500.0f),
-
-		SpriteAnimation(loner, 4, 4, 0.1f, 64.0f, 64.0f, 0.0f, 150.0f),
-		SpriteAnimation(loner2, 4, 4, 0.1f, 64.0f, 64.0f, -60.f, 200.0f),
-		SpriteAnimation(loner, 4, 4, 0.1f, 64.0f, 64.0f, 60.f, 200.0f),
-		SpriteAnimation(loner2, 4, 4, 0.1f, 64.0f, 64.0f, -190.f, -100.0f),
-
-		SpriteAnimation(drone, 2, 8, 0.1f, 32.0f, 32.0f, 200.f, -120.0f),
-		SpriteAnimation(drone, 2, 8, 0.1f, 32.0f, 32.0f, 240.f, -100.0f),
-		SpriteAnimation(drone, 2, 8, 0.1f, 32.0f, 32.0f, 280.f, -120.0f),
-		SpriteAnimation(drone, 2, 8, 0.1f, 32.0f, 32.0f, 240.f, -140.0f),
-
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 200.0f),
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 170.0f),
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 140.0f),
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 110.0f),
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 80.0f),
-		SpriteAnimation(rusher, 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 50.0f),
-
-		SpriteAnimation(steelAsteroid, 5, 5, 0.2f, 64.0f, 64.0f, 150.0f, 50.0f),
-		SpriteAnimation(steelAsteroid2, 3, 8, 0.2f, 64.0f, 64.0f, 300.0f, 100.0f),
-		SpriteAnimation(rockAsteroid, 5, 5, 0.2f, 64.0f, 64.0f, 200.0f, 150.0f),
-		SpriteAnimation(rockAsteroid2, 5, 5, 0.2f, 64.0f, 64.0f, 300.0f, 220.0f),
-		SpriteAnimation(rockAsteroid2, 5, 5, 0.2f, 64.0f, 64.0f, -100.0f, 25.0f),
-
-		SpriteAnimation(clone, 4, 4, 0.1f, 32.0f, 32.0f, -50.0f, -200.0f),
-		SpriteAnimation(clone, 4, 4, 0.1f, 32.0f, 32.0f, 50.0f, -200.0f),
-
-		SpriteAnimation(ship, 1, 1, 1.f, 64.0f, 64.0f, 0.0f, -230.0f),
-		SpriteAnimation(shipJet, 1, 1, 1.f, 12.0f, 12.0f, -10.0f, -268.0f),
-		SpriteAnimation(shipJet, 1, 1, 1.f, 12.0f, 12.0f, 10.0f, -268.0f),
-
-		SpriteAnimation(missile, 1, 1, 0.1f, 65.0f, 64.0f, -35.0f, -150.0f),
-		SpriteAnimation(missile, 1, 1, 0.1f, 65.0f, 64.0f, 65.0f, -150.0f),
-		SpriteAnimation(missile2, 1, 1, 0.1f, 65.0f, 64.0f, 17.0f, -180.0f),
-
-		SpriteAnimation(life, 1, 1, 1.f, 32.0f, 32.0f, -380.0f, -280.0f),
-		SpriteAnimation(life, 1, 1, 1.f, 32.0f, 32.0f, -340.0f, -280.0f),
-		SpriteAnimation(life, 1, 1, 1.f, 32.0f, 32.0f, -300.0f, -280.0f)
+		SpriteAnimation(sheets[loner], 4, 4, 0.1f, 64.0f, 64.0f, 0.0f, 150.0f),
+		SpriteAnimation(sheets[loner2], 4, 4, 0.1f, 64.0f, 64.0f, -60.f, 200.0f),
+		SpriteAnimation(sheets[loner], 4, 4, 0.1f, 64.0f, 64.0f, 60.f, 200.0f),
+		SpriteAnimation(sheets[loner2], 4, 4, 0.1f, 64.0f, 64.0f, -190.f, -100.0f),
+
+		SpriteAnimation(sheets[drone], 2, 8, 0.1f, 32.0f, 32.0f, 200.f, -120.0f),
+		SpriteAnimation(sheets[drone], 2, 8, 0.1f, 32.0f, 32.0f, 240.f, -100.0f),
+		SpriteAnimation(sheets[drone], 2, 8, 0.1f, 32.0f, 32.0f, 280.f, -120.0f),
+		SpriteAnimation(sheets[drone], 2, 8, 0.1f, 32.0f, 32.0f, 240.f, -140.0f),
+
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 200.0f),
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 170.0f),
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 140.0f),
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 110.0f),
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -350.f, 80.0f),
+		SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, -310.f, 50.0f),
+
+		SpriteAnimation(sheets[steelAsteroid], 5, 5, 0.2f, 64.0f, 64.0f, 150.0f, 50.0f),
+		SpriteAnimation(sheets[steelAsteroid2], 3, 8, 0.2f, 64.0f, 64.0f, 300.0f, 100.0f),
+		SpriteAnimation(sheets[rockAsteroid], 5, 5, 0.2f, 64.0f, 64.0f, 200.0f, 150.0f),
+		SpriteAnimation(sheets[rockAsteroid2], 5, 5, 0.2f, 64.0f, 64.0f, 300.0f, 220.0f),
+		SpriteAnimation(sheets[rockAsteroid2], 5, 5, 0.2f, 64.0f, 64.0f, -100.0f, 25.0f),
+
+		SpriteAnimation(sheets[clone], 4, 4, 0.1f, 32.0f, 32.0f, -50.0f, -200.0f),
+		SpriteAnimation(sheets[clone], 4, 4, 0.1f, 32.0f, 32.0f, 50.0f, -200.0f),
+
+		SpriteAnimation(sheets[ship], 1, 1, 1.f, 64.0f, 64.0f, 0.0f, -230.0f),
+		SpriteAnimation(sheets[shipJet], 1, 1, 1.f, 12.0f, 12.0f, -10.0f, -268.0f),
+		SpriteAnimation(sheets[shipJet], 1, 1, 1.f, 12.0f, 12.0f, 10.0f, -268.0f),
+
+		SpriteAnimation(sheets[missile], 1, 1, 0.1f, 65.0f, 64.0f, -35.0f, -150.0f),
+		SpriteAnimation(sheets[missile], 1, 1, 0.1f, 65.0f, 64.0f, 65.0f, -150.0f),
+		SpriteAnimation(sheets[missile2], 1, 1, 0.1f, 65.0f, 64.0f, 17.0f, -180.0f),
+
+		SpriteAnimation(sheets[life], 1, 1, 1.f, 32.0f, 32.0f, -380.0f, -280.0f),
+		SpriteAnimation(sheets[life], 1, 1, 1.f, 32.0f, 32.0f, -340.0f, -280.0f),
+		SpriteAnimation(sheets[life], 1, 1, 1.f, 32.0f, 32.0f, -300.0f, -280.0f)
+	};
+
+	// The running scene lives in an entity world, sceneEntities[i] starts out as animations[i]; the life icons are HUD.
+	// With --gpu-anim, world sprites that never move are drawn by the shader instead; their entities keep
+	// everything but the sprite, so they still animate for the collision masks.
+	EcsWorld world;
+	initEcsWorld(world);
+	std::vector<Entity> sceneEntities;
+	std::vector<size_t> gpuAnimated;
+	for (size_t i = 0; i < animations.size(); ++i) {
+		const SpriteAnimation& anim = animations[i];
+		EntityDesc desc = spriteEntityDesc(anim);
+		if (anim.textureID == sheets[life].textureID && anim.uvRect == sheets[life].uvRect)
+			desc.sprite.layer = RENDER_LAYER_HUD;
+		bool still = !(desc.components & COMPONENT_VELOCITY) || (desc.velocity.x == 0.0f && desc.velocity.y == 0.0f);
+		if (gpuAnimation && still && desc.sprite.layer == RENDER_LAYER_WORLD) {
+			desc.components &= ~COMPONENT_SPRITE;
+			gpuAnimated.push_back(i);
+		}
+		sceneEntities.push_back(createEntity(world, desc));
+	}
+
+	// Sprites with a mask get one per frame at the size they are drawn; the ship and missiles are tested against the asteroids
+	struct MaskedSheet { int sheet; const CollisionMask* mask; unsigned int layer; };
+	const MaskedSheet maskedSheets[] = {
+		{ steelAsteroid, &steelAsteroidMask, COLLISION_LAYER_ASTEROID }, { steelAsteroid2, &steelAsteroid2Mask, COLLISION_LAYER_ASTEROID },
+		{ rockAsteroid, &rockAsteroidMask, COLLISION_LAYER_ASTEROID }, { rockAsteroid2, &rockAsteroid2Mask, COLLISION_LAYER_ASTEROID },
+		{ ship, &shipMask, COLLISION_LAYER_PLAYER }, { missile, &missileMask, COLLISION_LAYER_PLAYER_SHOT },
+		{ missile2, &missile2Mask, COLLISION_LAYER_PLAYER_SHOT }
+	};
+	struct SceneCollider { Entity entity; std::vector<CollisionMask> frames; unsigned int layer; int proxy; };
+	std::vector<SceneCollider> shipColliders, asteroidColliders;
+	Entity shipEntity = { 0, 0 };
+	for (size_t i = 0; i < animations.size(); ++i) {
+		const SpriteAnimation& anim = animations[i];
+		for (const MaskedSheet& masked : maskedSheets) {
+			const AtlasRegion& region = sheets[masked.sheet];
+			if (masked.mask->bits.empty() || anim.textureID != region.textureID || anim.uvRect != region.uvRect)
+				continue;
+			SceneCollider collider;
+			collider.entity = sceneEntities[i];
+			collider.layer = masked.layer;
+			collider.proxy = -1;
+			collider.frames.resize(anim.frameCount);
+			for (int frame = 0; frame < anim.frameCount; ++frame)
+				frameCollisionMask(collider.frames[frame], *masked.mask, anim.rows, anim.columns, frame, (int)anim.width, (int)anim.height);
+			(masked.layer == COLLISION_LAYER_ASTEROID ? asteroidColliders : shipColliders).push_back(std::move(collider));
+			if (masked.sheet == ship)
+				shipEntity = sceneEntities[i];
+			break;
+		}
+	}
+	std::vector<char> touching(shipColliders.size() * asteroidColliders.size(), 0);
+
+	// Where a collider is this tick, its bottom-left corner in whole units and the mask of its current frame
+	struct ColliderPlacement { float x, y, width, height; int left, bottom; const CollisionMask* frame; };
+	auto placeCollider = [&world](const SceneCollider& collider, ColliderPlacement& placement) {
+		size_t row;
+		Archetype* archetype = entityArchetype(world, collider.entity, row);
+		if (!archetype)
+			return false;
+		const PositionComponent& position = archetype->positions[row];
+		const SizeComponent& size = archetype->sizes[row];
+		placement = { position.x, position.y, size.width, size.height, (int)std::floor(position.x - size.width * 0.5f),
+			(int)std::floor(position.y - size.height * 0.5f), &collider.frames[archetype->animations.currentFrame[row]] };
+		return true;
+	};
+
+	// The ship keeps firing missiles; they come and go through a fixed pool, so firing never allocates
+	ObjectPool<SpriteAnimation> shots;
+	initObjectPool(shots, 64);
+	const float shotInterval = 0.25f;
+	const float shotSpeed = 400.0f;
+	const float shotWidth = 65.0f, shotHeight = 64.0f;  // Drawn like the missiles already on screen
+	float shotTimer = 0.0f;
+	CollisionMask shotMask;
+	if (!missileMask.bits.empty())
+		frameCollisionMask(shotMask, missileMask, 1, 1, 0, (int)shotWidth, (int)shotHeight);
+
+	// Colliders and shots are proxies in one broadphase, only the pairs it finds get their masks tested.
+	// proxyOwners says what a proxy id stands for, a shot by its pool slot since despawning moves objects.
+	enum ColliderKind { COLLIDER_SHIP, COLLIDER_ASTEROID, COLLIDER_SHOT };
+	struct ProxyOwner { ColliderKind kind; size_t index; };
+	SweepAndPrune broadphase = SweepAndPrune();
+	std::vector<ProxyOwner> proxyOwners;
+	std::vector<CollisionPair> collisionPairs;
+	auto addProxy = [&](const QuadtreeBounds& bounds, unsigned int layer, unsigned int mask, ColliderKind kind, size_t index) {
+		int proxy = addCollisionProxy(broadphase, bounds, layer, mask);
+		if ((size_t)proxy >= proxyOwners.size())
+			proxyOwners.resize(proxy + 1);
+		proxyOwners[proxy] = { kind, index };
+		return proxy;
+	};
+	auto addColliderProxies = [&](std::vector<SceneCollider>& colliders, ColliderKind kind, unsigned int mask) {
+		for (size_t i = 0; i < colliders.size(); ++i) {
+			ColliderPlacement placement;
+			if (placeCollider(colliders[i], placement))
+				colliders[i].proxy = addProxy(spriteBounds(placement.x, placement.y, placement.width, placement.height),
+					colliders[i].layer, mask, kind, i);
+		}
 	};
+	addColliderProxies(shipColliders, COLLIDER_SHIP, COLLISION_LAYER_ASTEROID);
+	addColliderProxies(asteroidColliders, COLLIDER_ASTEROID, COLLISION_LAYER_PLAYER | COLLISION_LAYER_PLAYER_SHOT);
+	std::vector<int> shotProxies(shots.capacity, -1);  // By pool slot
+	std::vector<PoolHandle> hitShots;
+	hitShots.reserve(shots.capacity);
+	std::vector<char> touchingNow(touching.size(), 0);
 
 #pragma endregion
 
@@ -394,52 +500,402 @@ int main(int argc, char* args[]) {
 	glm::mat4 view = glm::mat4(1.0f);
 	glm::mat4 backgroundModel = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, 0.0f));
 
-	// Enable blending for transparency
+	// World rect the camera sees, the corners of clip space taken back through the camera
+	glm::mat4 clipToWorld = glm::inverse(projection * view);
+	glm::vec4 viewMin = clipToWorld * glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+	glm::vec4 viewMax = clipToWorld * glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+	QuadtreeBounds cameraRect = { viewMin.x, viewMin.y, viewMax.x, viewMax.y };
+
+	// Only sprites overlapping the camera are drawn, each scene entity has an item in the tree
+	LooseQuadtree sceneTree;
+	initQuadtree(sceneTree, 0.0f, 0.0f, 2048.0f);
+	CullingContext cullingContext;
+	cullingContext.tree = &sceneTree;
+	cullingContext.entityItems.assign(world.entities.size(), -1);
+	for (size_t i = 0; i < animations.size(); ++i) {
+		const SpriteAnimation& anim = animations[i];
+		cullingContext.entityItems[sceneEntities[i].index] = insertQuadtreeItem(sceneTree, spriteBounds(anim.x, anim.y, anim.width, anim.height));
+		cullingContext.itemEntities.push_back(sceneEntities[i].index);
+	}
+
+	// Enable blending for transparency, textures are premultiplied
 	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-	float lastFrameTime = 0.0f;
+	// Sprites are drawn instanced, one draw per texture
+	SpriteBatch spriteBatch;
+	if (!initSpriteBatch(spriteBatch, animations.size())) {
+		std::cerr << "Failed to create sprite batch" << std::endl;
+		SDL_GL_DeleteContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
+	}
+
+	// All HUD strings of a frame are drawn with one instanced call
+	TextRenderer textRenderer;
+	if (!initTextRenderer(textRenderer, textTexture, txtTextureWidth, txtTextureHeight, charWidth, charHeight, 64)) {
+		std::cerr << "Failed to create text renderer" << std::endl;
+		destroySpriteBatch(spriteBatch);
+		SDL_GL_DeleteContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
+	}
+
+	// The scene never touches these sprites again after this, the shader works out every frame
+	AnimatedSpriteLayer animatedSprites;
+	if (!initAnimatedSpriteLayer(animatedSprites)) {
+		std::cerr << "Failed to create animated sprite layer" << std::endl;
+		destroyTextRenderer(textRenderer);
+		destroySpriteBatch(spriteBatch);
+		SDL_GL_DeleteContext(glContext);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
+	}
+	for (size_t i : gpuAnimated)
+		addAnimatedSprite(animatedSprites, animations[i], 0.0f);
+
+	// The level scrolls up through the view, the walls are optional if the level can't be read
+	const float scrollSpeed = 60.0f;
+	TilemapLevel level;
+	Tilemap tilemap;
+	bool tilemapReady = loadTilemapLevel(level, "../Assets/levels/blocks.csv")
+		&& initTilemap(tilemap, level, blocksTexture, blocksWidth, blocksHeight, 32, 32.0f, glm::vec2(viewMin.x, viewMin.y));
+
+	// Effects: a blast, drifting smoke and a spray of dust, all from fixed pools
+	ParticleSystem particles;
+	initParticleSystem(particles);
+	ParticleEmitter blastEmitter = particleEmitter(sheets[explosion], 5, 2, 64.0f);
+	blastEmitter.lifeMin = blastEmitter.lifeMax = 0.6f;
+	ParticleEmitter smokeEmitter = particleEmitter(sheets[smoke], 4, 1, 32.0f);
+	smokeEmitter.speedMin = 10.0f;
+	smokeEmitter.speedMax = 30.0f;
+	smokeEmitter.lifeMin = 1.0f;
+	smokeEmitter.lifeMax = 1.6f;
+	smokeEmitter.sizeMax = 48.0f;
+	smokeEmitter.gravity = 20.0f;
+	ParticleEmitter dustEmitter = particleEmitter(sheets[dust], 4, 1, 8.0f);
+	dustEmitter.speedMin = 40.0f;
+	dustEmitter.speedMax = 160.0f;
+	dustEmitter.lifeMin = 0.5f;
+	dustEmitter.lifeMax = 1.0f;
+	dustEmitter.drag = 0.2f;
+	int blastPool = addParticlePool(particles, blastEmitter, 64);
+	int smokePool = addParticlePool(particles, smokeEmitter, 512);
+	int dustPool = addParticlePool(particles, dustEmitter, 4096);
+	const float effectInterval = 0.6f;
+	float effectTimer = 0.0f;
+	size_t nextEffect = 0;
+
+	ParticleRenderer particleRenderer;
+	bool particlesReady = initParticleRenderer(particleRenderer, 64 + 512 + 4096);
+
+	// Per-frame work is split over these; GL calls stay on this thread
+	JobSystem jobs;
+	initJobSystem(jobs, workerThreads);
+
+	if (benchBatch) {
+		updateCameraBuffer(cameraBuffer, view, projection);
+		runSpriteBatchBenchmark(spriteBatch, shaderProgram, VAO, VBO, vertices, sizeof(vertices), animations);
+	}
+
+	if (!stressCounts.empty()) {
+		// The animated enemy and asteroid sheets; the rocks, ship and HUD icons are single frames
+		std::vector<SpriteAnimation> stressTemplates = {
+			SpriteAnimation(sheets[loner], 4, 4, 0.1f, 64.0f, 64.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[drone], 2, 8, 0.1f, 32.0f, 32.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[rusher], 6, 4, 0.1f, 32.0f, 32.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[steelAsteroid], 5, 5, 0.2f, 64.0f, 64.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[steelAsteroid2], 3, 8, 0.2f, 64.0f, 64.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[rockAsteroid], 5, 5, 0.2f, 64.0f, 64.0f, 0.0f, 0.0f),
+			SpriteAnimation(sheets[rockAsteroid2], 5, 5, 0.2f, 64.0f, 64.0f, 0.0f, 0.0f)
+		};
+		updateCameraBuffer(cameraBuffer, view, projection);
+		runSpriteStressBenchmark(spriteBatch, textRenderer, gpuAnimation ? &animatedSprites : NULL, stressTemplates, stressCounts, stressFrames, window, jobs);
+	}
+
+	bool firstFrame = true;
+	bool running = true;
+	double animationClock = 0.0;  // Simulation time, drives the GPU animated sprites
+
+	// Gameplay ticks at a fixed rate, rendering runs at whatever rate the display allows
+	FrameScheduler scheduler;
+	initFrameScheduler(scheduler, tickRate);
+	if (headless.frames > 0)
+		setFixedTicksPerFrame(scheduler, 1);
+
+	// Systems that run every tick: movement and animation touch different components and share a stage on
+	// the worker threads, the culling bounds read the moved positions in the next one
+	TickContext tickContext = { 0.0f, ANIMATION_KERNEL_BEST };
+	EcsSchedule tickSchedule;
+	initEcsSchedule(tickSchedule);
+	addEcsSystem(tickSchedule, movementSystem(&tickContext));
+	addEcsSystem(tickSchedule, animationSystem(&tickContext));
+	addEcsSystem(tickSchedule, cullingBoundsSystem(&cullingContext));
+
+	// And once per rendered frame
+	SpriteDrawContext drawContext;
+	drawContext.batch = &spriteBatch;
+	drawContext.world = &world;
+	for (const SpriteAnimation& anim : animations)
+		addSpriteDrawTexture(drawContext, anim.textureID);
+	drawContext.visible.assign(world.entities.size(), 0);
+	drawContext.alpha = 0.0f;
+	SpriteCulling spriteCulling;
+	spriteCulling.culling = &cullingContext;
+	spriteCulling.visible = &drawContext.visible;
+	EcsSchedule drawSchedule;
+	initEcsSchedule(drawSchedule);
+	addEcsSystem(drawSchedule, spriteDrawSystem(&drawContext));
+
+	// Per-pass CPU and GPU timing, shown on screen with --profile and logged with --profile-csv
+	Profiler profiler;
+	initProfiler(profiler, showProfile || profileCsv);
+	int backgroundPass = addProfilePass(profiler, "background", true);
+	int tilemapPass = addProfilePass(profiler, "tilemap", true);
+	int spritesPass = addProfilePass(profiler, "sprites", true);
+	int particlesPass = addProfilePass(profiler, "particles", true);
+	int textPass = addProfilePass(profiler, "text", true);
+	int presentPass = addProfilePass(profiler, "present", false);
+	if (profileCsv && !openProfilerCsv(profiler, profileCsv))
+		std::cerr << "ERROR::PROFILER::CSV_OPEN_FAILED " << profileCsv << std::endl;
 
 	// Main loop
-	while (true) {
-		float currentFrameTime = SDL_GetTicks() / 1000.0f;
-		float deltaTime = currentFrameTime - lastFrameTime;
-		lastFrameTime = currentFrameTime;
+	while (running && !benchmarkOnly) {
+		int ticks = beginFrame(scheduler);
+		beginProfilerFrame(profiler);
 
 		SDL_Event event;
-		if (SDL_PollEvent(&event)) {
-			if (event.type == SDL_QUIT) break;
+		while (SDL_PollEvent(&event)) {
+			if (event.type == SDL_QUIT)
+				running = false;
+		}
+		if (!running)
+			break;
+		endPhase(scheduler, FRAME_PHASE_INPUT);
+
+		for (int tick = 0; tick < ticks; ++tick) {
+			animationClock += tickDelta(scheduler);
+
+			// Set off an effect on the next sprite every so often, where its entity is now
+			effectTimer += tickDelta(scheduler);
+			if (effectTimer >= effectInterval && !sceneEntities.empty()) {
+				effectTimer -= effectInterval;
+				size_t targetRow;
+				Archetype* targetArchetype = entityArchetype(world, sceneEntities[nextEffect++ % sceneEntities.size()], targetRow);
+				if (targetArchetype) {
+					const PositionComponent& target = targetArchetype->positions[targetRow];
+					emitParticles(particles, blastPool, target.x, target.y, 1);
+					emitParticles(particles, smokePool, target.x, target.y, 6);
+					emitParticles(particles, dustPool, target.x, target.y, 40);
+				}
+			}
+			updateParticles(particles, tickDelta(scheduler));
+
+			shotTimer += tickDelta(scheduler);
+			size_t shipRow;
+			Archetype* shipArchetype = entityArchetype(world, shipEntity, shipRow);
+			if (shotTimer >= shotInterval && shipArchetype) {
+				shotTimer -= shotInterval;
+				const PositionComponent& from = shipArchetype->positions[shipRow];
+				float top = from.y + shipArchetype->sizes[shipRow].height * 0.5f;
+				SpriteAnimation shot(sheets[missile], 1, 1, 1.0f, shotWidth, shotHeight, from.x, top);
+				PoolHandle handle = spawnObject(shots, shot);
+				if (handle.generation != 0 && !shotMask.bits.empty())
+					shotProxies[handle.slot] = addProxy(spriteBounds(shot.x, shot.y, shot.width, shot.height),
+						COLLISION_LAYER_PLAYER_SHOT, COLLISION_LAYER_ASTEROID, COLLIDER_SHOT, handle.slot);
+			}
+			// Backwards, a despawned shot is replaced by the last one
+			for (size_t i = shots.count; i-- > 0;) {
+				SpriteAnimation& shot = shots.objects[i];
+				storePreviousPosition(shot);
+				shot.y += shotSpeed * tickDelta(scheduler);
+				int& proxy = shotProxies[shots.objectSlot[i]];
+				if (shot.y - shot.height * 0.5f > viewMax.y) {
+					if (proxy >= 0)
+						removeCollisionProxy(broadphase, proxy);
+					proxy = -1;
+					despawnObjectAt(shots, i);
+				}
+				else if (proxy >= 0)
+					moveCollisionProxy(broadphase, proxy, spriteBounds(shot.x, shot.y, shot.width, shot.height));
+			}
+
+			tickContext.deltaTime = tickDelta(scheduler);
+			runEcsSchedule(tickSchedule, world, jobs);
+
+			for (std::vector<SceneCollider>* colliders : { &shipColliders, &asteroidColliders }) {
+				for (const SceneCollider& collider : *colliders) {
+					ColliderPlacement placement;
+					if (collider.proxy >= 0 && placeCollider(collider, placement))
+						moveCollisionProxy(broadphase, collider.proxy, spriteBounds(placement.x, placement.y, placement.width, placement.height));
+				}
+			}
+
+			// Boxes from the broadphase, then the masks of the current frames. A blast goes off where the ship or a
+			// missile starts touching an asteroid, a shot that hits one is spent.
+			findCollisionPairs(broadphase, collisionPairs);
+			std::fill(touchingNow.begin(), touchingNow.end(), 0);
+			hitShots.clear();
+			for (const CollisionPair& pair : collisionPairs) {
+				ProxyOwner first = proxyOwners[pair.a], second = proxyOwners[pair.b];
+				if (first.kind == COLLIDER_ASTEROID)
+					std::swap(first, second);
+				if (second.kind != COLLIDER_ASTEROID || first.kind == COLLIDER_ASTEROID)
+					continue;
+				ColliderPlacement b;
+				if (!placeCollider(asteroidColliders[second.index], b))
+					continue;
+				if (first.kind == COLLIDER_SHOT) {
+					const SpriteAnimation& shot = shots.objects[shots.slotObject[first.index]];
+					int shotLeft = (int)std::floor(shot.x - shot.width * 0.5f), shotBottom = (int)std::floor(shot.y - shot.height * 0.5f);
+					if (collisionMasksOverlap(shotMask, shotLeft, shotBottom, *b.frame, b.left, b.bottom))
+						hitShots.push_back({ (uint32_t)first.index, shots.generations[first.index] });
+					continue;
+				}
+				ColliderPlacement a;
+				if (!placeCollider(shipColliders[first.index], a) || !collisionMasksOverlap(*a.frame, a.left, a.bottom, *b.frame, b.left, b.bottom))
+					continue;
+				size_t touchIndex = first.index * asteroidColliders.size() + second.index;
+				touchingNow[touchIndex] = 1;
+				if (!touching[touchIndex])
+					emitParticles(particles, blastPool, (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, 1);
+			}
+			touching.swap(touchingNow);
+			// A shot touching two asteroids is only spent once, its handle is stale the second time
+			for (PoolHandle handle : hitShots) {
+				if (!objectAlive(shots, handle))
+					continue;
+				const SpriteAnimation& shot = shots.objects[shots.slotObject[handle.slot]];
+				emitParticles(particles, blastPool, shot.x, shot.y, 1);
+				emitParticles(particles, dustPool, shot.x, shot.y, 20);
+				removeCollisionProxy(broadphase, shotProxies[handle.slot]);
+				shotProxies[handle.slot] = -1;
+				despawnObject(shots, handle);
+			}
 		}
+		endPhase(scheduler, FRAME_PHASE_UPDATE);
 
-		glClear(GL_COLOR_BUFFER_BIT);
+		// The workers find the visible sprites while the background and walls are drawn
+		beginSpriteCulling(jobs, spriteCulling, cameraRect);
 
 		// Render static background
-		renderObject(backgroundVAO, backgroundTexture, backgroundModel, shaderProgram, view, projection);
+		{
+			ScopedPass pass(profiler, backgroundPass);
+			glClear(GL_COLOR_BUFFER_BIT);
+			updateCameraBuffer(cameraBuffer, view, projection);
+			renderObject(backgroundVAO, backgroundTexture, backgroundModel, shaderProgram);
+		}
 
-		// Render animations
-		for (auto& anim : animations) {
-			updateSpriteAnimation(anim, deltaTime);
-			updateTextureCoords(anim, vertices);
+		// Render the level walls, looping back to the start once the top has scrolled past
+		if (tilemapReady) {
+			ScopedPass pass(profiler, tilemapPass);
+			float loopLength = tilemapHeight(tilemap) - (viewMax.y - viewMin.y);
+			float scroll = loopLength > 0.0f ? (float)std::fmod(animationClock * scrollSpeed, (double)loopLength) : 0.0f;
+			drawTilemap(tilemap, glm::vec2(viewMin), glm::vec2(viewMax), glm::vec2(0.0f, scroll));
+		}
 
-			glBindBuffer(GL_ARRAY_BUFFER, VBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+		// Render animations between the last two ticks
+		{
+			ScopedPass pass(profiler, spritesPass);
+			float alpha = interpolationAlpha(scheduler);
+			beginSpriteBatch(spriteBatch);
+			// Still world sprites go first, under everything the batch draws at the end
+			if (gpuAnimation)
+				drawAnimatedSprites(animatedSprites, (float)animationClock);
+			// Entities are drawn by layer and sheet, in row order within one; later rows on top
+			finishSpriteCulling(jobs, spriteCulling);
+			drawContext.alpha = alpha;
+			beginSpriteDraw(drawContext);
+			runEcsSchedule(drawSchedule, world, jobs);
+			for (size_t i = 0; i < shots.count; ++i) {
+				const SpriteAnimation& shot = shots.objects[i];
+				glm::vec2 position = interpolatedPosition(shot, alpha);
+				glm::vec4 uv = getFrameUV(shot);
+				drawSprite(spriteBatch, shot.textureID, { position.x, position.y, shot.width, shot.height, uv.x, uv.y, uv.z, uv.w },
+					RENDER_LAYER_EFFECTS, BLEND_ADDITIVE);
+			}
+			endSpriteBatch(spriteBatch, &jobs);
+		}
 
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(anim.x, anim.y, 0.0f));
-			model = glm::scale(model, glm::vec3(anim.width, anim.height, 1.0f));
-			renderObject(VAO, anim.textureID, model, shaderProgram, view, projection);
+		if (particlesReady) {
+			ScopedPass pass(profiler, particlesPass);
+			drawParticles(particleRenderer, particles);
 		}
 
 		// Render text
-		RenderText(shaderProgram, textTexture, "Score:024801", -3.0f, 17.0f, 0.04f, glm::vec3(1.0f, 1.0f, 1.0f), textVAO, textVBO, charWidth, charHeight, txtTextureWidth, txtTextureHeight);
-		RenderText(shaderProgram, textTexture, "HighScore:5415480", 7.0f, 17.0f, 0.02f, glm::vec3(1.0f, 1.0f, 1.0f), textVAO, textVBO, charWidth, charHeight, txtTextureWidth, txtTextureHeight);
+		{
+			ScopedPass pass(profiler, textPass);
+			const glm::vec4 white(1.0f);
+			beginText(textRenderer);
+			drawText(textRenderer, "Score:024801", -396.0f, 264.0f, 20.48f, white);
+			drawText(textRenderer, "HighScore:5415480", -76.0f, 264.0f, 10.24f, white);
+			if (showProfile)
+				drawProfilerOverlay(profiler, textRenderer, -396.0f, 236.0f, 10.0f);
+			endText(textRenderer);
+		}
+		endPhase(scheduler, FRAME_PHASE_RENDER);
+
+		{
+			ScopedPass pass(profiler, presentPass);
+			if (headless.frames > 0)
+				running = finishHeadlessFrame(headless, scheduler.lastFrame);
+			else
+				SDL_GL_SwapWindow(window);
+		}
+		endPhase(scheduler, FRAME_PHASE_PRESENT);
+		endProfilerFrame(profiler);
+
+		FrameReport report;
+		if (frameStats && takeFrameReport(scheduler, report))
+			printFrameReport(report);
+
+		if (firstFrame) {
+			firstFrame = false;
+			const TextureLoaderStats& stats = loader.stats;
+			std::cout << "Startup: " << stats.images << " textures (" << stats.cooked << " cooked) in " << stats.totalMs << " ms on "
+				<< stats.threads << " decode thread(s), decode " << stats.decodeMs << " ms CPU, upload " << stats.uploadMs << " ms; first frame at "
+				<< (SDL_GetPerformanceCounter() - startupCounter) * 1000.0 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+			const TextureCacheStats& textures = textureCache.stats;
+			std::cout << "Texture memory: " << textures.textures << " cached textures " << textures.bytes / (1024.0 * 1024.0) << " MB + atlas "
+				<< textureCache.pinnedBytes / (1024.0 * 1024.0) << " MB, budget " << textureCache.budget / (1024.0 * 1024.0) << " MB"
+				<< (textures.overBudget ? " (over budget)" : "") << std::endl;
+		}
+	}
 
-		SDL_GL_SwapWindow(window);
+	if (headless.frames > 0) {
+		FrameReport report;
+		if (takeFrameReport(scheduler, report, 0.0))
+			printFrameReport(report);
+		endHeadlessRun(headless);
 	}
 
 	// Clean up resources
+	destroyProfiler(profiler);
+	destroyJobSystem(jobs);
+	if (particlesReady)
+		destroyParticleRenderer(particleRenderer);
+	if (tilemapReady)
+		destroyTilemap(tilemap);
+	destroyAnimatedSpriteLayer(animatedSprites);
+	destroySpriteBatch(spriteBatch);
+	destroyTextRenderer(textRenderer);
+	destroyTextureAtlas(atlas);
+	releaseTexture(textureCache, backgroundHandle);
+	releaseTexture(textureCache, textHandle);
+	releaseTexture(textureCache, blocksHandle);
+	destroyTextureCache(textureCache);
+	closeTexturePack(pack);
+	destroyShaderProgram(shaderProgram);
+	glDeleteBuffers(1, &cameraBuffer);
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
 	glDeleteBuffers(1, &EBO);
+	glDeleteVertexArrays(1, &backgroundVAO);
+	glDeleteBuffers(1, &backgroundVBO);
+	glDeleteBuffers(1, &backgroundEBO);
 	SDL_GL_DeleteContext(glContext);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
@@ -0,0 +1,120 @@
+#include "CollisionMask.h"
+#include <algorithm>
+#include "CpuFeatures.h"
+
+static void resizeMask(CollisionMask& mask, int width, int height) {
+	mask.width = width;
+	mask.height = height;
+	mask.bands = (width + 63) / 64;
+	mask.bits.assign((size_t)mask.bands * height, 0);
+}
+
+void buildCollisionMask(CollisionMask& mask, const unsigned char* pixels, int width, int height) {
+	resizeMask(mask, width, height);
+	for (int y = 0; y < height; ++y) {
+		const unsigned char* row = pixels + (size_t)y * width * 4;
+		for (int x = 0; x < width; ++x) {
+			if (row[x * 4 + 3] >= 128)
+				mask.bits[(size_t)(x >> 6) * height + y] |= (uint64_t)1 << (x & 63);
+		}
+	}
+}
+
+void frameCollisionMask(CollisionMask& frame, const CollisionMask& sheet, int rows, int columns, int frameIndex, int width, int height) {
+	resizeMask(frame, width, height);
+	int frameWidth = sheet.width / columns, frameHeight = sheet.height / rows;
+	int left = (frameIndex % columns) * frameWidth;
+	int bottom = sheet.height - (frameIndex / columns + 1) * frameHeight;  // Sheet rows count down from the top
+
+	// Nearest sample at each pixel center
+	for (int y = 0; y < height; ++y) {
+		int sourceY = bottom + (2 * y + 1) * frameHeight / (2 * height);
+		for (int x = 0; x < width; ++x) {
+			int sourceX = left + (2 * x + 1) * frameWidth / (2 * width);
+			if (collisionMaskBit(sheet, sourceX, sourceY))
+				frame.bits[(size_t)(x >> 6) * height + y] |= (uint64_t)1 << (x & 63);
+		}
+	}
+}
+
+// Rows of a band of a, or NULL past either side so the caller reads zeros
+static const uint64_t* maskBand(const CollisionMask& mask, int band) {
+	return band >= 0 && band < mask.bands ? mask.bits.data() + (size_t)band * mask.height : NULL;
+}
+
+// Test rows [0, count) of b's band against a's bits shifted so they line up: a's pixel columns start
+// shift bits into the low band and carry on in the high band
+static bool bandsOverlapScalar(const uint64_t* low, const uint64_t* high, const uint64_t* b, int count, int shift) {
+	for (int row = 0; row < count; ++row) {
+		uint64_t aligned = (low ? low[row] >> shift : 0) | (high && shift ? high[row] << (64 - shift) : 0);
+		if (aligned & b[row])
+			return true;
+	}
+	return false;
+}
+
+#ifdef CPU_X86
+
+// Four rows per step, same alignment as the scalar loop
+TARGET_AVX2 static bool bandsOverlapAVX2(const uint64_t* low, const uint64_t* high, const uint64_t* b, int count, int shift) {
+	const __m128i right = _mm_cvtsi32_si128(shift);
+	const __m128i left = _mm_cvtsi32_si128(64 - shift);  // 64 clears the lane, no carry when aligned
+	const __m256i zero = _mm256_setzero_si256();
+	int row = 0;
+	for (; row + 4 <= count; row += 4) {
+		__m256i lowBits = low ? _mm256_srl_epi64(_mm256_loadu_si256((const __m256i*)(low + row)), right) : zero;
+		__m256i highBits = high ? _mm256_sll_epi64(_mm256_loadu_si256((const __m256i*)(high + row)), left) : zero;
+		__m256i bBits = _mm256_loadu_si256((const __m256i*)(b + row));
+		if (!_mm256_testz_si256(_mm256_or_si256(lowBits, highBits), bBits)) {
+			_mm256_zeroupper();
+			return true;
+		}
+	}
+	_mm256_zeroupper();
+	return bandsOverlapScalar(low ? low + row : NULL, high ? high + row : NULL, b + row, count - row, shift);
+}
+
+#endif
+
+bool collisionMasksOverlap(const CollisionMask& a, int ax, int ay, const CollisionMask& b, int bx, int by, AnimationKernel kernel) {
+	// Rows both masks cover, in b's rows
+	int dx = bx - ax, dy = by - ay;
+	int firstRow = std::max(0, -dy), lastRow = std::min(b.height, a.height - dy);
+	if (firstRow >= lastRow || dx >= a.width || dx + b.width <= 0)
+		return false;
+
+	if (kernel == ANIMATION_KERNEL_BEST)
+		kernel = bestAnimationKernel();
+	bool useAVX2 = false;
+#ifdef CPU_X86
+	useAVX2 = kernel == ANIMATION_KERNEL_AVX2 && cpuHasAVX2();
+#endif
+
+	// Only b's bands that reach into a's columns
+	int firstBand = std::max(0, -dx) >> 6, lastBand = std::min(b.bands - 1, (a.width - 1 - dx) >> 6);
+	for (int band = firstBand; band <= lastBand; ++band) {
+		int start = band * 64 + dx;  // a's column under b's first column of this band
+		int aBand = start >= 0 ? start >> 6 : -((63 - start) >> 6);
+		int shift = start - aBand * 64;
+
+		const uint64_t* low = maskBand(a, aBand);
+		const uint64_t* high = maskBand(a, aBand + 1);
+		if (low)
+			low += firstRow + dy;
+		if (high)
+			high += firstRow + dy;
+		const uint64_t* bRows = maskBand(b, band) + firstRow;
+
+		int count = lastRow - firstRow;
+#ifdef CPU_X86
+		if (useAVX2) {
+			if (bandsOverlapAVX2(low, high, bRows, count, shift))
+				return true;
+			continue;
+		}
+#endif
+		if (bandsOverlapScalar(low, high, bRows, count, shift))
+			return true;
+	}
+	return false;
+}
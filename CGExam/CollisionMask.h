@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "AnimationStore.h"
+
+// One bit per pixel, set where the image is opaque. Columns are split into 64 pixel bands and each band
+// stores its rows contiguously, bit i of bits[band * height + row] being pixel (band * 64 + i, row).
+// Row 0 is the bottom, like the GL pixels the mask is built from and like world y.
+struct CollisionMask {
+	int width, height;
+	int bands;
+	std::vector<uint64_t> bits;
+};
+
+// Build a mask from premultiplied RGBA pixels, rows bottom to top; keyed pixels have zero alpha
+void buildCollisionMask(CollisionMask& mask, const unsigned char* pixels, int width, int height);
+
+// Cut one frame out of a sheet mask laid out like SpriteAnimation (frame 0 top-left) and scale it to
+// width x height, the size the frame is drawn at
+void frameCollisionMask(CollisionMask& frame, const CollisionMask& sheet, int rows, int columns, int frameIndex, int width, int height);
+
+// Exact test of whether two masks share an opaque pixel, with their bottom-left corners at whole world units
+bool collisionMasksOverlap(const CollisionMask& a, int ax, int ay, const CollisionMask& b, int bx, int by,
+	AnimationKernel kernel = ANIMATION_KERNEL_BEST);
+
+// Whether the pixel at x, y of a mask is set
+inline bool collisionMaskBit(const CollisionMask& mask, int x, int y) {
+	return (mask.bits[(size_t)(x >> 6) * mask.height + y] >> (x & 63)) & 1;
+}
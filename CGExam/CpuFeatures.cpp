@@ -0,0 +1,29 @@
+#include "CpuFeatures.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static bool detectAVX2() {
+#if defined(CPU_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif defined(CPU_X86)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+bool cpuHasAVX2() {
+	static const bool hasAVX2 = detectAVX2();
+	return hasAVX2;
+}
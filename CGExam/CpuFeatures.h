@@ -0,0 +1,16 @@
+#pragma once
+
+// x86 builds compile the SIMD kernels and pick one at runtime
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+// GCC/Clang only emit AVX2 instructions in functions that ask for them
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// True when the CPU and OS support AVX2, checked once
+bool cpuHasAVX2();
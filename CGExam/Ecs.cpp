@@ -0,0 +1,240 @@
+#include "Ecs.h"
+#include <algorithm>
+
+void initEcsWorld(EcsWorld& world) {
+	world.archetypes.clear();
+	world.entities.clear();
+	world.freeEntities.clear();
+	world.liveEntities = 0;
+}
+
+// Index of the archetype with exactly these components, created on first use
+static int findArchetype(EcsWorld& world, unsigned int components) {
+	for (size_t i = 0; i < world.archetypes.size(); ++i) {
+		if (world.archetypes[i].components == components)
+			return (int)i;
+	}
+	world.archetypes.push_back(Archetype());
+	world.archetypes.back().components = components;
+	return (int)world.archetypes.size() - 1;
+}
+
+// Append a row with the values of desc for the archetype's components
+static size_t appendRow(Archetype& archetype, Entity entity, const EntityDesc& desc) {
+	unsigned int components = archetype.components;
+	archetype.entities.push_back(entity);
+	if (components & COMPONENT_POSITION)
+		archetype.positions.push_back(desc.position);
+	if (components & COMPONENT_VELOCITY)
+		archetype.velocities.push_back(desc.velocity);
+	if (components & COMPONENT_SIZE)
+		archetype.sizes.push_back(desc.size);
+	if (components & COMPONENT_SPRITE)
+		archetype.sprites.push_back(desc.sprite);
+	if (components & COMPONENT_ANIMATION) {
+		int index = addAnimation(archetype.animations, desc.animation.frameCount, desc.animation.frameDuration, desc.animation.currentFrame);
+		archetype.animations.elapsedTime[index] = desc.animation.elapsedTime;
+	}
+	if (components & COMPONENT_HEALTH)
+		archetype.healths.push_back(desc.health);
+	return archetype.entities.size() - 1;
+}
+
+// Overwrite the components of desc that the archetype has with the values of a row
+static void readRow(const Archetype& archetype, size_t row, EntityDesc& desc) {
+	unsigned int components = archetype.components;
+	if (components & COMPONENT_POSITION)
+		desc.position = archetype.positions[row];
+	if (components & COMPONENT_VELOCITY)
+		desc.velocity = archetype.velocities[row];
+	if (components & COMPONENT_SIZE)
+		desc.size = archetype.sizes[row];
+	if (components & COMPONENT_SPRITE)
+		desc.sprite = archetype.sprites[row];
+	if (components & COMPONENT_ANIMATION) {
+		const AnimationStore& store = archetype.animations;
+		desc.animation = { store.elapsedTime[row], store.frameDuration[row], store.currentFrame[row], store.frameCount[row] };
+	}
+	if (components & COMPONENT_HEALTH)
+		desc.health = archetype.healths[row];
+}
+
+template <typename T>
+static void swapRemove(std::vector<T>& column, size_t row) {
+	column[row] = column.back();
+	column.pop_back();
+}
+
+// Remove a row, the last row takes its place; returns the entity that moved, or the removed one if none did
+static Entity removeRow(Archetype& archetype, size_t row) {
+	unsigned int components = archetype.components;
+	swapRemove(archetype.entities, row);
+	if (components & COMPONENT_POSITION)
+		swapRemove(archetype.positions, row);
+	if (components & COMPONENT_VELOCITY)
+		swapRemove(archetype.velocities, row);
+	if (components & COMPONENT_SIZE)
+		swapRemove(archetype.sizes, row);
+	if (components & COMPONENT_SPRITE)
+		swapRemove(archetype.sprites, row);
+	if (components & COMPONENT_ANIMATION) {
+		swapRemove(archetype.animations.elapsedTime, row);
+		swapRemove(archetype.animations.frameDuration, row);
+		swapRemove(archetype.animations.currentFrame, row);
+		swapRemove(archetype.animations.frameCount, row);
+	}
+	if (components & COMPONENT_HEALTH)
+		swapRemove(archetype.healths, row);
+	return row < archetype.entities.size() ? archetype.entities[row] : Entity{ 0, 0 };
+}
+
+// Take a row out of its archetype and point the entity that filled the hole at it
+static void detachRow(EcsWorld& world, const EntityRecord& record) {
+	Archetype& archetype = world.archetypes[record.archetype];
+	size_t last = archetype.entities.size() - 1;
+	Entity moved = removeRow(archetype, record.row);
+	if (record.row != last)
+		world.entities[moved.index].row = record.row;
+}
+
+Entity createEntity(EcsWorld& world, const EntityDesc& desc) {
+	uint32_t index;
+	if (!world.freeEntities.empty()) {
+		index = world.freeEntities.back();
+		world.freeEntities.pop_back();
+	}
+	else {
+		index = (uint32_t)world.entities.size();
+		world.entities.push_back({ -1, 0, 1 });
+	}
+	EntityRecord& record = world.entities[index];
+	Entity entity = { index, record.generation };
+	record.archetype = findArchetype(world, desc.components);
+	record.row = (uint32_t)appendRow(world.archetypes[record.archetype], entity, desc);
+	++world.liveEntities;
+	return entity;
+}
+
+bool entityAlive(const EcsWorld& world, Entity entity) {
+	return entity.index < world.entities.size() && world.entities[entity.index].archetype >= 0
+		&& world.entities[entity.index].generation == entity.generation;
+}
+
+bool destroyEntity(EcsWorld& world, Entity entity) {
+	if (!entityAlive(world, entity))
+		return false;
+	EntityRecord& record = world.entities[entity.index];
+	detachRow(world, record);
+	record.archetype = -1;
+	if (++record.generation == 0)  // Generation 0 never names a live entity
+		record.generation = 1;
+	world.freeEntities.push_back(entity.index);
+	--world.liveEntities;
+	return true;
+}
+
+bool setEntityComponents(EcsWorld& world, Entity entity, unsigned int components, const EntityDesc& values) {
+	if (!entityAlive(world, entity))
+		return false;
+	EntityRecord& record = world.entities[entity.index];
+	if (world.archetypes[record.archetype].components == components)
+		return true;
+
+	EntityDesc desc = values;
+	readRow(world.archetypes[record.archetype], record.row, desc);
+	desc.components = components;
+	int target = findArchetype(world, components);  // May grow archetypes, take references after
+	detachRow(world, record);
+	record.archetype = target;
+	record.row = (uint32_t)appendRow(world.archetypes[target], entity, desc);
+	return true;
+}
+
+Archetype* entityArchetype(EcsWorld& world, Entity entity, size_t& row) {
+	if (!entityAlive(world, entity))
+		return NULL;
+	const EntityRecord& record = world.entities[entity.index];
+	row = record.row;
+	return &world.archetypes[record.archetype];
+}
+
+EntityDesc spriteEntityDesc(const SpriteAnimation& animation) {
+	EntityDesc desc = EntityDesc();
+	desc.components = COMPONENT_POSITION | COMPONENT_SIZE | COMPONENT_SPRITE | COMPONENT_ANIMATION;
+	desc.position = { animation.x, animation.y, animation.prevX, animation.prevY };
+	desc.size = { animation.width, animation.height };
+	desc.sprite = { animation.textureID, animation.uvRect, animation.rows, animation.columns, RENDER_LAYER_WORLD };
+	desc.animation = { animation.elapsedTime, animation.frameDuration, animation.currentFrame, animation.frameCount };
+	return desc;
+}
+
+void initEcsSchedule(EcsSchedule& schedule, size_t chunkRows) {
+	schedule.systems.clear();
+	schedule.stages.clear();
+	schedule.stageCount = 0;
+	schedule.chunkRows = std::max<size_t>(1, chunkRows);
+	schedule.stats = EcsScheduleStats();
+}
+
+int addEcsSystem(EcsSchedule& schedule, const EcsSystem& system) {
+	int stage = 0;
+	for (size_t i = 0; i < schedule.systems.size(); ++i) {
+		const EcsSystem& earlier = schedule.systems[i];
+		if (componentsConflict(earlier.reads, earlier.writes, system.reads, system.writes))
+			stage = std::max(stage, schedule.stages[i] + 1);
+	}
+	schedule.systems.push_back(system);
+	schedule.stages.push_back(stage);
+	schedule.stageCount = std::max(schedule.stageCount, stage + 1);
+	return (int)schedule.systems.size() - 1;
+}
+
+static void runEcsChunk(void* context, size_t begin, size_t end) {
+	const EcsChunk& chunk = *(const EcsChunk*)context;
+	chunk.system->run(*chunk.archetype, begin, end, chunk.system->context);
+}
+
+void runEcsSchedule(EcsSchedule& schedule, EcsWorld& world, JobSystem& jobs) {
+	schedule.stats = EcsScheduleStats();
+	schedule.stats.stages = schedule.stageCount;
+	for (int stage = 0; stage < schedule.stageCount; ++stage) {
+		schedule.chunks.clear();
+		schedule.jobs.clear();
+		for (size_t i = 0; i < schedule.systems.size(); ++i) {
+			const EcsSystem& system = schedule.systems[i];
+			if (schedule.stages[i] != stage || system.mainThread)
+				continue;
+			unsigned int required = system.reads | system.writes;
+			for (Archetype& archetype : world.archetypes) {
+				if ((archetype.components & required) == required && !archetype.entities.empty())
+					schedule.chunks.push_back({ &system, &archetype });
+			}
+		}
+
+		// Chunk contexts are stable now that the list is complete
+		JobCounter counter;
+		for (const EcsChunk& chunk : schedule.chunks) {
+			size_t rows = chunk.archetype->entities.size();
+			schedule.stats.rows += rows;
+			for (size_t begin = 0; begin < rows; begin += schedule.chunkRows)
+				schedule.jobs.push_back({ runEcsChunk, (void*)&chunk, begin, std::min(rows, begin + schedule.chunkRows), &counter });
+		}
+		schedule.stats.jobs += (int)schedule.jobs.size();
+		submitJobs(jobs, schedule.jobs.data(), schedule.jobs.size());
+
+		for (size_t i = 0; i < schedule.systems.size(); ++i) {
+			const EcsSystem& system = schedule.systems[i];
+			if (schedule.stages[i] != stage || !system.mainThread)
+				continue;
+			unsigned int required = system.reads | system.writes;
+			for (Archetype& archetype : world.archetypes) {
+				size_t rows = archetype.entities.size();
+				if ((archetype.components & required) == required && rows > 0) {
+					schedule.stats.rows += rows;
+					system.run(archetype, 0, rows, system.context);
+				}
+			}
+		}
+		waitForCounter(jobs, counter);
+	}
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "AnimationStore.h"
+#include "SpriteAnimation.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+
+// Component types, as bits so a set of them fits in one mask
+enum ComponentType {
+	COMPONENT_POSITION = 1 << 0,
+	COMPONENT_VELOCITY = 1 << 1,
+	COMPONENT_SIZE = 1 << 2,
+	COMPONENT_SPRITE = 1 << 3,
+	COMPONENT_ANIMATION = 1 << 4,
+	COMPONENT_HEALTH = 1 << 5
+};
+
+struct PositionComponent {
+	float x, y;
+	float prevX, prevY;  // Position at the previous tick, rendering blends towards x, y
+};
+
+struct VelocityComponent {
+	float x, y;  // World units per second
+};
+
+struct SizeComponent {
+	float width, height;
+};
+
+// Sheet the entity is drawn from; the frame comes from its animation, frame 0 without one
+struct SpriteComponent {
+	GLuint textureID;
+	glm::vec4 uvRect;
+	int rows, columns;
+	unsigned int layer;  // RenderLayer it is drawn in
+};
+
+// Values of one animation, stored in the archetype's AnimationStore
+struct AnimationComponent {
+	float elapsedTime, frameDuration;
+	int currentFrame, frameCount;
+};
+
+struct HealthComponent {
+	float current, max;
+};
+
+// Names an entity. The index is reused after the entity is destroyed, the generation tells the two apart.
+struct Entity {
+	uint32_t index;
+	uint32_t generation;
+};
+
+// Every entity with the same set of components, one contiguous column per component. Only the columns
+// in components are used; removing a row moves the last row into its place.
+struct Archetype {
+	unsigned int components;
+	std::vector<Entity> entities;  // Entity of each row
+	std::vector<PositionComponent> positions;
+	std::vector<VelocityComponent> velocities;
+	std::vector<SizeComponent> sizes;
+	std::vector<SpriteComponent> sprites;
+	AnimationStore animations;
+	std::vector<HealthComponent> healths;
+};
+
+// Where an entity's row is
+struct EntityRecord {
+	int archetype;  // -1 while the index is free
+	uint32_t row;
+	uint32_t generation;
+};
+
+// Values for a new entity, only the components in the mask are stored
+struct EntityDesc {
+	unsigned int components;
+	PositionComponent position;
+	VelocityComponent velocity;
+	SizeComponent size;
+	SpriteComponent sprite;
+	AnimationComponent animation;
+	HealthComponent health;
+};
+
+struct EcsWorld {
+	std::vector<Archetype> archetypes;
+	std::vector<EntityRecord> entities;  // Indexed by Entity::index
+	std::vector<uint32_t> freeEntities;
+	size_t liveEntities;
+};
+
+// Start an empty world
+void initEcsWorld(EcsWorld& world);
+
+// Create an entity in the archetype of desc.components
+Entity createEntity(EcsWorld& world, const EntityDesc& desc);
+
+// Destroy an entity, false if it was already gone
+bool destroyEntity(EcsWorld& world, Entity entity);
+
+// Whether an entity still exists
+bool entityAlive(const EcsWorld& world, Entity entity);
+
+// Move an entity to the archetype of a new component set. Components it keeps keep their values,
+// added ones are taken from values. False if the entity is gone.
+bool setEntityComponents(EcsWorld& world, Entity entity, unsigned int components, const EntityDesc& values);
+
+// Archetype and row of an entity, NULL if it is gone. Valid until the next structural change.
+Archetype* entityArchetype(EcsWorld& world, Entity entity, size_t& row);
+
+// Desc of a sprite entity with its position, size, sheet and animation timing, drawn in the world layer
+EntityDesc spriteEntityDesc(const SpriteAnimation& animation);
+
+// Whether two component sets conflict, one writing what the other reads or writes
+inline bool componentsConflict(unsigned int readsA, unsigned int writesA, unsigned int readsB, unsigned int writesB) {
+	return (writesA & (readsB | writesB)) != 0 || (writesB & readsA) != 0;
+}
+
+// Work over the rows of every archetype that has all the components the system reads and writes.
+// Systems must not create or destroy entities while the schedule runs.
+struct EcsSystem {
+	const char* name;
+	unsigned int reads, writes;
+	bool mainThread;  // Runs on the thread calling runEcsSchedule, for GL calls and shared state
+	void (*run)(Archetype& archetype, size_t begin, size_t end, void* context);
+	void* context;
+};
+
+// Counters of the last runEcsSchedule
+struct EcsScheduleStats {
+	int stages;
+	int jobs;  // Archetype chunks handed to the job system
+	size_t rows;
+};
+
+// A system and the archetype it runs over, the context of its jobs
+struct EcsChunk {
+	const EcsSystem* system;
+	Archetype* archetype;
+};
+
+// Systems in stages: a system goes in the first stage after every earlier system it conflicts with,
+// so systems of one stage can run at once and each stage still sees the writes of the earlier ones
+struct EcsSchedule {
+	std::vector<EcsSystem> systems;
+	std::vector<int> stages;  // Stage of each system
+	int stageCount;
+	size_t chunkRows;         // Largest range of rows per job
+
+	std::vector<EcsChunk> chunks;
+	std::vector<Job> jobs;
+	EcsScheduleStats stats;
+};
+
+// Start an empty schedule; rows of an archetype are split into jobs of at most chunkRows
+void initEcsSchedule(EcsSchedule& schedule, size_t chunkRows = 16384);
+
+// Append a system and return its index
+int addEcsSystem(EcsSchedule& schedule, const EcsSystem& system);
+
+// Run every stage in order. The jobs of a stage are queued first, so the workers start on them while the
+// calling thread runs the stage's main thread systems and then helps with the rest.
+void runEcsSchedule(EcsSchedule& schedule, EcsWorld& world, JobSystem& jobs);
@@ -0,0 +1,108 @@
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+// Beyond this a frame is treated as a hitch (debugger, window drag) rather than time to simulate
+static const double MAX_FRAME_SECONDS = 0.25;
+
+static void resetReport(FrameScheduler& scheduler, Uint64 now) {
+	scheduler.reportStart = now;
+	for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase)
+		scheduler.phaseCounts[phase] = 0;
+	scheduler.reportFrames = 0;
+	scheduler.reportTicks = 0;
+	scheduler.reportDropped = 0;
+}
+
+void initFrameScheduler(FrameScheduler& scheduler, double tickRate, int maxTicksPerFrame) {
+	scheduler.frequency = SDL_GetPerformanceFrequency();
+	scheduler.tickCounts = std::max<Uint64>(1, (Uint64)(scheduler.frequency / tickRate));
+	scheduler.tickSeconds = (float)((double)scheduler.tickCounts / scheduler.frequency);
+	scheduler.maxFrameCounts = (Uint64)(scheduler.frequency * MAX_FRAME_SECONDS);
+	scheduler.maxTicksPerFrame = std::max(1, maxTicksPerFrame);
+	scheduler.fixedTicks = 0;
+	scheduler.accumulator = 0;
+	scheduler.lastFrame = SDL_GetPerformanceCounter();
+	scheduler.phaseStart = scheduler.lastFrame;
+	resetReport(scheduler, scheduler.lastFrame);
+}
+
+void setFixedTicksPerFrame(FrameScheduler& scheduler, int ticks) {
+	scheduler.fixedTicks = std::max(0, ticks);
+	scheduler.accumulator = 0;
+}
+
+int beginFrame(FrameScheduler& scheduler) {
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 elapsed = std::min(now - scheduler.lastFrame, scheduler.maxFrameCounts);
+	scheduler.lastFrame = now;
+	scheduler.phaseStart = now;
+	scheduler.reportFrames++;
+
+	if (scheduler.fixedTicks > 0) {
+		scheduler.reportTicks += scheduler.fixedTicks;
+		return scheduler.fixedTicks;
+	}
+
+	scheduler.accumulator += elapsed;
+	Uint64 ticks = scheduler.accumulator / scheduler.tickCounts;
+	scheduler.accumulator -= ticks * scheduler.tickCounts;
+
+	// If the simulation can't keep up, running every tick would make the next frame longer still
+	if (ticks > (Uint64)scheduler.maxTicksPerFrame) {
+		scheduler.reportDropped += (int)(ticks - scheduler.maxTicksPerFrame);
+		ticks = scheduler.maxTicksPerFrame;
+	}
+	scheduler.reportTicks += (int)ticks;
+	return (int)ticks;
+}
+
+float interpolationAlpha(const FrameScheduler& scheduler) {
+	return (float)((double)scheduler.accumulator / scheduler.tickCounts);
+}
+
+void endPhase(FrameScheduler& scheduler, FramePhase phase) {
+	Uint64 now = SDL_GetPerformanceCounter();
+	scheduler.phaseCounts[phase] += now - scheduler.phaseStart;
+	scheduler.phaseStart = now;
+}
+
+bool takeFrameReport(FrameScheduler& scheduler, FrameReport& report, double intervalSeconds) {
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (scheduler.reportFrames == 0 || now - scheduler.reportStart < (Uint64)(intervalSeconds * scheduler.frequency))
+		return false;
+
+	double toMs = 1000.0 / scheduler.frequency / scheduler.reportFrames;
+	report.frames = scheduler.reportFrames;
+	report.frameMs = (now - scheduler.reportStart) * toMs;
+	report.fps = 1000.0 / report.frameMs;
+	report.ticks = scheduler.reportTicks;
+	report.droppedTicks = scheduler.reportDropped;
+	for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase)
+		report.phaseMs[phase] = scheduler.phaseCounts[phase] * toMs;
+
+	resetReport(scheduler, now);
+	return true;
+}
+
+const char* framePhaseName(FramePhase phase) {
+	switch (phase) {
+	case FRAME_PHASE_INPUT: return "input";
+	case FRAME_PHASE_UPDATE: return "update";
+	case FRAME_PHASE_RENDER: return "render";
+	case FRAME_PHASE_PRESENT: return "present";
+	default: return "?";
+	}
+}
+
+void printFrameReport(const FrameReport& report) {
+	std::cout << std::fixed << std::setprecision(2) << report.fps << " fps, " << report.ticks << " ticks";
+	if (report.droppedTicks > 0)
+		std::cout << " (" << report.droppedTicks << " dropped)";
+	std::cout << ", frame " << report.frameMs << " ms:";
+	for (int phase = 0; phase < FRAME_PHASE_COUNT; ++phase)
+		std::cout << " " << framePhaseName((FramePhase)phase) << " " << report.phaseMs[phase];
+	std::cout << std::endl;
+	std::cout.unsetf(std::ios::fixed);
+}
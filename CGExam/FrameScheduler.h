@@ -0,0 +1,69 @@
+#pragma once
+#include <SDL.h>
+
+// Parts of a frame that are timed separately
+enum FramePhase {
+	FRAME_PHASE_INPUT,
+	FRAME_PHASE_UPDATE,
+	FRAME_PHASE_RENDER,
+	FRAME_PHASE_PRESENT,
+	FRAME_PHASE_COUNT
+};
+
+// Averages over the frames since the previous report
+struct FrameReport {
+	int frames;
+	double fps;
+	int ticks;
+	int droppedTicks;          // Ticks skipped by the spiral-of-death guard
+	double frameMs;
+	double phaseMs[FRAME_PHASE_COUNT];
+};
+
+// Runs the simulation at a fixed tick rate on the high resolution counter, independent of the render rate
+struct FrameScheduler {
+	Uint64 frequency;
+	Uint64 tickCounts;         // Counter units per tick
+	Uint64 maxFrameCounts;     // Longest frame the simulation will try to catch up on
+	Uint64 accumulator;        // Counter units not yet simulated
+	Uint64 lastFrame;
+	Uint64 phaseStart;
+	int maxTicksPerFrame;
+	int fixedTicks;            // Ticks per frame regardless of time when > 0, for reproducible runs
+	float tickSeconds;
+
+	// Running totals for the next report
+	Uint64 reportStart;
+	Uint64 phaseCounts[FRAME_PHASE_COUNT];
+	int reportFrames, reportTicks, reportDropped;
+};
+
+// Set up a scheduler ticking tickRate times per second, running at most maxTicksPerFrame ticks per frame
+void initFrameScheduler(FrameScheduler& scheduler, double tickRate, int maxTicksPerFrame = 8);
+
+// Run exactly ticks ticks every frame whatever the clock says (0 goes back to real time), so
+// the nth frame always shows the same simulation state
+void setFixedTicksPerFrame(FrameScheduler& scheduler, int ticks);
+
+// Start a frame and return how many simulation ticks to run; time the guard can't catch up on is dropped
+int beginFrame(FrameScheduler& scheduler);
+
+// Simulation step in seconds
+inline float tickDelta(const FrameScheduler& scheduler) {
+	return scheduler.tickSeconds;
+}
+
+// How far between the last two ticks the rendered frame is, 0..1
+float interpolationAlpha(const FrameScheduler& scheduler);
+
+// Charge the time since the previous phase ended (or the frame began) to a phase
+void endPhase(FrameScheduler& scheduler, FramePhase phase);
+
+// Fill report with the averages once every intervalSeconds and start a new interval
+bool takeFrameReport(FrameScheduler& scheduler, FrameReport& report, double intervalSeconds = 1.0);
+
+// Printable name of a phase
+const char* framePhaseName(FramePhase phase);
+
+// Print a report as one line on stdout
+void printFrameReport(const FrameReport& report);
@@ -0,0 +1,147 @@
+#include "GLUtils.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "Image.h"
+#include <glm/gtc/type_ptr.hpp>
+
+// Compile shader and handle errors
+GLuint compileShader(const char* source, GLenum shaderType) {
+	GLuint shader = glCreateShader(shaderType);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		std::cerr << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+	return shader;
+}
+
+// Link shaders into a program
+GLuint linkShaderProgram(GLuint vertexShader, GLuint fragmentShader) {
+	GLuint shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, vertexShader);
+	glAttachShader(shaderProgram, fragmentShader);
+	glLinkProgram(shaderProgram);
+
+	GLint success;
+	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+	if (!success) {
+		GLchar infoLog[512];
+		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+		std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+
+	return shaderProgram;
+}
+
+// Upload RGBA pixels as a mipmapped texture
+GLuint createTexture(const unsigned char* pixels, int width, int height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return texture;
+}
+
+// Load texture with color keying
+GLuint loadTexture(const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	int width, height;
+	unsigned char* image = loadImage(filepath, colorKey, applyColorKey, width, height);
+	if (!image)
+		return 0;
+
+	GLuint texture = createTexture(image, width, height);
+	freeImage(image);
+	return texture;
+}
+
+// S3TC internal formats, from EXT_texture_compression_s3tc which the core profile loader leaves out
+const GLenum COMPRESSED_RGBA_S3TC_DXT1 = 0x83F1;
+const GLenum COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+bool textureCompressionSupported() {
+	static const bool supported = [] {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; ++i) {
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+				return true;
+		}
+		return false;
+	}();
+	return supported;
+}
+
+TextureFormat gpuTextureFormat(TextureFormat format) {
+	return format != TEXTURE_FORMAT_RGBA8 && !textureCompressionSupported() ? TEXTURE_FORMAT_RGBA8 : format;
+}
+
+GLuint createTextureLevels(const unsigned char* levels, int width, int height, int mipLevels, TextureFormat format) {
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	bool expand = gpuTextureFormat(format) != format;
+	std::vector<unsigned char> expanded;
+	for (int level = 0; level < mipLevels; ++level) {
+		if (format == TEXTURE_FORMAT_RGBA8)
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels);
+		else if (expand) {
+			expanded.resize((size_t)width * height * 4);
+			decompressImage(levels, width, height, format, expanded.data());
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, expanded.data());
+		}
+		else {
+			GLenum internalFormat = format == TEXTURE_FORMAT_BC1 ? COMPRESSED_RGBA_S3TC_DXT1 : COMPRESSED_RGBA_S3TC_DXT5;
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, (GLsizei)textureLevelBytes(format, width, height), levels);
+		}
+		levels += textureLevelBytes(format, width, height);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return textureID;
+}
+
+// Upload a cooked texture together with its precomputed mip chain
+GLuint createPackedTexture(const TexturePack& pack, const PackedTexture& texture) {
+	return createTextureLevels(pack.data + texture.dataOffset, (int)texture.width, (int)texture.height, (int)texture.mipCount,
+		(TextureFormat)texture.format);
+}
+
+// Load texture from a cooked pack, falling back to decoding the source image when it isn't in the pack
+GLuint loadTexture(const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	const PackedTexture* texture = findPackedTexture(pack, filepath, colorKey, applyColorKey);
+	if (texture)
+		return createPackedTexture(pack, *texture);
+	return loadTexture(filepath, colorKey, applyColorKey);
+}
+
+// Render any textured object (in this case for the animations and background)
+void renderObject(GLuint VAO, GLuint texture, const glm::mat4& model, const ShaderProgram& program) {
+	useShaderProgram(program);
+	glUniformMatrix4fv(program.modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "TexturePack.h"
+#include "ShaderProgram.h"
+
+// Compile shader and handle errors
+GLuint compileShader(const char* source, GLenum shaderType);
+
+// Link shaders into a program
+GLuint linkShaderProgram(GLuint vertexShader, GLuint fragmentShader);
+
+// Upload RGBA pixels as a mipmapped texture
+GLuint createTexture(const unsigned char* pixels, int width, int height);
+
+// Whether the driver takes BC1/BC3 (S3TC) blocks as they are, checked once
+bool textureCompressionSupported();
+
+// Format a texture stored in one format takes on the GPU: block compressed ones are expanded to RGBA8
+// when the driver can't sample them
+TextureFormat gpuTextureFormat(TextureFormat format);
+
+// Upload a mip chain laid out level after level in one format, compressed levels with glCompressedTexImage2D
+GLuint createTextureLevels(const unsigned char* levels, int width, int height, int mipLevels, TextureFormat format);
+
+// Upload a cooked texture together with its precomputed mip chain
+GLuint createPackedTexture(const TexturePack& pack, const PackedTexture& texture);
+
+// Load texture with color keying
+GLuint loadTexture(const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Load texture from a cooked pack, falling back to decoding the source image when it isn't in the pack
+GLuint loadTexture(const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Render any textured object (in this case for the animations and background)
+// View/projection come from the shared camera block
+void renderObject(GLuint VAO, GLuint texture, const glm::mat4& model, const ShaderProgram& program);
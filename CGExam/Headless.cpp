@@ -0,0 +1,115 @@
+#include "Headless.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool parseHeadlessArg(HeadlessRun& run, int argc, char* args[], int& i) {
+	if (std::strcmp(args[i], "--headless") == 0 && i + 1 < argc)
+		run.frames = std::max(1, std::atoi(args[++i]));
+	else if (std::strcmp(args[i], "--dump-frame") == 0 && i + 1 < argc)
+		run.dumpFrames.push_back(std::atoi(args[++i]));
+	else if (std::strcmp(args[i], "--dump-prefix") == 0 && i + 1 < argc)
+		run.dumpPrefix = args[++i];
+	else
+		return false;
+	return true;
+}
+
+bool initHeadlessVideo() {
+	// The offscreen driver renders through EGL (llvmpipe on GPU-less Mesa boxes) and needs no display.
+	// SDL_VIDEODRIVER in the environment still wins over this hint.
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+	if (SDL_Init(SDL_INIT_VIDEO) == 0)
+		return true;
+
+	std::cerr << "Offscreen video driver unavailable (" << SDL_GetError() << "), using a hidden window" << std::endl;
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, NULL);
+	return SDL_Init(SDL_INIT_VIDEO) == 0;
+}
+
+bool beginHeadlessRun(HeadlessRun& run, int width, int height, bool depth) {
+	run.width = width;
+	run.height = height;
+	run.depthBuffer = 0;
+
+	glGenFramebuffers(1, &run.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, run.fbo);
+	glGenRenderbuffers(1, &run.colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, run.colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, run.colorBuffer);
+	if (depth) {
+		glGenRenderbuffers(1, &run.depthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, run.depthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, run.depthBuffer);
+	}
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cerr << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		return false;
+	}
+	glViewport(0, 0, width, height);
+
+	run.frame = 0;
+	run.frameMs.clear();
+	run.frameMs.reserve(run.frames);
+	return true;
+}
+
+bool finishHeadlessFrame(HeadlessRun& run, Uint64 frameStart) {
+	// Nothing is presented, so wait here to charge the GPU work to the frame that issued it
+	glFinish();
+	run.frameMs.push_back((SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency());
+
+	if (std::find(run.dumpFrames.begin(), run.dumpFrames.end(), run.frame) != run.dumpFrames.end()) {
+		char path[512];
+		std::snprintf(path, sizeof(path), "%s_%04d.ppm", run.dumpPrefix.empty() ? "frame" : run.dumpPrefix.c_str(), run.frame);
+		if (!writeFramePPM(path, run.width, run.height))
+			std::cerr << "ERROR::HEADLESS::DUMP_FAILED " << path << std::endl;
+	}
+	return ++run.frame < run.frames;
+}
+
+void endHeadlessRun(HeadlessRun& run) {
+	if (!run.frameMs.empty()) {
+		std::vector<double> sorted = run.frameMs;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double ms : sorted)
+			total += ms;
+		size_t count = sorted.size();
+
+		std::cout << std::fixed << std::setprecision(3) << "Headless: " << count << " frames at " << run.width << "x" << run.height
+			<< " in " << total << " ms, avg " << total / count << " ms, min " << sorted.front()
+			<< ", p50 " << sorted[count / 2] << ", p95 " << sorted[std::min(count - 1, count * 95 / 100)]
+			<< ", max " << sorted.back() << std::endl;
+		std::cout.unsetf(std::ios::fixed);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &run.fbo);
+	glDeleteRenderbuffers(1, &run.colorBuffer);
+	if (run.depthBuffer)
+		glDeleteRenderbuffers(1, &run.depthBuffer);
+}
+
+bool writeFramePPM(const char* path, int width, int height) {
+	std::vector<unsigned char> pixels((size_t)width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+	out << "P6\n" << width << " " << height << "\n255\n";
+	// GL rows start at the bottom
+	for (int y = height - 1; y >= 0; --y)
+		out.write((const char*)pixels.data() + (size_t)y * width * 3, (std::streamsize)width * 3);
+	return (bool)out;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <glad/glad.h>
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+// Renders a fixed number of frames into an FBO without showing a window, for batch benchmarks and image diffs
+struct HeadlessRun {
+	int frames;                   // Frames to render, 0 when running normally
+	std::vector<int> dumpFrames;  // Frames written out as PPM, counted from 0
+	std::string dumpPrefix;       // Dumps go to <prefix>_<frame>.ppm
+
+	GLuint fbo, colorBuffer, depthBuffer;
+	int width, height;
+
+	int frame;
+	std::vector<double> frameMs;
+};
+
+// Consume --headless N, --dump-frame N and --dump-prefix PATH at args[i]; returns false for other arguments
+bool parseHeadlessArg(HeadlessRun& run, int argc, char* args[], int& i);
+
+// SDL_Init with the offscreen video driver, falling back to the default driver (used with a hidden window)
+bool initHeadlessVideo();
+
+// Create the FBO and bind it for every following draw
+bool beginHeadlessRun(HeadlessRun& run, int width, int height, bool depth);
+
+// Wait for the frame started at frameStart, time it and dump it if asked; returns false once all frames are done
+bool finishHeadlessFrame(HeadlessRun& run, Uint64 frameStart);
+
+// Print frame time statistics and release the FBO
+void endHeadlessRun(HeadlessRun& run);
+
+// Write the bound framebuffer as a binary PPM, top row first
+bool writeFramePPM(const char* path, int width, int height);
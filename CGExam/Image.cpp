@@ -0,0 +1,58 @@
+#include "Image.h"
+#include "BmpDecoder.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include "stb_image.h"
+
+// Load image pixels as premultiplied RGBA with color keying, our 24-bit BMPs take the fused decoder
+unsigned char* loadImage(const char* filepath, const glm::vec3& colorKey, bool applyColorKey, int& width, int& height) {
+	std::ifstream in(filepath, std::ios::binary | std::ios::ate);
+	if (in.is_open()) {
+		std::vector<unsigned char> file((size_t)in.tellg());
+		in.seekg(0);
+		if (in.read((char*)file.data(), file.size())) {
+			unsigned char* image = decodeBmp24(file.data(), file.size(), colorKey, applyColorKey, width, height);
+			if (image)
+				return image;
+		}
+	}
+	return loadImageStb(filepath, colorKey, applyColorKey, width, height);
+}
+
+// Load image pixels through stb_image, for formats the BMP decoder doesn't handle
+unsigned char* loadImageStb(const char* filepath, const glm::vec3& colorKey, bool applyColorKey, int& width, int& height) {
+	stbi_set_flip_vertically_on_load_thread(true);
+	int channels;
+	unsigned char* image = stbi_load(filepath, &width, &height, &channels, STBI_rgb_alpha);
+	if (!image) {
+		std::cerr << "Failed to load texture: " << filepath << ". Reason: " << stbi_failure_reason() << std::endl;
+		return NULL;
+	}
+	//runs all pixels to see which have pink rgb to set it transparent
+	//then scales the color of the rest by their alpha, images with alpha of their own come out premultiplied too
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			int index = (y * width + x) * 4;
+			if (applyColorKey &&
+				image[index] == static_cast<unsigned char>(colorKey.r) &&
+				image[index + 1] == static_cast<unsigned char>(colorKey.g) &&
+				image[index + 2] == static_cast<unsigned char>(colorKey.b)) {
+				std::memset(&image[index], 0, 4); // Make the color transparent
+				continue;
+			}
+			unsigned int alpha = image[index + 3];
+			if (alpha == 255)
+				continue;
+			for (int c = 0; c < 3; ++c)
+				image[index + c] = (unsigned char)((image[index + c] * alpha + 127) / 255);
+		}
+	}
+	return image;
+}
+
+// Release pixels returned by loadImage
+void freeImage(unsigned char* image) {
+	stbi_image_free(image);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Load image pixels as premultiplied RGBA with color keying, rows bottom to top as GL expects
+unsigned char* loadImage(const char* filepath, const glm::vec3& colorKey, bool applyColorKey, int& width, int& height);
+
+// Same as loadImage but always through stb_image, used for other formats and as the benchmark baseline
+unsigned char* loadImageStb(const char* filepath, const glm::vec3& colorKey, bool applyColorKey, int& width, int& height);
+
+// Release pixels returned by loadImage
+void freeImage(unsigned char* image);
@@ -0,0 +1,216 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+// Queue of the calling thread: workers know theirs, every other thread shares queue 0
+static thread_local const JobSystem* workerSystem = NULL;
+static thread_local int workerQueue = 0;
+
+static int currentQueue(const JobSystem& system) {
+	return workerSystem == &system ? workerQueue : 0;
+}
+
+static void lockQueue(JobQueue& queue) {
+	while (queue.lock.test_and_set(std::memory_order_acquire))
+		std::this_thread::yield();
+}
+
+static void unlockQueue(JobQueue& queue) {
+	queue.lock.clear(std::memory_order_release);
+}
+
+static void pushJob(JobQueue& queue, const Job& job) {
+	lockQueue(queue);
+	size_t capacity = queue.jobs.size();
+	if (queue.bottom - queue.top == capacity) {
+		// Full, unwrap into a ring twice the size
+		std::vector<Job> grown(capacity * 2);
+		for (size_t i = queue.top; i != queue.bottom; ++i)
+			grown[i - queue.top] = queue.jobs[i & (capacity - 1)];
+		queue.bottom -= queue.top;
+		queue.top = 0;
+		queue.jobs.swap(grown);
+		capacity *= 2;
+	}
+	queue.jobs[queue.bottom++ & (capacity - 1)] = job;
+	unlockQueue(queue);
+}
+
+// Newest job of the owner's queue
+static bool popJob(JobQueue& queue, Job& job) {
+	lockQueue(queue);
+	bool found = queue.bottom != queue.top;
+	if (found)
+		job = queue.jobs[--queue.bottom & (queue.jobs.size() - 1)];
+	unlockQueue(queue);
+	return found;
+}
+
+// Oldest job of another thread's queue
+static bool stealJob(JobQueue& queue, Job& job) {
+	if (queue.lock.test_and_set(std::memory_order_acquire))
+		return false;  // Someone is already at it, try the next queue
+	bool found = queue.bottom != queue.top;
+	if (found)
+		job = queue.jobs[queue.top++ & (queue.jobs.size() - 1)];
+	unlockQueue(queue);
+	return found;
+}
+
+static void wakeWorkers(JobSystem& system, size_t jobs) {
+	if (system.sleeping.load() == 0)
+		return;
+	// Taking the lock orders this after a worker's check of queuedJobs, so no wakeup is lost
+	{
+		std::lock_guard<std::mutex> lock(system.sleepMutex);
+	}
+	if (jobs == 1)
+		system.wake.notify_one();
+	else
+		system.wake.notify_all();
+}
+
+static void queueJobs(JobSystem& system, const Job* jobs, size_t count) {
+	JobQueue& queue = system.queues[currentQueue(system)];
+	for (size_t i = 0; i < count; ++i)
+		pushJob(queue, jobs[i]);
+	system.queuedJobs.fetch_add((int)count);
+	wakeWorkers(system, count);
+}
+
+// Take a job from our own queue, or steal one going round the others
+static bool takeJob(JobSystem& system, int queue, Job& job) {
+	if (popJob(system.queues[queue], job)) {
+		system.queuedJobs.fetch_sub(1);
+		return true;
+	}
+	for (int i = 1; i < system.queueCount; ++i) {
+		if (stealJob(system.queues[(queue + i) % system.queueCount], job)) {
+			system.queuedJobs.fetch_sub(1);
+			system.stats.steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Queue the jobs that were waiting for a counter that just reached zero
+static void releaseBlocked(JobSystem& system, const JobCounter* counter) {
+	std::lock_guard<std::mutex> lock(system.blockedMutex);
+	for (size_t i = 0; i < system.blocked.size();) {
+		if (system.blocked[i].after == counter) {
+			queueJobs(system, &system.blocked[i].job, 1);
+			system.blocked[i] = system.blocked.back();
+			system.blocked.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+static void runJob(JobSystem& system, const Job& job) {
+	job.run(job.context, job.begin, job.end);
+	system.stats.jobs.fetch_add(1, std::memory_order_relaxed);
+	if (job.counter && job.counter->pending.fetch_sub(1) == 1)
+		releaseBlocked(system, job.counter);
+}
+
+static void jobWorker(JobSystem& system, int queue) {
+	workerSystem = &system;
+	workerQueue = queue;
+	Job job;
+	while (!system.stopping.load()) {
+		if (takeJob(system, queue, job)) {
+			runJob(system, job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(system.sleepMutex);
+		system.sleeping.fetch_add(1);
+		system.wake.wait(lock, [&system] { return system.stopping.load() || system.queuedJobs.load() > 0; });
+		system.sleeping.fetch_sub(1);
+	}
+}
+
+void initJobSystem(JobSystem& system, int workerCount) {
+	system.queueCount = workerCount + 1;
+	system.queues.reset(new JobQueue[system.queueCount]);
+	for (int i = 0; i < system.queueCount; ++i) {
+		system.queues[i].jobs.resize(256);
+		system.queues[i].top = 0;
+		system.queues[i].bottom = 0;
+	}
+	system.blocked.clear();
+	system.queuedJobs = 0;
+	system.sleeping = 0;
+	system.stopping = false;
+	system.stats.jobs = 0;
+	system.stats.steals = 0;
+	for (int i = 1; i <= workerCount; ++i)
+		system.threads.emplace_back(jobWorker, std::ref(system), i);
+}
+
+void destroyJobSystem(JobSystem& system) {
+	{
+		std::lock_guard<std::mutex> lock(system.sleepMutex);
+		system.stopping = true;
+	}
+	system.wake.notify_all();
+	for (std::thread& thread : system.threads)
+		thread.join();
+	system.threads.clear();
+}
+
+void submitJobs(JobSystem& system, const Job* jobs, size_t count, const JobCounter* after) {
+	if (count == 0)
+		return;
+	for (size_t i = 0; i < count; ++i) {
+		if (jobs[i].counter)
+			jobs[i].counter->pending.fetch_add(1);
+	}
+
+	if (after) {
+		// Checked under the lock, so a counter reaching zero either sees these jobs or is seen here
+		std::lock_guard<std::mutex> lock(system.blockedMutex);
+		if (after->pending.load() > 0) {
+			for (size_t i = 0; i < count; ++i)
+				system.blocked.push_back({ jobs[i], after });
+			return;
+		}
+	}
+	queueJobs(system, jobs, count);
+}
+
+void waitForCounter(JobSystem& system, const JobCounter& counter) {
+	int queue = currentQueue(system);
+	Job job;
+	while (counter.pending.load() > 0) {
+		if (takeJob(system, queue, job))
+			runJob(system, job);
+		else
+			std::this_thread::yield();  // The last jobs are running elsewhere
+	}
+}
+
+void parallelFor(JobSystem& system, size_t count, size_t grain, void (*run)(void* context, size_t begin, size_t end), void* context) {
+	grain = std::max<size_t>(1, grain);
+	if (count <= grain || system.queueCount == 1) {
+		if (count > 0)
+			run(context, 0, count);
+		return;
+	}
+
+	JobCounter counter;
+	JobQueue& queue = system.queues[currentQueue(system)];
+	size_t jobs = 0;
+	for (size_t begin = 0; begin < count; begin += grain, ++jobs) {
+		counter.pending.fetch_add(1);
+		pushJob(queue, { run, context, begin, std::min(count, begin + grain), &counter });
+	}
+	system.queuedJobs.fetch_add((int)jobs);
+	wakeWorkers(system, jobs);
+	waitForCounter(system, counter);
+}
+
+int defaultWorkerThreads() {
+	int cores = (int)std::thread::hardware_concurrency();
+	return std::max(0, cores - 1);
+}
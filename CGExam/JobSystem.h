@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts unfinished jobs; jobs can be held back until one reaches zero
+struct JobCounter {
+	std::atomic<int> pending;
+
+	JobCounter() : pending(0) {}
+};
+
+// A range of work, run as run(context, begin, end) on any thread
+struct Job {
+	void (*run)(void* context, size_t begin, size_t end);
+	void* context;
+	size_t begin, end;
+	JobCounter* counter;  // Counted down when the job is done, may be NULL
+};
+
+// Ring of jobs owned by one thread. The owner pushes and pops at the bottom, newest first, so it keeps
+// working on what is warm in its cache; other threads steal from the top, the oldest and usually largest.
+struct JobQueue {
+	std::atomic_flag lock = ATOMIC_FLAG_INIT;  // Held for a few instructions, spun on
+	std::vector<Job> jobs;                     // Capacity is a power of two
+	size_t top, bottom;                        // Live jobs are [top, bottom), indices wrap
+};
+
+// A job waiting for a counter to reach zero before it is queued
+struct BlockedJob {
+	Job job;
+	const JobCounter* after;
+};
+
+struct JobSystemStats {
+	std::atomic<size_t> jobs;
+	std::atomic<size_t> steals;  // Jobs taken from another thread's queue
+};
+
+// Work-stealing scheduler. queues[0] belongs to the thread that called initJobSystem, the rest to the
+// workers. Idle workers steal from the others before going to sleep.
+struct JobSystem {
+	std::vector<std::thread> threads;
+	std::unique_ptr<JobQueue[]> queues;
+	int queueCount;
+
+	std::mutex blockedMutex;
+	std::vector<BlockedJob> blocked;
+
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleeping;
+	std::atomic<bool> stopping;
+
+	JobSystemStats stats;
+};
+
+// Start workerCount threads besides the calling one; with 0 every job runs on the thread that waits for it
+void initJobSystem(JobSystem& system, int workerCount);
+
+// Stop and join the workers; every submitted job must have been waited for
+void destroyJobSystem(JobSystem& system);
+
+// Queue jobs on the calling thread's queue. Their counters are counted up before any of them can run.
+// With after, the jobs are held back until that counter reaches zero.
+void submitJobs(JobSystem& system, const Job* jobs, size_t count, const JobCounter* after = NULL);
+
+// Run queued jobs, stealing if need be, until the counter reaches zero
+void waitForCounter(JobSystem& system, const JobCounter& counter);
+
+// Split [0, count) into ranges of at most grain and run them on every thread, returns when all are done
+void parallelFor(JobSystem& system, size_t count, size_t grain, void (*run)(void* context, size_t begin, size_t end), void* context);
+
+// Threads that take part in the work, the calling one included
+inline int jobThreads(const JobSystem& system) {
+	return system.queueCount;
+}
+
+// Worker count matching the machine, keeping one core for the calling thread
+int defaultWorkerThreads();
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Names an object in a pool. The slot's generation changes every time its object is despawned,
+// so a handle kept past despawn no longer matches and is detected as stale. Generation 0 is never
+// handed out, a zeroed handle is always null.
+struct PoolHandle {
+	uint32_t slot;
+	uint32_t generation;
+};
+
+const PoolHandle NULL_POOL_HANDLE = { 0, 0 };
+
+struct ObjectPoolStats {
+	size_t spawned;
+	size_t despawned;
+	size_t failed;  // Spawns refused because the pool was full
+	size_t stale;   // Lookups and despawns through a handle whose object is gone
+};
+
+// Fixed capacity pool of T with generational handles. Live objects are packed at the front of
+// objects so iterating them is a plain loop over [0, count); despawning moves the last live object
+// into the hole. Every array is sized by initObjectPool and never grows, spawning never allocates.
+template <typename T>
+struct ObjectPool {
+	size_t capacity;
+	size_t count;
+
+	std::vector<T> objects;              // Dense, live objects are [0, count)
+	std::vector<uint32_t> objectSlot;    // Slot of objects[i]
+	std::vector<uint32_t> slotObject;    // Index in objects of a live slot's object
+	std::vector<uint32_t> generations;   // Current generation of each slot
+	std::vector<uint32_t> freeSlots;     // Stack of unused slots, [0, capacity - count)
+
+	ObjectPoolStats stats;
+};
+
+// Size every array of a pool for capacity objects, with all slots free
+template <typename T>
+void initObjectPool(ObjectPool<T>& pool, size_t capacity) {
+	pool.capacity = capacity;
+	pool.count = 0;
+	pool.objects.assign(capacity, T());
+	pool.objectSlot.assign(capacity, 0);
+	pool.slotObject.assign(capacity, 0);
+	pool.generations.assign(capacity, 1);
+	pool.freeSlots.resize(capacity);
+	for (size_t i = 0; i < capacity; ++i)
+		pool.freeSlots[i] = (uint32_t)(capacity - 1 - i);  // Lowest slot on top
+	pool.stats = ObjectPoolStats();
+}
+
+// Copy value into a free slot and return its handle, or NULL_POOL_HANDLE when the pool is full
+template <typename T>
+PoolHandle spawnObject(ObjectPool<T>& pool, const T& value) {
+	if (pool.count == pool.capacity) {
+		++pool.stats.failed;
+		return NULL_POOL_HANDLE;
+	}
+	uint32_t slot = pool.freeSlots[pool.capacity - pool.count - 1];
+	size_t index = pool.count++;
+	pool.objects[index] = value;
+	pool.objectSlot[index] = slot;
+	pool.slotObject[slot] = (uint32_t)index;
+	++pool.stats.spawned;
+	return { slot, pool.generations[slot] };
+}
+
+// Whether a handle still names a live object
+template <typename T>
+bool objectAlive(const ObjectPool<T>& pool, PoolHandle handle) {
+	// A free slot already carries the generation its next object will get, which no handle has seen yet
+	return handle.generation != 0 && handle.slot < pool.capacity && pool.generations[handle.slot] == handle.generation;
+}
+
+// Object a handle names, NULL if it was despawned since. The pointer is only valid until the next despawn.
+template <typename T>
+T* getObject(ObjectPool<T>& pool, PoolHandle handle) {
+	if (!objectAlive(pool, handle)) {
+		++pool.stats.stale;
+		return NULL;
+	}
+	return &pool.objects[pool.slotObject[handle.slot]];
+}
+
+// Handle of the live object at index i of objects, for despawning while iterating
+template <typename T>
+PoolHandle objectHandle(const ObjectPool<T>& pool, size_t index) {
+	uint32_t slot = pool.objectSlot[index];
+	return { slot, pool.generations[slot] };
+}
+
+// Despawn the object at index i of objects; the last live object takes its place, so iterate
+// backwards when despawning in a loop
+template <typename T>
+void despawnObjectAt(ObjectPool<T>& pool, size_t index) {
+	uint32_t slot = pool.objectSlot[index];
+	size_t last = --pool.count;
+	if (index != last) {
+		pool.objects[index] = pool.objects[last];
+		pool.objectSlot[index] = pool.objectSlot[last];
+		pool.slotObject[pool.objectSlot[index]] = (uint32_t)index;
+	}
+	if (++pool.generations[slot] == 0)  // Skip the null generation on wrap
+		pool.generations[slot] = 1;
+	pool.freeSlots[pool.capacity - pool.count - 1] = slot;
+	++pool.stats.despawned;
+}
+
+// Despawn the object a handle names, false if it was already gone
+template <typename T>
+bool despawnObject(ObjectPool<T>& pool, PoolHandle handle) {
+	if (!objectAlive(pool, handle)) {
+		++pool.stats.stale;
+		return false;
+	}
+	despawnObjectAt(pool, pool.slotObject[handle.slot]);
+	return true;
+}
+
+// Despawn everything, every outstanding handle becomes stale
+template <typename T>
+void clearObjectPool(ObjectPool<T>& pool) {
+	while (pool.count > 0)
+		despawnObjectAt(pool, pool.count - 1);
+}
@@ -0,0 +1,273 @@
+#include "Particles.h"
+#include <cmath>
+#include <cstddef>
+#include "CpuFeatures.h"
+
+// Places the unit quad at the particle and cuts its frame from the sheet, rows counted from the top
+static const char* particleVertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
+    layout (location = 0) in vec2 corner;
+    layout (location = 1) in vec4 instance;  // x, y, size, age
+    out vec2 TexCoord;
+    uniform vec4 sheetRect;
+    uniform vec2 grid;
+    void main() {
+        float frameCount = grid.x * grid.y;
+        float frame = min(floor(instance.w * frameCount), frameCount - 1.0);
+        float column = mod(frame, grid.x);
+        float row = floor(frame / grid.x);
+        vec2 frameSize = (sheetRect.zw - sheetRect.xy) / grid;
+        vec2 frameMin = vec2(sheetRect.x + column * frameSize.x, sheetRect.w - (row + 1.0) * frameSize.y);
+        TexCoord = frameMin + corner * frameSize;
+        gl_Position = projection * view * vec4(instance.xy + (corner - 0.5) * instance.z, 0.0, 1.0);
+    })";
+
+static const char* particleFragmentShaderSource = R"(#version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    void main() {
+        FragColor = texture(texture1, TexCoord);
+    })";
+
+void initParticleSystem(ParticleSystem& system, unsigned int seed) {
+	system.pools.clear();
+	system.random = seed ? seed : 1;
+}
+
+int addParticlePool(ParticleSystem& system, const ParticleEmitter& emitter, size_t capacity) {
+	system.pools.push_back(ParticlePool());
+	ParticlePool& pool = system.pools.back();
+	pool.emitter = emitter;
+	pool.capacity = capacity;
+	pool.count = 0;
+	pool.dropped = 0;
+	std::vector<float>* fields[] = { &pool.x, &pool.y, &pool.velocityX, &pool.velocityY, &pool.age, &pool.ageRate, &pool.size };
+	for (std::vector<float>* field : fields)
+		field->assign(capacity, 0.0f);
+	return (int)system.pools.size() - 1;
+}
+
+ParticleEmitter particleEmitter(const AtlasRegion& region, int columns, int rows, float frameSize) {
+	ParticleEmitter emitter = ParticleEmitter();
+	emitter.textureID = region.textureID;
+	emitter.uvRect = region.uvRect;
+	emitter.columns = columns;
+	emitter.rows = rows;
+	emitter.speedMin = 0.0f;
+	emitter.speedMax = 0.0f;
+	emitter.lifeMin = emitter.lifeMax = 1.0f;
+	emitter.sizeMin = emitter.sizeMax = frameSize;
+	emitter.drag = 1.0f;
+	return emitter;
+}
+
+// Uniform float in [0, 1)
+static float nextRandom(unsigned int& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+size_t emitParticles(ParticleSystem& system, int poolIndex, float x, float y, size_t count) {
+	ParticlePool& pool = system.pools[poolIndex];
+	const ParticleEmitter& emitter = pool.emitter;
+	size_t room = pool.capacity - pool.count;
+	if (count > room) {
+		pool.dropped += count - room;
+		count = room;
+	}
+
+	for (size_t n = 0; n < count; ++n) {
+		size_t i = pool.count++;
+		float angle = nextRandom(system.random) * 6.2831853f;
+		float speed = emitter.speedMin + (emitter.speedMax - emitter.speedMin) * nextRandom(system.random);
+		float life = emitter.lifeMin + (emitter.lifeMax - emitter.lifeMin) * nextRandom(system.random);
+		pool.x[i] = x;
+		pool.y[i] = y;
+		pool.velocityX[i] = std::cos(angle) * speed;
+		pool.velocityY[i] = std::sin(angle) * speed;
+		pool.age[i] = 0.0f;
+		pool.ageRate[i] = 1.0f / life;
+		pool.size[i] = emitter.sizeMin + (emitter.sizeMax - emitter.sizeMin) * nextRandom(system.random);
+	}
+	return count;
+}
+
+// Replace particle i with the last live one
+static void retireParticle(ParticlePool& pool, size_t i) {
+	size_t last = --pool.count;
+	pool.x[i] = pool.x[last];
+	pool.y[i] = pool.y[last];
+	pool.velocityX[i] = pool.velocityX[last];
+	pool.velocityY[i] = pool.velocityY[last];
+	pool.age[i] = pool.age[last];
+	pool.ageRate[i] = pool.ageRate[last];
+	pool.size[i] = pool.size[last];
+}
+
+// Both kernels walk from the back, so the particle that replaces a dead one has always been updated already.
+// end is where the scalar kernel starts, the AVX2 kernel hands it the head it didn't cover.
+static void updatePoolScalar(ParticlePool& pool, size_t end, float deltaTime, float damping, float gravityStep) {
+	float* x = pool.x.data();
+	float* y = pool.y.data();
+	float* velocityX = pool.velocityX.data();
+	float* velocityY = pool.velocityY.data();
+	float* age = pool.age.data();
+	const float* ageRate = pool.ageRate.data();
+
+	for (size_t i = end; i-- > 0; ) {
+		velocityX[i] = velocityX[i] * damping;
+		velocityY[i] = velocityY[i] * damping + gravityStep;
+		x[i] = x[i] + velocityX[i] * deltaTime;
+		y[i] = y[i] + velocityY[i] * deltaTime;
+		age[i] = age[i] + ageRate[i] * deltaTime;
+		if (age[i] >= 1.0f)
+			retireParticle(pool, i);
+	}
+}
+
+#ifdef CPU_X86
+
+// Same arithmetic as the scalar kernel on 8 particles per step
+TARGET_AVX2 static void updatePoolAVX2(ParticlePool& pool, float deltaTime, float damping, float gravityStep) {
+	const __m256 delta = _mm256_set1_ps(deltaTime);
+	const __m256 damp = _mm256_set1_ps(damping);
+	const __m256 gravity = _mm256_set1_ps(gravityStep);
+	const __m256 one = _mm256_set1_ps(1.0f);
+
+	size_t i = pool.count;
+	while (i >= 8) {
+		i -= 8;
+		__m256 velocityX = _mm256_mul_ps(_mm256_loadu_ps(pool.velocityX.data() + i), damp);
+		__m256 velocityY = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(pool.velocityY.data() + i), damp), gravity);
+		__m256 x = _mm256_add_ps(_mm256_loadu_ps(pool.x.data() + i), _mm256_mul_ps(velocityX, delta));
+		__m256 y = _mm256_add_ps(_mm256_loadu_ps(pool.y.data() + i), _mm256_mul_ps(velocityY, delta));
+		__m256 age = _mm256_add_ps(_mm256_loadu_ps(pool.age.data() + i), _mm256_mul_ps(_mm256_loadu_ps(pool.ageRate.data() + i), delta));
+
+		_mm256_storeu_ps(pool.velocityX.data() + i, velocityX);
+		_mm256_storeu_ps(pool.velocityY.data() + i, velocityY);
+		_mm256_storeu_ps(pool.x.data() + i, x);
+		_mm256_storeu_ps(pool.y.data() + i, y);
+		_mm256_storeu_ps(pool.age.data() + i, age);
+
+		// Retire from the highest lane down, the replacements come from lanes and blocks already done
+		int dead = _mm256_movemask_ps(_mm256_cmp_ps(age, one, _CMP_GE_OQ));
+		for (int lane = 7; dead != 0; --lane) {
+			if (dead & (1 << lane)) {
+				retireParticle(pool, i + lane);
+				dead &= ~(1 << lane);
+			}
+		}
+	}
+	// Clear the upper halves before scalar code, SSE math afterwards would otherwise pay for the dirty state
+	_mm256_zeroupper();
+	updatePoolScalar(pool, i, deltaTime, damping, gravityStep);
+}
+
+#endif
+
+void updateParticles(ParticleSystem& system, float deltaTime, AnimationKernel kernel) {
+	if (kernel == ANIMATION_KERNEL_BEST)
+		kernel = bestAnimationKernel();
+	for (ParticlePool& pool : system.pools) {
+		float damping = std::pow(pool.emitter.drag, deltaTime);
+		float gravityStep = pool.emitter.gravity * deltaTime;
+#ifdef CPU_X86
+		// Never run a kernel the CPU can't execute, even if asked for it
+		if (kernel == ANIMATION_KERNEL_AVX2 && cpuHasAVX2()) {
+			updatePoolAVX2(pool, deltaTime, damping, gravityStep);
+			continue;
+		}
+#endif
+		updatePoolScalar(pool, pool.count, deltaTime, damping, gravityStep);
+	}
+}
+
+size_t liveParticles(const ParticleSystem& system) {
+	size_t live = 0;
+	for (const ParticlePool& pool : system.pools)
+		live += pool.count;
+	return live;
+}
+
+size_t writeParticleInstances(const ParticlePool& pool, ParticleInstance* out) {
+	for (size_t i = 0; i < pool.count; ++i)
+		out[i] = { pool.x[i], pool.y[i], pool.size[i], pool.age[i] };
+	return pool.count;
+}
+
+bool initParticleRenderer(ParticleRenderer& renderer, size_t capacity) {
+	if (!createShaderProgram(renderer.program, particleVertexShaderSource, particleFragmentShaderSource))
+		return false;
+	renderer.sheetRectLocation = uniformLocation(renderer.program, "sheetRect");
+	renderer.gridLocation = uniformLocation(renderer.program, "grid");
+
+	// Triangle strip over the unit square
+	float corners[] = { 0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 1.0f };
+
+	glGenVertexArrays(1, &renderer.VAO);
+	glGenBuffers(1, &renderer.quadVBO);
+	glBindVertexArray(renderer.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	initStreamBuffer(renderer.instances, (capacity > 0 ? capacity : 1) * sizeof(ParticleInstance));
+	glBindBuffer(GL_ARRAY_BUFFER, renderer.instances.buffer);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	renderer.stats = ParticleRendererStats();
+	return true;
+}
+
+void destroyParticleRenderer(ParticleRenderer& renderer) {
+	glDeleteVertexArrays(1, &renderer.VAO);
+	glDeleteBuffers(1, &renderer.quadVBO);
+	destroyStreamBuffer(renderer.instances);
+	destroyShaderProgram(renderer.program);
+}
+
+void drawParticles(ParticleRenderer& renderer, const ParticleSystem& system) {
+	renderer.stats = ParticleRendererStats();
+	size_t count = liveParticles(system);
+	if (count == 0)
+		return;
+
+	// Every pool goes into one region, back to back
+	size_t bytes = count * sizeof(ParticleInstance);
+	ParticleInstance* out = (ParticleInstance*)beginStreamRegion(renderer.instances, bytes);
+	for (const ParticlePool& pool : system.pools)
+		out += writeParticleInstances(pool, out);
+	endStreamRegion(renderer.instances, bytes);
+
+	useShaderProgram(renderer.program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(renderer.VAO);
+
+	size_t offset = streamRegionOffset(renderer.instances);
+	for (const ParticlePool& pool : system.pools) {
+		if (pool.count == 0)
+			continue;
+		const ParticleEmitter& emitter = pool.emitter;
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offset);
+		glUniform4f(renderer.sheetRectLocation, emitter.uvRect.x, emitter.uvRect.y, emitter.uvRect.z, emitter.uvRect.w);
+		glUniform2f(renderer.gridLocation, (float)emitter.columns, (float)emitter.rows);
+		glBindTexture(GL_TEXTURE_2D, emitter.textureID);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)pool.count);
+		offset += pool.count * sizeof(ParticleInstance);
+		renderer.stats.drawCalls++;
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	fenceStreamRegion(renderer.instances);
+
+	renderer.stats.particles = (int)count;
+	renderer.stats.bytesUploaded = bytes;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "AnimationStore.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "TextureAtlas.h"
+
+// How particles of one pool look and move. Each particle plays the sheet once over its life.
+struct ParticleEmitter {
+	GLuint textureID;
+	glm::vec4 uvRect;             // Sheet rect inside the texture
+	int columns, rows;
+	float speedMin, speedMax;     // Launch speed in a random direction
+	float lifeMin, lifeMax;       // Seconds
+	float sizeMin, sizeMax;       // World units
+	float gravity;                // Added to the vertical velocity every second
+	float drag;                   // Fraction of the velocity kept after one second
+};
+
+// Fixed capacity pool of one emitter's particles, one array per field. Every array is sized by
+// addParticlePool and never grows, dead particles are replaced by the last live one.
+struct ParticlePool {
+	ParticleEmitter emitter;
+	size_t capacity;
+	size_t count;
+	size_t dropped;  // Particles not emitted because the pool was full
+
+	std::vector<float> x, y;
+	std::vector<float> velocityX, velocityY;
+	std::vector<float> age;      // 0 at birth, 1 at death
+	std::vector<float> ageRate;  // 1 / lifetime
+	std::vector<float> size;
+};
+
+struct ParticleSystem {
+	std::vector<ParticlePool> pools;
+	unsigned int random;  // xorshift state, emitting draws from it instead of allocating an engine
+};
+
+// Start an empty system
+void initParticleSystem(ParticleSystem& system, unsigned int seed = 1234);
+
+// Add a pool of capacity particles and return its index; all memory is allocated here
+int addParticlePool(ParticleSystem& system, const ParticleEmitter& emitter, size_t capacity);
+
+// Emitter for a sheet in an atlas, sizes default to the frame size
+ParticleEmitter particleEmitter(const AtlasRegion& region, int columns, int rows, float frameSize);
+
+// Spawn up to count particles of a pool at x, y, returns how many fit
+size_t emitParticles(ParticleSystem& system, int pool, float x, float y, size_t count);
+
+// Move, age and retire every particle. Kernels share the animation store's choice of scalar or AVX2.
+void updateParticles(ParticleSystem& system, float deltaTime, AnimationKernel kernel = ANIMATION_KERNEL_BEST);
+
+// Live particles over all pools
+size_t liveParticles(const ParticleSystem& system);
+
+// Per-instance data of a particle, the vertex shader picks the frame from its age
+struct ParticleInstance {
+	float x, y, size, age;
+};
+
+// Counters for the last drawn frame
+struct ParticleRendererStats {
+	int particles;
+	int drawCalls;
+	size_t bytesUploaded;
+};
+
+// Draws every pool with one instanced call, instances stream through a ring buffer
+struct ParticleRenderer {
+	ShaderProgram program;
+	GLint sheetRectLocation, gridLocation;
+	GLuint VAO, quadVBO;
+	StreamBuffer instances;
+	ParticleRendererStats stats;
+};
+
+// Create the particle shader and buffers, sized for capacity live particles
+bool initParticleRenderer(ParticleRenderer& renderer, size_t capacity);
+
+// Release the GL objects owned by the renderer
+void destroyParticleRenderer(ParticleRenderer& renderer);
+
+// Pack the live particles into the stream buffer and draw them
+void drawParticles(ParticleRenderer& renderer, const ParticleSystem& system);
+
+// Write a pool's particles as instances, returns how many were written
+size_t writeParticleInstances(const ParticlePool& pool, ParticleInstance* out);
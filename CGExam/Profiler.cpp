@@ -0,0 +1,163 @@
+#include "Profiler.h"
+#include <cstdio>
+
+void initProfiler(Profiler& profiler, bool enabled) {
+	profiler.enabled = enabled;
+	profiler.passCount = 0;
+	profiler.frame = 0;
+}
+
+int addProfilePass(Profiler& profiler, const char* name, bool gpu) {
+	if (profiler.passCount == PROFILER_MAX_PASSES)
+		return -1;
+
+	ProfilePass& pass = profiler.passes[profiler.passCount];
+	pass.name = name;
+	pass.gpu = gpu && profiler.enabled;
+	if (pass.gpu)
+		glGenQueries(PROFILER_QUERY_FRAMES, pass.queries);
+	pass.dropped = 0;
+	for (int slot = 0; slot < PROFILER_QUERY_FRAMES; ++slot) {
+		pass.issued[slot] = false;
+		pass.cpuInFlight[slot] = 0.0;
+	}
+	for (int i = 0; i < PROFILER_HISTORY; ++i) {
+		pass.cpuHistory[i] = -1.0;
+		pass.gpuHistory[i] = -1.0;
+	}
+	return profiler.passCount++;
+}
+
+bool openProfilerCsv(Profiler& profiler, const char* path) {
+	profiler.csv.open(path);
+	if (!profiler.csv)
+		return false;
+
+	profiler.csv << "frame";
+	for (int i = 0; i < profiler.passCount; ++i)
+		profiler.csv << "," << profiler.passes[i].name << "_cpu_ms," << profiler.passes[i].name << "_gpu_ms";
+	profiler.csv << ",gpu_dropped\n";
+	return true;
+}
+
+void beginProfilerFrame(Profiler& profiler) {
+	if (!profiler.enabled)
+		return;
+
+	int slot = profiler.frame % PROFILER_QUERY_FRAMES;
+	int resultFrame = profiler.frame - PROFILER_QUERY_FRAMES;
+	if (resultFrame < 0)
+		return;
+
+	bool writeRow = profiler.csv.is_open();
+	if (writeRow)
+		profiler.csv << resultFrame;
+	int dropped = 0;
+
+	for (int i = 0; i < profiler.passCount; ++i) {
+		ProfilePass& pass = profiler.passes[i];
+		double gpuMs = -1.0;
+		if (pass.gpu && pass.issued[slot]) {
+			// A result that isn't back yet is dropped rather than waited for
+			GLint available = 0;
+			glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &ns);
+				gpuMs = ns / 1e6;
+			}
+			else {
+				pass.dropped++;
+				dropped++;
+			}
+			pass.issued[slot] = false;
+		}
+		pass.gpuHistory[resultFrame % PROFILER_HISTORY] = gpuMs;
+
+		if (writeRow) {
+			profiler.csv << "," << pass.cpuInFlight[slot] << ",";
+			if (gpuMs >= 0.0)
+				profiler.csv << gpuMs;
+		}
+	}
+	// Samples of this frame lost to results that weren't back, so a gap in the row isn't silent
+	if (writeRow)
+		profiler.csv << "," << dropped << "\n";
+}
+
+void beginPass(Profiler& profiler, int pass) {
+	if (!profiler.enabled || pass < 0)
+		return;
+
+	ProfilePass& p = profiler.passes[pass];
+	p.cpuStart = SDL_GetPerformanceCounter();
+	if (p.gpu)
+		glBeginQuery(GL_TIME_ELAPSED, p.queries[profiler.frame % PROFILER_QUERY_FRAMES]);
+}
+
+void endPass(Profiler& profiler, int pass) {
+	if (!profiler.enabled || pass < 0)
+		return;
+
+	ProfilePass& p = profiler.passes[pass];
+	int slot = profiler.frame % PROFILER_QUERY_FRAMES;
+	if (p.gpu) {
+		glEndQuery(GL_TIME_ELAPSED);
+		p.issued[slot] = true;
+	}
+	double cpuMs = (SDL_GetPerformanceCounter() - p.cpuStart) * 1000.0 / SDL_GetPerformanceFrequency();
+	p.cpuInFlight[slot] = cpuMs;
+	p.cpuHistory[profiler.frame % PROFILER_HISTORY] = cpuMs;
+}
+
+void endProfilerFrame(Profiler& profiler) {
+	if (profiler.enabled)
+		profiler.frame++;
+}
+
+void destroyProfiler(Profiler& profiler) {
+	for (int i = 0; i < profiler.passCount; ++i) {
+		if (profiler.passes[i].gpu)
+			glDeleteQueries(PROFILER_QUERY_FRAMES, profiler.passes[i].queries);
+	}
+	profiler.passCount = 0;
+	if (profiler.csv.is_open())
+		profiler.csv.close();
+}
+
+// Mean of the valid samples, -1 when there are none
+static double rollingAverage(const double* history) {
+	double sum = 0.0;
+	int count = 0;
+	for (int i = 0; i < PROFILER_HISTORY; ++i) {
+		if (history[i] >= 0.0) {
+			sum += history[i];
+			count++;
+		}
+	}
+	return count > 0 ? sum / count : -1.0;
+}
+
+void drawProfilerOverlay(const Profiler& profiler, TextRenderer& text, float x, float y, float size) {
+	if (!profiler.enabled)
+		return;
+
+	const glm::vec4 color(1.0f, 1.0f, 0.6f, 1.0f);
+	char line[64];
+	int length = std::snprintf(line, sizeof(line), "%-10s %6s %6s %5s", "ms", "cpu", "gpu", "drop");
+	drawText(text, std::string_view(line, length), x, y, size, color);
+
+	for (int i = 0; i < profiler.passCount; ++i) {
+		const ProfilePass& pass = profiler.passes[i];
+		y -= size * 1.25f;
+		double cpu = rollingAverage(pass.cpuHistory);
+		double gpu = rollingAverage(pass.gpuHistory);
+		if (!pass.gpu)
+			length = std::snprintf(line, sizeof(line), "%-10s %6.3f %6s %5s", pass.name, cpu, "-", "-");
+		else if (gpu >= 0.0)
+			length = std::snprintf(line, sizeof(line), "%-10s %6.3f %6.3f %5d", pass.name, cpu, gpu, pass.dropped);
+		else
+			length = std::snprintf(line, sizeof(line), "%-10s %6.3f %6s %5d", pass.name, cpu, "-", pass.dropped);
+		drawText(text, std::string_view(line, length), x, y, size, color);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <glad/glad.h>
+#include <SDL.h>
+#include <fstream>
+#include "TextRenderer.h"
+
+const int PROFILER_MAX_PASSES = 8;
+const int PROFILER_QUERY_FRAMES = 4;  // Query sets in flight, a set is read back when its slot comes round again
+const int PROFILER_HISTORY = 60;      // Frames in the rolling average
+
+// One timed part of the frame
+struct ProfilePass {
+	const char* name;
+	bool gpu;                                  // Also measured with GL_TIME_ELAPSED queries
+	GLuint queries[PROFILER_QUERY_FRAMES];
+	bool issued[PROFILER_QUERY_FRAMES];
+	double cpuInFlight[PROFILER_QUERY_FRAMES]; // CPU time of the frame each query belongs to, for the CSV row
+	Uint64 cpuStart;
+	int dropped;                               // GPU results still not back when their slot came round again
+
+	// Latest PROFILER_HISTORY samples, negative when a GPU result wasn't ready in time
+	double cpuHistory[PROFILER_HISTORY];
+	double gpuHistory[PROFILER_HISTORY];
+};
+
+// CPU and GPU time per pass; GPU results are read PROFILER_QUERY_FRAMES frames late so the read never waits on the GPU
+struct Profiler {
+	bool enabled;
+	ProfilePass passes[PROFILER_MAX_PASSES];
+	int passCount;
+	int frame;
+	std::ofstream csv;
+};
+
+// Reset the profiler; passes only record anything once enabled is set
+void initProfiler(Profiler& profiler, bool enabled);
+
+// Register a pass and return its index, gpu adds a timer query around it
+int addProfilePass(Profiler& profiler, const char* name, bool gpu);
+
+// Write one row per frame to path, call after every pass has been added
+bool openProfilerCsv(Profiler& profiler, const char* path);
+
+// Collect the query results from PROFILER_QUERY_FRAMES frames ago before their queries are reused
+void beginProfilerFrame(Profiler& profiler);
+
+// Time a pass; passes must not overlap since only one GL_TIME_ELAPSED query can be active
+void beginPass(Profiler& profiler, int pass);
+void endPass(Profiler& profiler, int pass);
+
+// Finish the frame
+void endProfilerFrame(Profiler& profiler);
+
+// Delete the queries and close the CSV
+void destroyProfiler(Profiler& profiler);
+
+// Queue one line per pass with its rolling average CPU and GPU ms and dropped GPU samples, top line at y
+void drawProfilerOverlay(const Profiler& profiler, TextRenderer& text, float x, float y, float size);
+
+// Times the enclosing scope as a pass
+struct ScopedPass {
+	Profiler& profiler;
+	int pass;
+
+	ScopedPass(Profiler& p, int index) : profiler(p), pass(index) {
+		beginPass(profiler, pass);
+	}
+	~ScopedPass() {
+		endPass(profiler, pass);
+	}
+};
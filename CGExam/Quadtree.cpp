@@ -0,0 +1,136 @@
+#include "Quadtree.h"
+#include <algorithm>
+#include <cmath>
+
+static int createNode(LooseQuadtree& tree, float centerX, float centerY, float halfSize, int parent) {
+	QuadtreeNode node;
+	node.centerX = centerX;
+	node.centerY = centerY;
+	node.halfSize = halfSize;
+	node.parent = parent;
+	node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+	node.subtreeItems = 0;
+	tree.nodes.push_back(node);
+	return (int)tree.nodes.size() - 1;
+}
+
+void initQuadtree(LooseQuadtree& tree, float centerX, float centerY, float halfSize, int maxDepth) {
+	tree.centerX = centerX;
+	tree.centerY = centerY;
+	tree.halfSize = halfSize;
+	tree.maxDepth = std::min(std::max(maxDepth, 0), 16);  // Keeps the query stack bounded
+	tree.nodes.clear();
+	tree.items.clear();
+	tree.freeItems.clear();
+	tree.stats = QuadtreeQueryStats();
+	createNode(tree, centerX, centerY, halfSize, -1);
+}
+
+// Walk down from the root to the deepest cell that holds the item's center and is at least as big as
+// the item, creating cells on the way
+static int findNode(LooseQuadtree& tree, const QuadtreeBounds& bounds) {
+	float x = (bounds.minX + bounds.maxX) * 0.5f;
+	float y = (bounds.minY + bounds.maxY) * 0.5f;
+	float extent = std::max(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY) * 0.5f;
+	if (std::abs(x - tree.centerX) > tree.halfSize || std::abs(y - tree.centerY) > tree.halfSize)
+		return 0;
+
+	int node = 0;
+	for (int depth = 0; depth < tree.maxDepth; ++depth) {
+		float childHalf = tree.nodes[node].halfSize * 0.5f;
+		if (extent > childHalf)
+			break;
+		int quadrant = (x >= tree.nodes[node].centerX ? 1 : 0) | (y >= tree.nodes[node].centerY ? 2 : 0);
+		int child = tree.nodes[node].children[quadrant];
+		if (child < 0) {
+			float childX = tree.nodes[node].centerX + (quadrant & 1 ? childHalf : -childHalf);
+			float childY = tree.nodes[node].centerY + (quadrant & 2 ? childHalf : -childHalf);
+			child = createNode(tree, childX, childY, childHalf, node);  // May reallocate nodes
+			tree.nodes[node].children[quadrant] = child;
+		}
+		node = child;
+	}
+	return node;
+}
+
+static void link(LooseQuadtree& tree, int id, int node) {
+	QuadtreeItem& item = tree.items[id];
+	item.node = node;
+	item.slot = (int)tree.nodes[node].items.size();
+	tree.nodes[node].items.push_back(id);
+	for (; node >= 0; node = tree.nodes[node].parent)
+		tree.nodes[node].subtreeItems++;
+}
+
+static void unlink(LooseQuadtree& tree, int id) {
+	QuadtreeItem& item = tree.items[id];
+	std::vector<int>& nodeItems = tree.nodes[item.node].items;
+	int last = nodeItems.back();
+	nodeItems[item.slot] = last;
+	tree.items[last].slot = item.slot;
+	nodeItems.pop_back();
+	for (int node = item.node; node >= 0; node = tree.nodes[node].parent)
+		tree.nodes[node].subtreeItems--;
+	item.node = -1;
+}
+
+int insertQuadtreeItem(LooseQuadtree& tree, const QuadtreeBounds& bounds) {
+	int id;
+	if (!tree.freeItems.empty()) {
+		id = tree.freeItems.back();
+		tree.freeItems.pop_back();
+	}
+	else {
+		id = (int)tree.items.size();
+		tree.items.push_back(QuadtreeItem());
+	}
+	tree.items[id].bounds = bounds;
+	link(tree, id, findNode(tree, bounds));
+	return id;
+}
+
+void updateQuadtreeItem(LooseQuadtree& tree, int id, const QuadtreeBounds& bounds) {
+	tree.items[id].bounds = bounds;
+	int node = findNode(tree, bounds);
+	if (node == tree.items[id].node)
+		return;
+	unlink(tree, id);
+	link(tree, id, node);
+}
+
+void removeQuadtreeItem(LooseQuadtree& tree, int id) {
+	unlink(tree, id);
+	tree.freeItems.push_back(id);
+}
+
+static bool overlaps(const QuadtreeBounds& a, const QuadtreeBounds& b) {
+	return a.minX <= b.maxX && a.maxX >= b.minX && a.minY <= b.maxY && a.maxY >= b.minY;
+}
+
+void queryQuadtree(LooseQuadtree& tree, const QuadtreeBounds& rect, std::vector<int>& out) {
+	tree.stats = QuadtreeQueryStats();
+	int stack[4 * 16 + 4];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const QuadtreeNode& node = tree.nodes[stack[--top]];
+		tree.stats.nodesVisited++;
+
+		for (int id : node.items) {
+			tree.stats.itemsTested++;
+			if (overlaps(tree.items[id].bounds, rect))
+				out.push_back(id);
+		}
+
+		// Children's loose bounds are twice their cell, which is the parent's half size each way
+		float reach = node.halfSize;
+		for (int child : node.children) {
+			if (child < 0 || tree.nodes[child].subtreeItems == 0)
+				continue;
+			const QuadtreeNode& c = tree.nodes[child];
+			QuadtreeBounds loose = { c.centerX - reach, c.centerY - reach, c.centerX + reach, c.centerY + reach };
+			if (overlaps(loose, rect))
+				stack[top++] = child;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+// Axis aligned rectangle in world units
+struct QuadtreeBounds {
+	float minX, minY, maxX, maxY;
+};
+
+// A cell of the tree. Its loose bounds reach half a cell past each edge, so an item only has to have its
+// center in the cell and be no bigger than the cell to fit, and never straddles a boundary.
+struct QuadtreeNode {
+	float centerX, centerY, halfSize;
+	int parent;
+	int children[4];         // -1 until something is placed below
+	int subtreeItems;        // Items in this node and below, empty branches are skipped by queries
+	std::vector<int> items;  // Item ids stored in this node
+};
+
+struct QuadtreeItem {
+	QuadtreeBounds bounds;
+	int node;  // -1 when the id is free
+	int slot;  // Index in the node's item list
+};
+
+// Counters of the last query
+struct QuadtreeQueryStats {
+	int nodesVisited;
+	int itemsTested;
+};
+
+// Loose quadtree over a square world; items outside it are kept in the root
+struct LooseQuadtree {
+	float centerX, centerY, halfSize;
+	int maxDepth;
+	std::vector<QuadtreeNode> nodes;  // nodes[0] is the root
+	std::vector<QuadtreeItem> items;  // Indexed by item id
+	std::vector<int> freeItems;
+
+	QuadtreeQueryStats stats;
+};
+
+// Create an empty tree covering centerX, centerY +- halfSize
+void initQuadtree(LooseQuadtree& tree, float centerX, float centerY, float halfSize, int maxDepth = 8);
+
+// Add an item and return its id
+int insertQuadtreeItem(LooseQuadtree& tree, const QuadtreeBounds& bounds);
+
+// Move or resize an item, it only changes node when it leaves its cell or no longer fits its depth
+void updateQuadtreeItem(LooseQuadtree& tree, int id, const QuadtreeBounds& bounds);
+
+// Remove an item, its id may be handed out again
+void removeQuadtreeItem(LooseQuadtree& tree, int id);
+
+// Append the id of every item overlapping the rect to out, in no particular order
+void queryQuadtree(LooseQuadtree& tree, const QuadtreeBounds& rect, std::vector<int>& out);
+
+// Bounds of a sprite centered at x, y
+inline QuadtreeBounds spriteBounds(float x, float y, float width, float height) {
+	return { x - width * 0.5f, y - height * 0.5f, x + width * 0.5f, y + height * 0.5f };
+}
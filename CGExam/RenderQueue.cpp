@@ -0,0 +1,159 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+struct RenderSortContext {
+	RenderQueue* queue;
+	const uint64_t* keys;
+	size_t count;
+	const RenderCommand* from;  // Commands of the current pass and where they go
+	RenderCommand* to;
+	int shift;                  // Digit of the current pass
+	bool packed;                // Commands are contiguous; before the first pass each chunk holds chunks[c].drawn
+	size_t drawn;
+};
+
+// Commands of a chunk in the current pass
+static void chunkRange(const RenderSortContext& sort, size_t chunk, size_t& first, size_t& last) {
+	first = chunk * RENDER_SORT_CHUNK;
+	last = sort.packed ? std::min(sort.drawn, first + RENDER_SORT_CHUNK) : first + sort.queue->chunks[chunk].drawn;
+}
+
+// Blend, shader and texture switches from one state to the next
+static size_t stateChanges(uint64_t from, uint64_t to) {
+	uint64_t changed = from ^ to;
+	return ((changed >> RENDER_KEY_BLEND_SHIFT & 0x3) != 0) + ((changed >> RENDER_KEY_SHADER_SHIFT & 0x3F) != 0)
+		+ ((changed >> RENDER_KEY_TEXTURE_SHIFT & 0xFFFF) != 0);
+}
+
+// Wrap each drawn key of a range of chunks in a command at the front of its chunk, culled ones are dropped
+// here and never sorted. Notes the bits that vary and the state runs in submission order.
+static void prepareRenderChunks(void* context, size_t begin, size_t end) {
+	const RenderSortContext& sort = *(const RenderSortContext*)context;
+	RenderCommand* commands = sort.queue->commands.data();
+	for (size_t chunk = begin; chunk < end; ++chunk) {
+		RenderChunk info = RenderChunk();
+		size_t first = chunk * RENDER_SORT_CHUNK;
+		size_t last = std::min(sort.count, first + RENDER_SORT_CHUNK);
+		uint64_t state = 0;
+		for (size_t i = first; i < last; ++i) {
+			uint64_t key = sort.keys[i];
+			if (renderKeyLayer(key) == RENDER_LAYER_CULLED)
+				continue;
+			commands[first + info.drawn] = { key, (uint32_t)i };
+			uint64_t keyState = key & RENDER_KEY_STATE_MASK;
+			if (info.drawn == 0) {
+				info.firstKey = key;
+				info.firstState = keyState;
+			}
+			else if (keyState != state) {
+				info.runs++;
+				info.changes += stateChanges(state, keyState);
+			}
+			info.differing |= key ^ info.firstKey;
+			state = keyState;
+			info.drawn++;
+		}
+		info.lastState = state;
+		sort.queue->chunks[chunk] = info;
+	}
+}
+
+// Count the current digit in a range of chunks
+static void countRenderChunks(void* context, size_t begin, size_t end) {
+	const RenderSortContext& sort = *(const RenderSortContext*)context;
+	for (size_t chunk = begin; chunk < end; ++chunk) {
+		uint32_t* counts = sort.queue->cursors.data() + chunk * 256;
+		std::fill(counts, counts + 256, 0);
+		size_t first, last;
+		chunkRange(sort, chunk, first, last);
+		for (size_t i = first; i < last; ++i)
+			counts[(sort.from[i].key >> sort.shift) & 0xFF]++;
+	}
+}
+
+// Move the commands of a range of chunks to where the prefix pass put each digit
+static void scatterRenderChunks(void* context, size_t begin, size_t end) {
+	const RenderSortContext& sort = *(const RenderSortContext*)context;
+	for (size_t chunk = begin; chunk < end; ++chunk) {
+		uint32_t* cursors = sort.queue->cursors.data() + chunk * 256;
+		size_t first, last;
+		chunkRange(sort, chunk, first, last);
+		for (size_t i = first; i < last; ++i)
+			sort.to[cursors[(sort.from[i].key >> sort.shift) & 0xFF]++] = sort.from[i];
+	}
+}
+
+static void runChunks(JobSystem* jobs, size_t chunks, void (*run)(void* context, size_t begin, size_t end), RenderSortContext& sort) {
+	if (jobs)
+		parallelFor(*jobs, chunks, 1, run, &sort);
+	else
+		run(&sort, 0, chunks);
+}
+
+size_t sortRenderKeys(RenderQueue& queue, const uint64_t* keys, size_t count, JobSystem* jobs) {
+	queue.stats = RenderQueueStats();
+	queue.stats.commands = count;
+	if (count == 0)
+		return 0;
+	queue.commands.resize(std::max(queue.commands.size(), count));
+	queue.scratch.resize(queue.commands.size());
+	size_t chunks = (count + RENDER_SORT_CHUNK - 1) / RENDER_SORT_CHUNK;
+	queue.chunks.resize(chunks);
+	queue.cursors.resize(chunks * 256);
+	RenderSortContext sort = { &queue, keys, count, NULL, NULL, 0, false, 0 };
+	runChunks(jobs, chunks, prepareRenderChunks, sort);
+
+	// Join the chunks' runs; a chunk starts a new run unless it carries on the state the last one ended in
+	uint64_t differing = 0;
+	uint64_t base = 0;
+	bool drawing = false;
+	uint64_t state = 0;
+	for (const RenderChunk& chunk : queue.chunks) {
+		if (chunk.drawn == 0)
+			continue;
+		if (!drawing)
+			base = chunk.firstKey;
+		differing |= chunk.differing | (chunk.firstKey ^ base);
+		queue.stats.drawn += chunk.drawn;
+		queue.stats.unsortedRuns += chunk.runs;
+		queue.stats.unsortedChanges += chunk.changes;
+		if (!drawing || chunk.firstState != state) {
+			queue.stats.unsortedRuns++;
+			queue.stats.unsortedChanges += drawing ? stateChanges(state, chunk.firstState) : 0;
+		}
+		drawing = true;
+		state = chunk.lastState;
+	}
+
+	// Least significant digit first, each pass is stable so it keeps the order of the ones before. The first
+	// pass also packs the chunks together, so one runs even when every key is the same.
+	sort.drawn = queue.stats.drawn;
+	if (sort.drawn == 0)
+		return 0;
+	for (int shift = 0; shift < 64; shift += 8) {
+		if (((differing >> shift) & 0xFF) == 0 && (sort.packed || differing >> shift != 0))
+			continue;
+		sort.from = queue.commands.data();
+		sort.to = queue.scratch.data();
+		sort.shift = shift;
+		size_t passChunks = sort.packed ? (sort.drawn + RENDER_SORT_CHUNK - 1) / RENDER_SORT_CHUNK : chunks;
+		runChunks(jobs, passChunks, countRenderChunks, sort);
+
+		// Chunk c's commands of a digit go after the same digit's commands of every chunk before it
+		uint32_t total = 0;
+		for (size_t digit = 0; digit < 256; ++digit) {
+			for (size_t chunk = 0; chunk < passChunks; ++chunk) {
+				uint32_t& cursor = queue.cursors[chunk * 256 + digit];
+				uint32_t commands = cursor;
+				cursor = total;
+				total += commands;
+			}
+		}
+
+		runChunks(jobs, passChunks, scatterRenderChunks, sort);
+		queue.commands.swap(queue.scratch);
+		queue.stats.passes++;
+		sort.packed = true;
+	}
+	return sort.drawn;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "JobSystem.h"
+
+// A draw's 64-bit sort key, most significant first: the layer decides what is drawn over what, then blend,
+// shader and texture so draws that share state end up next to each other, then depth orders a group
+const int RENDER_KEY_LAYER_SHIFT = 56;    // 8 bits
+const int RENDER_KEY_BLEND_SHIFT = 54;    // 2 bits
+const int RENDER_KEY_SHADER_SHIFT = 48;   // 6 bits
+const int RENDER_KEY_TEXTURE_SHIFT = 32;  // 16 bits, depth is the low 32
+
+// Blend, shader and texture bits, a change in any of them costs a state change
+const uint64_t RENDER_KEY_STATE_MASK = 0x00FFFFFF00000000ull;
+
+enum RenderLayer {
+	RENDER_LAYER_BACKGROUND,
+	RENDER_LAYER_WORLD,
+	RENDER_LAYER_EFFECTS,
+	RENDER_LAYER_HUD,
+	RENDER_LAYER_CULLED = 255  // Not drawn, sorts after everything
+};
+
+enum BlendMode {
+	BLEND_ALPHA,    // Premultiplied alpha over what is there
+	BLEND_ADDITIVE  // Adds the color, for glows
+};
+
+const uint64_t RENDER_KEY_CULLED = (uint64_t)RENDER_LAYER_CULLED << RENDER_KEY_LAYER_SHIFT;
+
+inline uint64_t renderKey(unsigned int layer, BlendMode blend, unsigned int shader, unsigned int texture, uint32_t depth) {
+	return (uint64_t)(layer & 0xFF) << RENDER_KEY_LAYER_SHIFT | (uint64_t)(blend & 0x3) << RENDER_KEY_BLEND_SHIFT
+		| (uint64_t)(shader & 0x3F) << RENDER_KEY_SHADER_SHIFT | (uint64_t)(texture & 0xFFFF) << RENDER_KEY_TEXTURE_SHIFT | depth;
+}
+
+inline unsigned int renderKeyLayer(uint64_t key) {
+	return (unsigned int)(key >> RENDER_KEY_LAYER_SHIFT);
+}
+
+inline BlendMode renderKeyBlend(uint64_t key) {
+	return (BlendMode)((key >> RENDER_KEY_BLEND_SHIFT) & 0x3);
+}
+
+inline unsigned int renderKeyShader(uint64_t key) {
+	return (unsigned int)(key >> RENDER_KEY_SHADER_SHIFT) & 0x3F;
+}
+
+inline unsigned int renderKeyTexture(uint64_t key) {
+	return (unsigned int)(key >> RENDER_KEY_TEXTURE_SHIFT) & 0xFFFF;
+}
+
+// Commands per job when the sort is split over the job system
+const size_t RENDER_SORT_CHUNK = 16384;
+
+// A recorded draw: its key, and which of the caller's items (e.g. sprite instances) it draws
+struct RenderCommand {
+	uint64_t key;
+	uint32_t item;
+};
+
+// What one chunk of keys holds, found by the first pass over them
+struct RenderChunk {
+	uint64_t firstKey;
+	uint64_t differing;             // Bits of the drawn keys that differ from the first
+	size_t drawn;                   // Keys that aren't culled
+	uint64_t firstState, lastState; // State bits of the first and last drawn key
+	size_t runs, changes;           // State runs after the first one and the blend, shader and texture switches between them
+};
+
+// Counters of the last sort
+struct RenderQueueStats {
+	size_t commands;
+	size_t drawn;
+	int passes;              // Radix passes run; a byte that is the same in every key needs none
+	size_t unsortedRuns;     // Runs of equal state in submission order, a draw each without the sort
+	size_t unsortedChanges;  // Blend, shader and texture switches those runs would need
+};
+
+// Sorts keys into commands, stable, with an LSD radix sort over 8-bit digits
+struct RenderQueue {
+	std::vector<RenderCommand> commands;  // The first stats.drawn are sorted by key after sortRenderKeys
+	std::vector<RenderCommand> scratch;
+	std::vector<RenderChunk> chunks;
+	std::vector<uint32_t> cursors;        // Per chunk, 256 counts and then scatter positions of the current digit
+	RenderQueueStats stats;
+};
+
+// Sort the keys that aren't culled into queue.commands, item i being the index of keys[i]; returns how
+// many there are. With jobs, each pass counts and scatters chunks of RENDER_SORT_CHUNK on its threads.
+size_t sortRenderKeys(RenderQueue& queue, const uint64_t* keys, size_t count, JobSystem* jobs = NULL);
@@ -0,0 +1,129 @@
+#include "SceneSystems.h"
+#include <algorithm>
+
+static void runMovement(Archetype& archetype, size_t begin, size_t end, void* context) {
+	float deltaTime = ((TickContext*)context)->deltaTime;
+	PositionComponent* positions = archetype.positions.data();
+	const VelocityComponent* velocities = archetype.velocities.data();
+	for (size_t i = begin; i < end; ++i) {
+		positions[i].prevX = positions[i].x;
+		positions[i].prevY = positions[i].y;
+		positions[i].x += velocities[i].x * deltaTime;
+		positions[i].y += velocities[i].y * deltaTime;
+	}
+}
+
+EcsSystem movementSystem(TickContext* context) {
+	return { "movement", COMPONENT_VELOCITY, COMPONENT_POSITION, false, runMovement, context };
+}
+
+static void runAnimation(Archetype& archetype, size_t begin, size_t end, void* context) {
+	const TickContext& tick = *(TickContext*)context;
+	updateAnimationRange(archetype.animations, begin, end, tick.deltaTime, tick.kernel);
+}
+
+EcsSystem animationSystem(TickContext* context) {
+	return { "animation", 0, COMPONENT_ANIMATION, false, runAnimation, context };
+}
+
+static void runCullingBounds(Archetype& archetype, size_t begin, size_t end, void* context) {
+	CullingContext& culling = *(CullingContext*)context;
+	for (size_t i = begin; i < end; ++i) {
+		uint32_t entity = archetype.entities[i].index;
+		int item = entity < culling.entityItems.size() ? culling.entityItems[entity] : -1;
+		if (item < 0)
+			continue;
+		const PositionComponent& position = archetype.positions[i];
+		const SizeComponent& size = archetype.sizes[i];
+		updateQuadtreeItem(*culling.tree, item, spriteBounds(position.x, position.y, size.width, size.height));
+	}
+}
+
+EcsSystem cullingBoundsSystem(CullingContext* context) {
+	return { "culling bounds", COMPONENT_POSITION | COMPONENT_SIZE, 0, true, runCullingBounds, context };
+}
+
+static void querySpriteCulling(void* context, size_t, size_t) {
+	SpriteCulling& cull = *(SpriteCulling*)context;
+	cull.items.clear();
+	queryQuadtree(*cull.culling->tree, cull.rect, cull.items);
+}
+
+static void flagSpriteCulling(void* context, size_t, size_t) {
+	SpriteCulling& cull = *(SpriteCulling*)context;
+	std::fill(cull.visible->begin(), cull.visible->end(), 0);
+	for (int item : cull.items)
+		(*cull.visible)[cull.culling->itemEntities[item]] = 1;
+}
+
+void beginSpriteCulling(JobSystem& jobs, SpriteCulling& culling, const QuadtreeBounds& rect) {
+	culling.rect = rect;
+	Job query = { querySpriteCulling, &culling, 0, 1, &culling.queried };
+	Job flag = { flagSpriteCulling, &culling, 0, 1, &culling.flagged };
+	submitJobs(jobs, &query, 1);
+	submitJobs(jobs, &flag, 1, &culling.queried);
+}
+
+void finishSpriteCulling(JobSystem& jobs, SpriteCulling& culling) {
+	waitForCounter(jobs, culling.flagged);
+}
+
+void addSpriteDrawTexture(SpriteDrawContext& context, GLuint texture) {
+	if (std::find(context.textures.begin(), context.textures.end(), texture) == context.textures.end())
+		context.textures.push_back(texture);
+}
+
+void beginSpriteDraw(SpriteDrawContext& draw) {
+	// The batch may already have textures from sprites drawn before, so keys use the slot it hands back
+	draw.slots.resize(draw.textures.size());
+	for (size_t i = 0; i < draw.textures.size(); ++i)
+		draw.slots[i] = spriteTextureSlot(*draw.batch, draw.textures[i]);
+
+	const unsigned int required = COMPONENT_POSITION | COMPONENT_SIZE | COMPONENT_SPRITE;
+	size_t total = 0;
+	draw.firstInstance.resize(draw.world->archetypes.size());
+	for (size_t a = 0; a < draw.world->archetypes.size(); ++a) {
+		const Archetype& archetype = draw.world->archetypes[a];
+		draw.firstInstance[a] = total;
+		if ((archetype.components & required) == required)
+			total += archetype.entities.size();
+	}
+	reserveSprites(*draw.batch, total, draw.instances, draw.keys);
+}
+
+static void runSpriteDraw(Archetype& archetype, size_t begin, size_t end, void* context) {
+	const SpriteDrawContext& draw = *(const SpriteDrawContext*)context;
+	bool animated = (archetype.components & COMPONENT_ANIMATION) != 0;
+	size_t first = draw.firstInstance[&archetype - draw.world->archetypes.data()];
+	SpriteInstance* instances = draw.instances + first;
+	uint64_t* keys = draw.keys + first;
+	size_t texture = 0;
+	for (size_t i = begin; i < end; ++i) {
+		uint32_t entity = archetype.entities[i].index;
+		const SpriteComponent& sprite = archetype.sprites[i];
+		if (texture >= draw.textures.size() || draw.textures[texture] != sprite.textureID)
+			texture = std::find(draw.textures.begin(), draw.textures.end(), sprite.textureID) - draw.textures.begin();
+		if (entity >= draw.visible.size() || !draw.visible[entity] || texture == draw.textures.size()) {
+			keys[i] = RENDER_KEY_CULLED;
+			continue;
+		}
+		const PositionComponent& position = archetype.positions[i];
+		const SizeComponent& size = archetype.sizes[i];
+
+		// Same frame rect as getFrameUV, frame 0 is the top-left cell of the sheet
+		int frame = animated ? archetype.animations.currentFrame[i] : 0;
+		float uSize = (sprite.uvRect.z - sprite.uvRect.x) / sprite.columns;
+		float vSize = (sprite.uvRect.w - sprite.uvRect.y) / sprite.rows;
+		float u = sprite.uvRect.x + (frame % sprite.columns) * uSize;
+		float v = sprite.uvRect.w - (frame / sprite.columns + 1) * vSize;
+
+		float x = position.prevX + (position.x - position.prevX) * draw.alpha;
+		float y = position.prevY + (position.y - position.prevY) * draw.alpha;
+		instances[i] = { x, y, size.width, size.height, u, v, u + uSize, v + vSize };
+		keys[i] = spriteKey(draw.slots[texture], sprite.layer);
+	}
+}
+
+EcsSystem spriteDrawSystem(SpriteDrawContext* context) {
+	return { "sprite draw", COMPONENT_POSITION | COMPONENT_SIZE | COMPONENT_SPRITE, 0, false, runSpriteDraw, context };
+}
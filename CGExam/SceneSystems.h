@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include "Ecs.h"
+#include "Quadtree.h"
+#include "SpriteBatch.h"
+#include "JobSystem.h"
+
+// Shared state of the tick systems, set before each run of the schedule
+struct TickContext {
+	float deltaTime;
+	AnimationKernel kernel;
+};
+
+// Remembers each position and moves it by its velocity
+EcsSystem movementSystem(TickContext* context);
+
+// Advances each animation with the store's SIMD kernel
+EcsSystem animationSystem(TickContext* context);
+
+// Keeps a quadtree item per entity in step with its position and size
+struct CullingContext {
+	LooseQuadtree* tree;
+	std::vector<int> entityItems;       // Tree item of each entity index, -1 for none
+	std::vector<uint32_t> itemEntities; // Entity index of each tree item
+};
+
+// Moves the tree items of entities whose bounds changed; moving an item relinks tree nodes, so it runs on the
+// main thread
+EcsSystem cullingBoundsSystem(CullingContext* context);
+
+// Finds what the camera sees as two jobs, the tree query and then the visible flags built from it, so the
+// workers do it while the main thread renders the passes before the sprites. The tree must not change in between.
+struct SpriteCulling {
+	CullingContext* culling;
+	std::vector<char>* visible;  // Indexed by entity index, as in SpriteDrawContext
+	QuadtreeBounds rect;
+	std::vector<int> items;      // Tree items overlapping rect
+	JobCounter queried, flagged;
+};
+
+// Queue the query and flag jobs for the camera rect
+void beginSpriteCulling(JobSystem& jobs, SpriteCulling& culling, const QuadtreeBounds& rect);
+
+// Wait until the visible flags are built
+void finishSpriteCulling(JobSystem& jobs, SpriteCulling& culling);
+
+// Sprites the camera sees, drawn between the last two ticks. The instances are filled on the job system
+// straight into space reserved in the batch, so every texture must be known before the run.
+struct SpriteDrawContext {
+	SpriteBatch* batch;
+	EcsWorld* world;
+	std::vector<GLuint> textures;         // Registered textures
+	std::vector<unsigned short> slots;    // Batch slot of each texture, from beginSpriteDraw
+	std::vector<char> visible;     // Indexed by entity index
+	float alpha;
+
+	std::vector<size_t> firstInstance;  // Offset of each archetype's rows in the reserved instances
+	SpriteInstance* instances;          // Reserved by beginSpriteDraw
+	uint64_t* keys;
+};
+
+// Register a texture the sprites can be drawn with, once
+void addSpriteDrawTexture(SpriteDrawContext& context, GLuint texture);
+
+// Register the textures in the batch and reserve an instance for every sprite row of the world; call after
+// beginSpriteBatch and before running the system, on the thread that owns the batch
+void beginSpriteDraw(SpriteDrawContext& context);
+
+// Writes each sprite's instance at its interpolated position and current frame, keyed by its layer and
+// texture; culled if not visible or if its texture was never registered
+EcsSystem spriteDrawSystem(SpriteDrawContext* context);
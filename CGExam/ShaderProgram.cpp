@@ -0,0 +1,106 @@
+#include "ShaderProgram.h"
+#include "GLUtils.h"
+#include <iostream>
+
+// Program bound by useShaderProgram, lets repeated binds of the same program be skipped
+static GLuint currentProgram = 0;
+
+bool createShaderProgram(ShaderProgram& program, const char* vertexSource, const char* fragmentSource) {
+	GLuint vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
+	GLuint fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
+	program.id = linkShaderProgram(vertexShader, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	program.uniformNames.clear();
+	program.uniformLocations.clear();
+	program.modelLocation = -1;
+	program.textColorLocation = -1;
+
+	GLint success;
+	glGetProgramiv(program.id, GL_LINK_STATUS, &success);
+	if (!success) {
+		glDeleteProgram(program.id);
+		program.id = 0;
+		return false;
+	}
+
+	// Resolve every active uniform once, members of uniform blocks have no location and are skipped
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<GLchar> name(maxNameLength > 0 ? maxNameLength : 1);
+	for (GLint i = 0; i < uniformCount; ++i) {
+		GLsizei length = 0;
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program.id, i, (GLsizei)name.size(), &length, &size, &type, name.data());
+
+		// Arrays are reported as "name[0]", look them up by their bare name
+		std::string uniformName(name.data(), length);
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniformName.resize(uniformName.size() - 3);
+
+		GLint location = glGetUniformLocation(program.id, uniformName.c_str());
+		if (location < 0)
+			continue;
+		program.uniformNames.push_back(uniformName);
+		program.uniformLocations.push_back(location);
+	}
+
+	program.modelLocation = uniformLocation(program, "model");
+	program.textColorLocation = uniformLocation(program, "textColor");
+
+	// Samplers never change unit, so set them here instead of every draw
+	glUseProgram(program.id);
+	GLint textureLocation = uniformLocation(program, "texture1");
+	if (textureLocation >= 0)
+		glUniform1i(textureLocation, 0);
+	glUseProgram(currentProgram);
+
+	GLuint cameraIndex = glGetUniformBlockIndex(program.id, "Camera");
+	if (cameraIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(program.id, cameraIndex, CAMERA_BLOCK_BINDING);
+
+	return true;
+}
+
+void destroyShaderProgram(ShaderProgram& program) {
+	if (currentProgram == program.id)
+		currentProgram = 0;
+	glDeleteProgram(program.id);
+	program.id = 0;
+}
+
+GLint uniformLocation(const ShaderProgram& program, const char* name) {
+	for (size_t i = 0; i < program.uniformNames.size(); ++i) {
+		if (program.uniformNames[i] == name)
+			return program.uniformLocations[i];
+	}
+	return -1;
+}
+
+bool useShaderProgram(const ShaderProgram& program) {
+	if (currentProgram == program.id)
+		return false;
+	glUseProgram(program.id);
+	currentProgram = program.id;
+	return true;
+}
+
+GLuint createCameraBuffer() {
+	GLuint cameraBuffer;
+	glGenBuffers(1, &cameraBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, cameraBuffer);
+	return cameraBuffer;
+}
+
+void updateCameraBuffer(GLuint cameraBuffer, const glm::mat4& view, const glm::mat4& projection) {
+	CameraBlock block = { view, projection };
+	glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Uniform block binding shared by every program that declares the Camera block
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// GLSL declaration of the shared camera block, std140 so the layout matches CameraBlock
+#define CAMERA_BLOCK_GLSL "layout (std140) uniform Camera { mat4 view; mat4 projection; };\n"
+
+// Linked program with every active uniform location resolved at link time
+struct ShaderProgram {
+	GLuint id;
+	std::vector<std::string> uniformNames;
+	std::vector<GLint> uniformLocations;
+
+	// Uniforms used by the draw paths, -1 when the program doesn't have them
+	GLint modelLocation;
+	GLint textColorLocation;
+};
+
+// Contents of the camera uniform buffer, two mat4 need no std140 padding
+struct CameraBlock {
+	glm::mat4 view;
+	glm::mat4 projection;
+};
+
+// Compile and link a program, cache its uniforms, bind texture1 to unit 0 and the Camera block to its binding
+bool createShaderProgram(ShaderProgram& program, const char* vertexSource, const char* fragmentSource);
+
+// Release the program
+void destroyShaderProgram(ShaderProgram& program);
+
+// Cached location of a uniform, no GL call; -1 when the program doesn't use it
+GLint uniformLocation(const ShaderProgram& program, const char* name);
+
+// Bind the program, skipping the call when it is already current; returns whether it was bound
+bool useShaderProgram(const ShaderProgram& program);
+
+// Create the camera uniform buffer and attach it to CAMERA_BLOCK_BINDING
+GLuint createCameraBuffer();
+
+// Upload view/projection for the frame, every program reads them from the shared block
+void updateCameraBuffer(GLuint cameraBuffer, const glm::mat4& view, const glm::mat4& projection);
@@ -0,0 +1,49 @@
+#include "SpriteAnimation.h"
+
+// Update sprite animation frame
+void updateSpriteAnimation(SpriteAnimation& animation, float deltaTime) {
+	animation.elapsedTime += deltaTime;
+	if (animation.elapsedTime >= animation.frameDuration) {
+		animation.currentFrame = (animation.currentFrame + 1) % animation.frameCount;
+		animation.elapsedTime = 0.0f;
+	}
+}
+
+// Texture rect (u0, v0, u1, v1) of the current frame of a sprite animation, relative to its texture or atlas page
+glm::vec4 getFrameUV(const SpriteAnimation& animation) {
+	//Determine current frame row and column
+	int frameRow = animation.currentFrame / animation.columns;
+	int frameCol = animation.currentFrame % animation.columns;
+
+	//calculate size of each frame in text coord, scaled to the sheet's rect
+	float uSize = (animation.uvRect.z - animation.uvRect.x) / animation.columns;
+	float vSize = (animation.uvRect.w - animation.uvRect.y) / animation.rows;
+
+	//calculate the text coord of the current frame
+	float frameU = animation.uvRect.x + frameCol * uSize;
+	float frameV = animation.uvRect.w - ((frameRow + 1) * vSize);
+
+	return glm::vec4(frameU, frameV, frameU + uSize, frameV + vSize);
+}
+
+// Update texture coordinates for a sprite animation
+void updateTextureCoords(SpriteAnimation& animation, float* vertices) {
+	glm::vec4 uv = getFrameUV(animation);
+
+	//update text coord in the vertex array
+	vertices[2] = uv.x;   vertices[3] = uv.y;   // Bottom-Left
+	vertices[6] = uv.z;   vertices[7] = uv.y;   // Bottom-Right
+	vertices[10] = uv.z;  vertices[11] = uv.w;  // Top-Right
+	vertices[14] = uv.x;  vertices[15] = uv.w;  // Top-Left
+}
+
+// Remember the current position before a simulation tick moves the sprite
+void storePreviousPosition(SpriteAnimation& animation) {
+	animation.prevX = animation.x;
+	animation.prevY = animation.y;
+}
+
+// Position to draw at, alpha of the way from the previous tick to the current one
+glm::vec2 interpolatedPosition(const SpriteAnimation& animation, float alpha) {
+	return glm::vec2(animation.prevX + (animation.x - animation.prevX) * alpha, animation.prevY + (animation.y - animation.prevY) * alpha);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "TextureAtlas.h"
+
+// Structure to hold information about an animated sprite
+struct SpriteAnimation {
+	GLuint textureID;
+	int rows, columns, frameCount, currentFrame;
+	float frameDuration, elapsedTime;
+	float width, height;
+	float x, y;  // Position on the screen
+	float prevX, prevY;  // Position at the previous simulation tick, rendering blends towards x, y
+	glm::vec4 uvRect;  // Sub-rect of the sheet inside textureID, the whole texture unless it lives in an atlas
+
+	// Empty single frame sprite, so animations can be held in pools
+	SpriteAnimation() : SpriteAnimation(0, 1, 1, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f) {}
+
+	SpriteAnimation(GLuint texID, int r, int c, float duration, float frameWidth, float frameHeight, float posX, float posY)
+		: textureID(texID), rows(r), columns(c), frameCount(r* c), currentFrame(0),
+		frameDuration(duration), elapsedTime(0.0f), width(frameWidth), height(frameHeight),
+		x(posX), y(posY), prevX(posX), prevY(posY), uvRect(0.0f, 0.0f, 1.0f, 1.0f) {}
+
+	SpriteAnimation(const AtlasRegion& region, int r, int c, float duration, float frameWidth, float frameHeight, float posX, float posY)
+		: SpriteAnimation(region.textureID, r, c, duration, frameWidth, frameHeight, posX, posY) {
+		uvRect = region.uvRect;
+	}
+};
+
+// Update sprite animation frame
+void updateSpriteAnimation(SpriteAnimation& animation, float deltaTime);
+
+// Texture rect (u0, v0, u1, v1) of the current frame of a sprite animation, relative to its texture or atlas page
+glm::vec4 getFrameUV(const SpriteAnimation& animation);
+
+// Update texture coordinates for a sprite animation
+void updateTextureCoords(SpriteAnimation& animation, float* vertices);
+
+// Remember the current position before a simulation tick moves the sprite
+void storePreviousPosition(SpriteAnimation& animation);
+
+// Position to draw at, alpha of the way from the previous tick to the current one
+glm::vec2 interpolatedPosition(const SpriteAnimation& animation, float alpha);
@@ -0,0 +1,216 @@
+#include "SpriteBatch.h"
+
+// Expands the unit quad with the per-instance rect and frame uv
+static const char* batchVertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
+    layout (location = 0) in vec2 position;
+    layout (location = 1) in vec2 texCoord;
+    layout (location = 2) in vec4 instanceRect;
+    layout (location = 3) in vec4 instanceUV;
+    out vec2 TexCoord;
+    void main() {
+        TexCoord = mix(instanceUV.xy, instanceUV.zw, texCoord);
+        gl_Position = projection * view * vec4(instanceRect.xy + position * instanceRect.zw, 0.0, 1.0);
+    })";
+
+static const char* batchFragmentShaderSource = R"(#version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    void main() {
+        FragColor = texture(texture1, TexCoord);
+    })";
+
+// Point the instance attributes at the first instance of a group, regionOffset is where the frame's data starts
+static void setInstanceAttributes(size_t regionOffset, size_t firstInstance) {
+	const char* base = (const char*)(regionOffset + firstInstance * sizeof(SpriteInstance));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, x)));
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + offsetof(SpriteInstance, u0)));
+}
+
+bool initSpriteBatch(SpriteBatch& batch, size_t initialCapacity) {
+	if (!createShaderProgram(batch.program, batchVertexShaderSource, batchFragmentShaderSource))
+		return false;
+
+	// Same unit quad as the per-sprite path, uv is remapped per instance
+	float vertices[] = {
+		// Positions       // Texture Coords
+		-0.5f, -0.5f,     0.0f, 0.0f,  // Bottom-Left
+		 0.5f, -0.5f,     1.0f, 0.0f,  // Bottom-Right
+		 0.5f,  0.5f,     1.0f, 1.0f,  // Top-Right
+		-0.5f,  0.5f,     0.0f, 1.0f   // Top-Left
+	};
+	unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+	glGenVertexArrays(1, &batch.VAO);
+	glGenBuffers(1, &batch.VBO);
+	glGenBuffers(1, &batch.EBO);
+
+	glBindVertexArray(batch.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
+	size_t capacity = initialCapacity > 0 ? initialCapacity : 1;
+	initStreamBuffer(batch.instances, capacity * sizeof(SpriteInstance));
+	glBindBuffer(GL_ARRAY_BUFFER, batch.instances.buffer);
+	setInstanceAttributes(0, 0);
+	glEnableVertexAttribArray(2);
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	batch.pending.reserve(capacity);
+	batch.keys.reserve(capacity);
+	batch.stats = SpriteBatchStats();
+	return true;
+}
+
+void destroySpriteBatch(SpriteBatch& batch) {
+	glDeleteVertexArrays(1, &batch.VAO);
+	glDeleteBuffers(1, &batch.VBO);
+	glDeleteBuffers(1, &batch.EBO);
+	destroyStreamBuffer(batch.instances);
+	destroyShaderProgram(batch.program);
+}
+
+void beginSpriteBatch(SpriteBatch& batch) {
+	batch.textures.clear();
+	batch.pending.clear();
+	batch.keys.clear();
+}
+
+void drawSprite(SpriteBatch& batch, GLuint texture, const SpriteInstance& instance, unsigned int layer, BlendMode blend, uint32_t depth) {
+	// Sprites tend to be submitted in runs of the same sheet, so check the last slot first
+	size_t slot = batch.keys.empty() ? 0 : renderKeyTexture(batch.keys.back());
+	if (slot >= batch.textures.size() || batch.textures[slot] != texture)
+		slot = spriteTextureSlot(batch, texture);
+
+	batch.pending.push_back(instance);
+	batch.keys.push_back(spriteKey((unsigned short)slot, layer, blend, depth));
+}
+
+unsigned short spriteTextureSlot(SpriteBatch& batch, GLuint texture) {
+	for (size_t slot = 0; slot < batch.textures.size(); ++slot) {
+		if (batch.textures[slot] == texture)
+			return (unsigned short)slot;
+	}
+	batch.textures.push_back(texture);
+	return (unsigned short)(batch.textures.size() - 1);
+}
+
+size_t reserveSprites(SpriteBatch& batch, size_t count, SpriteInstance*& instances, uint64_t*& keys) {
+	size_t first = batch.pending.size();
+	batch.pending.resize(first + count);
+	batch.keys.resize(first + count);
+	instances = batch.pending.data() + first;
+	keys = batch.keys.data() + first;
+	return first;
+}
+
+struct SpriteGatherContext {
+	const SpriteBatch* batch;
+	SpriteInstance* out;
+};
+
+// Copy the instances of a range of sorted commands
+static void gatherSprites(void* context, size_t begin, size_t end) {
+	const SpriteGatherContext& gather = *(const SpriteGatherContext*)context;
+	const RenderCommand* commands = gather.batch->queue.commands.data();
+	const SpriteInstance* pending = gather.batch->pending.data();
+	for (size_t i = begin; i < end; ++i)
+		gather.out[i] = pending[commands[i].item];
+}
+
+static void gatherSortedSprites(const SpriteBatch& batch, SpriteInstance* out, size_t count, JobSystem* jobs) {
+	SpriteGatherContext gather = { &batch, out };
+	if (jobs)
+		parallelFor(*jobs, count, RENDER_SORT_CHUNK, gatherSprites, &gather);
+	else
+		gatherSprites(&gather, 0, count);
+}
+
+size_t sortSpriteBatch(SpriteBatch& batch, SpriteInstance* out, JobSystem* jobs) {
+	size_t drawn = sortRenderKeys(batch.queue, batch.keys.data(), batch.keys.size(), jobs);
+	gatherSortedSprites(batch, out, drawn, jobs);
+	return drawn;
+}
+
+static void setBlendMode(BlendMode blend) {
+	if (blend == BLEND_ADDITIVE)
+		glBlendFunc(GL_ONE, GL_ONE);
+	else
+		glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void endSpriteBatch(SpriteBatch& batch, JobSystem* jobs) {
+	batch.stats = SpriteBatchStats();
+	size_t count = batch.pending.size();
+	if (count == 0)
+		return;
+
+	// The sorted instances are copied straight into this frame's region of the stream buffer, no staging copy
+	size_t drawn = sortRenderKeys(batch.queue, batch.keys.data(), count, jobs);
+	const RenderQueueStats& sorted = batch.queue.stats;
+	batch.stats.sortPasses = sorted.passes;
+	batch.stats.unsortedDrawCalls = (int)sorted.unsortedRuns;
+	if (drawn == 0)
+		return;
+	size_t bytes = drawn * sizeof(SpriteInstance);
+	gatherSortedSprites(batch, (SpriteInstance*)beginStreamRegion(batch.instances, bytes), drawn, jobs);
+	endStreamRegion(batch.instances, bytes);
+	size_t regionOffset = streamRegionOffset(batch.instances);
+
+	if (useShaderProgram(batch.program))
+		batch.stats.stateChanges++;
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(batch.VAO);
+	batch.stats.stateChanges += 2;  // Instance buffer and VAO
+	batch.stats.unsortedStateChanges = batch.stats.stateChanges + 1 + (int)sorted.unsortedChanges + 2 * (int)sorted.unsortedRuns;
+
+	// Layers only decide the order, runs of equal state join across them
+	const RenderCommand* commands = batch.queue.commands.data();
+	BlendMode blend = BLEND_ALPHA;
+	size_t texture = batch.textures.size();
+	for (size_t first = 0; first < drawn;) {
+		uint64_t state = commands[first].key & RENDER_KEY_STATE_MASK;
+		size_t last = first + 1;
+		while (last < drawn && (commands[last].key & RENDER_KEY_STATE_MASK) == state)
+			++last;
+
+		if (renderKeyBlend(state) != blend) {
+			blend = renderKeyBlend(state);
+			setBlendMode(blend);
+			batch.stats.stateChanges++;
+		}
+		if (renderKeyTexture(state) != texture) {
+			texture = renderKeyTexture(state);
+			glBindTexture(GL_TEXTURE_2D, batch.textures[texture]);
+			batch.stats.stateChanges++;
+		}
+		setInstanceAttributes(regionOffset, first);
+		glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)(last - first));
+		batch.stats.drawCalls++;
+		batch.stats.stateChanges += 2;
+		first = last;
+	}
+	if (blend != BLEND_ALPHA) {
+		setBlendMode(BLEND_ALPHA);  // The other passes draw premultiplied alpha
+		batch.stats.stateChanges++;
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	fenceStreamRegion(batch.instances);
+
+	batch.stats.sprites = (int)drawn;
+	batch.stats.bytesUploaded = bytes;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+
+// Per-instance data uploaded to the GPU for one sprite
+struct SpriteInstance {
+	float x, y;           // Center of the sprite
+	float width, height;  // Size of the sprite
+	float u0, v0, u1, v1; // Frame rect in the texture
+};
+
+// Counters for the last flushed batch
+struct SpriteBatchStats {
+	int sprites;
+	int drawCalls;
+	int stateChanges;  // Program, buffer, VAO, blend, texture and attribute pointer changes
+	size_t bytesUploaded;
+	int unsortedDrawCalls;     // What drawing in submission order would have taken, skipping only repeats
+	int unsortedStateChanges;
+	int sortPasses;
+};
+
+// Leaves elements added by resize uninitialized, so reserving sprites doesn't clear memory the fill overwrites
+template <typename T>
+struct UninitializedAllocator : std::allocator<T> {
+	template <typename U>
+	struct rebind { typedef UninitializedAllocator<U> other; };
+
+	UninitializedAllocator() {}
+	template <typename U>
+	UninitializedAllocator(const UninitializedAllocator<U>&) {}
+
+	template <typename U>
+	void construct(U* p) { ::new ((void*)p) U; }
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) { ::new ((void*)p) U(std::forward<Args>(args)...); }
+};
+
+// Collects sprites between begin/end as render commands, sorts them by key and draws every run of equal
+// state with one instanced call. The batch has one program, shader 0 of the keys.
+struct SpriteBatch {
+	ShaderProgram program;
+	GLuint VAO, VBO, EBO;
+	StreamBuffer instances;               // Sorted instances, written straight into the mapped region
+
+	std::vector<GLuint> textures;         // Texture slot -> texture
+	std::vector<SpriteInstance, UninitializedAllocator<SpriteInstance>> pending;  // Instances in submission order
+	std::vector<uint64_t, UninitializedAllocator<uint64_t>> keys;                 // Render key of each pending instance
+	RenderQueue queue;
+
+	SpriteBatchStats stats;
+};
+
+// Create the shader, quad and instance buffers for a sprite batch
+bool initSpriteBatch(SpriteBatch& batch, size_t initialCapacity);
+
+// Release the GL objects owned by a sprite batch
+void destroySpriteBatch(SpriteBatch& batch);
+
+// Start collecting sprites
+void beginSpriteBatch(SpriteBatch& batch);
+
+// Queue one sprite drawn with the given texture. Layers are drawn in order, but inside a layer sprites are
+// grouped by blend and texture, so two sprites on different textures only keep the order they were queued in
+// when they are on different layers. Sprites of equal key keep the order they were queued in.
+void drawSprite(SpriteBatch& batch, GLuint texture, const SpriteInstance& instance, unsigned int layer = RENDER_LAYER_WORLD,
+	BlendMode blend = BLEND_ALPHA, uint32_t depth = 0);
+
+// Slot of a texture in the batch, added if it's new. Calling thread only.
+unsigned short spriteTextureSlot(SpriteBatch& batch, GLuint texture);
+
+// Render key of a sprite drawn with a texture slot
+inline uint64_t spriteKey(unsigned short slot, unsigned int layer = RENDER_LAYER_WORLD, BlendMode blend = BLEND_ALPHA, uint32_t depth = 0) {
+	return renderKey(layer, blend, 0, slot, depth);
+}
+
+// Queue count sprites to be filled in place and return the index of the first. Each one's instance and key
+// (from spriteKey, or RENDER_KEY_CULLED) must be written before endSpriteBatch, from any thread;
+// the pointers stay valid until the next sprite is queued.
+size_t reserveSprites(SpriteBatch& batch, size_t count, SpriteInstance*& instances, uint64_t*& keys);
+
+// Radix sort the queued sprites by key and copy the instances into out in that order, leaving out culled
+// ones. out must have room for every queued sprite; returns how many were kept. With jobs the sort and
+// the copy are split over its threads.
+size_t sortSpriteBatch(SpriteBatch& batch, SpriteInstance* out, JobSystem* jobs = NULL);
+
+// Sort and upload the queued sprites once, then draw each run of equal blend and texture with
+// glDrawElementsInstanced, changing only the state that differs from the run before.
+// View/projection come from the shared camera block
+void endSpriteBatch(SpriteBatch& batch, JobSystem* jobs = NULL);
@@ -0,0 +1,115 @@
+#include "StreamBuffer.h"
+#include <iostream>
+
+const GLbitfield STREAM_MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// Regions start on 256 byte boundaries so every vertex format stays aligned
+static size_t alignRegionSize(size_t bytes) {
+	return ((bytes > 0 ? bytes : 1) + 255) & ~(size_t)255;
+}
+
+static void createStorage(StreamBuffer& stream) {
+	glGenBuffers(1, &stream.buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+	if (stream.persistent) {
+		GLsizeiptr total = (GLsizeiptr)(stream.regionSize * STREAM_BUFFER_REGIONS);
+		glBufferStorage(GL_ARRAY_BUFFER, total, NULL, STREAM_MAP_FLAGS);
+		stream.mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, STREAM_MAP_FLAGS);
+		if (!stream.mapped) {
+			std::cerr << "ERROR::STREAM_BUFFER::MAP_FAILED, falling back to orphaning" << std::endl;
+			glDeleteBuffers(1, &stream.buffer);
+			stream.persistent = false;
+			createStorage(stream);
+			return;
+		}
+	}
+	else {
+		glBufferData(GL_ARRAY_BUFFER, stream.regionSize, NULL, GL_STREAM_DRAW);
+		stream.staging.resize(stream.regionSize);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Block until the GPU has finished reading a region, normally it has long since
+static void waitForRegion(StreamBuffer& stream, int region) {
+	GLsync fence = stream.fences[region];
+	if (!fence)
+		return;
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED) {
+		stream.stats.fenceWaits++;
+		do {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);  // 1 ms
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	stream.fences[region] = 0;
+}
+
+static void releaseStorage(StreamBuffer& stream) {
+	for (int region = 0; region < STREAM_BUFFER_REGIONS; ++region)
+		waitForRegion(stream, region);
+	if (stream.mapped) {
+		glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		stream.mapped = NULL;
+	}
+	glDeleteBuffers(1, &stream.buffer);
+	stream.buffer = 0;
+}
+
+void initStreamBuffer(StreamBuffer& stream, size_t regionSize) {
+	stream.persistent = GLAD_GL_VERSION_4_4 && glBufferStorage && glMapBufferRange;
+	stream.regionSize = alignRegionSize(regionSize);
+	stream.region = STREAM_BUFFER_REGIONS - 1;
+	for (int region = 0; region < STREAM_BUFFER_REGIONS; ++region)
+		stream.fences[region] = 0;
+	stream.mapped = NULL;
+	stream.stats = StreamBufferStats();
+	createStorage(stream);
+}
+
+void destroyStreamBuffer(StreamBuffer& stream) {
+	releaseStorage(stream);
+	stream.staging.clear();
+}
+
+unsigned char* beginStreamRegion(StreamBuffer& stream, size_t bytes) {
+	// Immutable storage can't be resized, so a bigger submission recreates it after the GPU lets go
+	if (bytes > stream.regionSize) {
+		releaseStorage(stream);
+		size_t regionSize = stream.regionSize;
+		while (regionSize < bytes)
+			regionSize *= 2;
+		stream.regionSize = alignRegionSize(regionSize);
+		createStorage(stream);
+		stream.stats.grows++;
+	}
+
+	stream.region = (stream.region + 1) % STREAM_BUFFER_REGIONS;
+	stream.stats.regions++;
+	if (!stream.persistent)
+		return stream.staging.data();
+
+	waitForRegion(stream, stream.region);
+	return stream.mapped + streamRegionOffset(stream);
+}
+
+void endStreamRegion(StreamBuffer& stream, size_t bytes) {
+	glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+	if (stream.persistent)
+		return;  // Coherent mapping, writes are visible without a flush
+
+	// Orphan and refill, the driver hands back fresh storage instead of stalling on the last draw
+	glBufferData(GL_ARRAY_BUFFER, stream.regionSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, stream.staging.data());
+}
+
+void fenceStreamRegion(StreamBuffer& stream) {
+	if (!stream.persistent)
+		return;
+	if (stream.fences[stream.region])
+		glDeleteSync(stream.fences[stream.region]);
+	stream.fences[stream.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
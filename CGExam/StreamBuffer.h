@@ -0,0 +1,50 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// Regions in flight, the CPU writes one while the GPU may still read the other two
+const int STREAM_BUFFER_REGIONS = 3;
+
+// Counters since the stream buffer was created
+struct StreamBufferStats {
+	int regions;      // Regions handed out
+	int fenceWaits;   // Times a region's fence wasn't signalled yet when it came around again
+	int grows;        // Times the storage was recreated for a bigger submission
+};
+
+// Ring of frame-sized regions in one vertex buffer for per-frame instance data.
+// With buffer storage (GL 4.4) the buffer stays mapped persistent and coherent and every region
+// is guarded by a fence, otherwise it falls back to orphaning and uploading from a CPU copy.
+struct StreamBuffer {
+	GLuint buffer;
+	bool persistent;
+	size_t regionSize;
+	int region;                          // Region handed out by the last beginStreamRegion
+	GLsync fences[STREAM_BUFFER_REGIONS];
+	unsigned char* mapped;               // Persistent mapping of all regions, NULL on the fallback
+	std::vector<unsigned char> staging;  // CPU copy of one region on the fallback
+
+	StreamBufferStats stats;
+};
+
+// Create the buffer with room for regionSize bytes per region
+void initStreamBuffer(StreamBuffer& stream, size_t regionSize);
+
+// Unmap and delete the buffer once the GPU is done with it
+void destroyStreamBuffer(StreamBuffer& stream);
+
+// Move to the next region and return where to write bytes of data, growing the storage if it doesn't fit.
+// The region's data starts at streamRegionOffset in the buffer.
+unsigned char* beginStreamRegion(StreamBuffer& stream, size_t bytes);
+
+// Make the bytes written since beginStreamRegion visible to the GPU, leaves the buffer bound to GL_ARRAY_BUFFER
+void endStreamRegion(StreamBuffer& stream, size_t bytes);
+
+// Fence the current region after the draws that read it have been issued
+void fenceStreamRegion(StreamBuffer& stream);
+
+// Byte offset of the current region in the buffer
+inline size_t streamRegionOffset(const StreamBuffer& stream) {
+	return stream.persistent ? stream.region * stream.regionSize : 0;
+}
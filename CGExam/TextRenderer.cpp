@@ -0,0 +1,137 @@
+#include "TextRenderer.h"
+#include <cstddef>
+#include <cstring>
+
+// Places the unit quad at the instance and picks the glyph's cell from the font grid
+static const char* textVertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
+    layout (location = 0) in vec2 corner;
+    layout (location = 1) in vec3 instancePlacement;
+    layout (location = 2) in uint instanceGlyph;
+    layout (location = 3) in vec4 instanceColor;
+    out vec2 TexCoord;
+    out vec4 Color;
+    uniform vec2 glyphGrid;
+    uniform float glyphAspect;
+    void main() {
+        vec2 cell = vec2(float(instanceGlyph % uint(glyphGrid.x)), float(instanceGlyph / uint(glyphGrid.x)));
+        TexCoord = vec2(cell.x + corner.x, glyphGrid.y - cell.y - 1.0 + corner.y) / glyphGrid;
+        Color = vec4(instanceColor.rgb * instanceColor.a, instanceColor.a);
+        vec2 size = vec2(instancePlacement.z * glyphAspect, instancePlacement.z);
+        gl_Position = projection * view * vec4(instancePlacement.xy + corner * size, 0.0, 1.0);
+    })";
+
+static const char* textFragmentShaderSource = R"(#version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    in vec4 Color;
+    uniform sampler2D texture1;
+    void main() {
+        FragColor = texture(texture1, TexCoord) * Color;
+    })";
+
+// Point the glyph attributes at a frame's instances, regionOffset is where they start in the stream buffer
+static void setGlyphAttributes(size_t regionOffset) {
+	const char* base = (const char*)regionOffset;
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, x)));
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, glyph)));
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)(base + offsetof(GlyphInstance, color)));
+}
+
+bool initTextRenderer(TextRenderer& text, GLuint fontTexture, int textureWidth, int textureHeight, int charWidth, int charHeight, size_t initialCapacity) {
+	if (!createShaderProgram(text.program, textVertexShaderSource, textFragmentShaderSource))
+		return false;
+
+	// The grid never changes, so it is set once instead of every frame
+	useShaderProgram(text.program);
+	glUniform2f(uniformLocation(text.program, "glyphGrid"), (float)(textureWidth / charWidth), (float)(textureHeight / charHeight));
+	text.glyphAspect = charWidth / (float)charHeight;
+	glUniform1f(uniformLocation(text.program, "glyphAspect"), text.glyphAspect);
+	text.fontTexture = fontTexture;
+
+	// Triangle strip over the unit square
+	float corners[] = { 0.0f, 0.0f,  1.0f, 0.0f,  0.0f, 1.0f,  1.0f, 1.0f };
+
+	glGenVertexArrays(1, &text.VAO);
+	glGenBuffers(1, &text.quadVBO);
+
+	glBindVertexArray(text.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, text.quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	size_t capacity = initialCapacity > 0 ? initialCapacity : 1;
+	initStreamBuffer(text.instances, capacity * sizeof(GlyphInstance));
+	glBindBuffer(GL_ARRAY_BUFFER, text.instances.buffer);
+	setGlyphAttributes(0);
+	for (GLuint attribute = 1; attribute <= 3; ++attribute) {
+		glEnableVertexAttribArray(attribute);
+		glVertexAttribDivisor(attribute, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	text.glyphs.reserve(capacity);
+	text.stats = TextRendererStats();
+	return true;
+}
+
+void destroyTextRenderer(TextRenderer& text) {
+	glDeleteVertexArrays(1, &text.VAO);
+	glDeleteBuffers(1, &text.quadVBO);
+	destroyStreamBuffer(text.instances);
+	destroyShaderProgram(text.program);
+}
+
+void beginText(TextRenderer& text) {
+	text.glyphs.clear();
+}
+
+float drawText(TextRenderer& text, std::string_view str, float x, float y, float size, const glm::vec4& color) {
+	GlyphInstance glyph;
+	glyph.y = y;
+	glyph.size = size;
+	for (int i = 0; i < 4; ++i)
+		glyph.color[i] = (GLubyte)(glm::clamp(color[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+	float advance = size * text.glyphAspect;
+	for (char c : str) {
+		// Spaces and characters outside the sheet only advance the pen
+		unsigned char code = (unsigned char)c;
+		if (code > 32 && code < 128) {
+			glyph.x = x;
+			glyph.glyph = code - 32;
+			text.glyphs.push_back(glyph);
+		}
+		x += advance;
+	}
+	return x;
+}
+
+void endText(TextRenderer& text) {
+	text.stats = TextRendererStats();
+	size_t count = text.glyphs.size();
+	if (count == 0)
+		return;
+
+	// The whole frame's text is one copy into the stream buffer's next region
+	size_t bytes = count * sizeof(GlyphInstance);
+	memcpy(beginStreamRegion(text.instances, bytes), text.glyphs.data(), bytes);
+	endStreamRegion(text.instances, bytes);
+
+	bool programChanged = useShaderProgram(text.program);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, text.fontTexture);
+	glBindVertexArray(text.VAO);
+	setGlyphAttributes(streamRegionOffset(text.instances));
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)count);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	fenceStreamRegion(text.instances);
+
+	text.stats.glyphs = (int)count;
+	text.stats.drawCalls = 1;
+	text.stats.stateChanges = 3 + (programChanged ? 1 : 0);  // Instance buffer, texture, VAO
+	text.stats.bytesUploaded = bytes;
+}
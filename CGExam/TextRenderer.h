@@ -0,0 +1,50 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <string_view>
+#include <vector>
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+// One queued character, the vertex shader expands it into a quad from the font grid
+struct GlyphInstance {
+	float x, y;          // Bottom-left corner
+	float size;          // Glyph height, the width follows the font's aspect
+	GLuint glyph;        // Index into the font grid, character - 32
+	GLubyte color[4];    // Tint, straight alpha
+};
+
+// Counters for the last flushed frame of text
+struct TextRendererStats {
+	int glyphs;
+	int drawCalls;
+	int stateChanges;
+	size_t bytesUploaded;
+};
+
+// Collects every string of a frame and draws them with one instanced call
+struct TextRenderer {
+	ShaderProgram program;
+	GLuint VAO, quadVBO;
+	StreamBuffer instances;
+	GLuint fontTexture;
+	float glyphAspect;
+
+	std::vector<GlyphInstance> glyphs;
+	TextRendererStats stats;
+};
+
+// Create the text shader and buffers for a font sheet laid out as a grid of charWidth x charHeight glyphs
+bool initTextRenderer(TextRenderer& text, GLuint fontTexture, int textureWidth, int textureHeight, int charWidth, int charHeight, size_t initialCapacity);
+
+// Release the GL objects owned by the text renderer
+void destroyTextRenderer(TextRenderer& text);
+
+// Start collecting strings
+void beginText(TextRenderer& text);
+
+// Queue a string with its first glyph's bottom-left at x, y; returns the x after the last glyph
+float drawText(TextRenderer& text, std::string_view str, float x, float y, float size, const glm::vec4& color);
+
+// Upload the queued glyphs and draw them all in one call
+void endText(TextRenderer& text);
@@ -0,0 +1,338 @@
+#include "TextureAtlas.h"
+#include "GLUtils.h"
+#include "Image.h"
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+
+int reserveAtlasImage(TextureAtlas& atlas) {
+	AtlasImage image;
+	image.pixels = NULL;
+	image.ownsPixels = false;
+	image.blocks = NULL;
+	image.format = TEXTURE_FORMAT_RGBA8;
+	image.mipLevels = 0;
+	image.width = image.height = 0;
+	image.x = image.y = 0;
+	image.page = -1;
+	atlas.images.push_back(image);
+	return (int)atlas.images.size() - 1;
+}
+
+void setAtlasImage(TextureAtlas& atlas, int index, const unsigned char* pixels, int width, int height, bool ownsPixels) {
+	// A sheet that failed to load keeps its slot and ends up with texture 0, like loadTexture
+	AtlasImage& image = atlas.images[index];
+	image.pixels = pixels;
+	image.ownsPixels = ownsPixels;
+	image.width = pixels ? width : 0;
+	image.height = pixels ? height : 0;
+}
+
+void setAtlasBlocks(TextureAtlas& atlas, int index, const unsigned char* blocks, int width, int height, int mipLevels, TextureFormat format) {
+	AtlasImage& image = atlas.images[index];
+	image.blocks = blocks;
+	image.format = format;
+	image.mipLevels = blocks ? mipLevels : 0;
+	image.width = blocks ? width : 0;
+	image.height = blocks ? height : 0;
+}
+
+int addAtlasImage(TextureAtlas& atlas, const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	int width, height;
+	unsigned char* pixels = loadImage(filepath, colorKey, applyColorKey, width, height);
+	int index = reserveAtlasImage(atlas);
+	setAtlasImage(atlas, index, pixels, width, height, true);
+	return index;
+}
+
+int addAtlasImage(TextureAtlas& atlas, const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	const PackedTexture* texture = findPackedTexture(pack, filepath, colorKey, applyColorKey);
+	if (!texture)
+		return addAtlasImage(atlas, filepath, colorKey, applyColorKey);
+
+	// The cooked texture is already keyed, its levels are used straight from the pack
+	int width, height;
+	const unsigned char* data = packedMipLevel(pack, *texture, 0, width, height);
+	int index = reserveAtlasImage(atlas);
+	if (texture->format != TEXTURE_FORMAT_RGBA8)
+		setAtlasBlocks(atlas, index, data, width, height, (int)texture->mipCount, (TextureFormat)texture->format);
+	else
+		setAtlasImage(atlas, index, data, width, height, false);
+	return index;
+}
+
+// Lowest y a rect of the given size can sit at when its left edge is on skyline node i, -1 if it doesn't fit
+static int skylineFit(const std::vector<SkylineNode>& skyline, size_t i, int width, int height, int pageSize) {
+	if (skyline[i].x + width > pageSize)
+		return -1;
+
+	int y = skyline[i].y;
+	int widthLeft = width;
+	for (size_t j = i; widthLeft > 0; ++j) {
+		y = std::max(y, skyline[j].y);
+		if (y + height > pageSize)
+			return -1;
+		widthLeft -= skyline[j].width;
+	}
+	return y;
+}
+
+// Raise the skyline over a newly placed rect and merge segments of equal height
+static void skylineAdd(std::vector<SkylineNode>& skyline, size_t i, int x, int y, int width, int height) {
+	skyline.insert(skyline.begin() + i, { x, y + height, width });
+
+	for (size_t j = i + 1; j < skyline.size(); ) {
+		int previousRight = skyline[j - 1].x + skyline[j - 1].width;
+		if (skyline[j].x >= previousRight)
+			break;
+
+		int shrink = previousRight - skyline[j].x;
+		skyline[j].x += shrink;
+		skyline[j].width -= shrink;
+		if (skyline[j].width > 0)
+			break;
+		skyline.erase(skyline.begin() + j);
+	}
+
+	for (size_t j = 0; j + 1 < skyline.size(); ) {
+		if (skyline[j].y == skyline[j + 1].y) {
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + j + 1);
+		}
+		else {
+			++j;
+		}
+	}
+}
+
+// Try to place a rect on the page, bottom-left rule: lowest top edge first, then narrowest segment
+static bool skylinePlace(std::vector<SkylineNode>& skyline, int width, int height, int pageSize, int& outX, int& outY) {
+	int bestTop = INT_MAX, bestWidth = INT_MAX;
+	size_t bestIndex = skyline.size();
+	for (size_t i = 0; i < skyline.size(); ++i) {
+		int y = skylineFit(skyline, i, width, height, pageSize);
+		if (y < 0)
+			continue;
+		if (y + height < bestTop || (y + height == bestTop && skyline[i].width < bestWidth)) {
+			bestTop = y + height;
+			bestWidth = skyline[i].width;
+			bestIndex = i;
+			outX = skyline[i].x;
+			outY = y;
+		}
+	}
+	if (bestIndex == skyline.size())
+		return false;
+
+	skylineAdd(skyline, bestIndex, outX, outY, width, height);
+	return true;
+}
+
+// Copy an image into its page and extrude its border into the padding so filtering doesn't pick up neighbours
+static void blitPadded(std::vector<unsigned char>& page, int pageSize, const AtlasImage& image, int padding) {
+	for (int y = -padding; y < image.height + padding; ++y) {
+		int srcY = std::min(std::max(y, 0), image.height - 1);
+		int dstY = image.y + y;
+		if (dstY < 0 || dstY >= pageSize)
+			continue;
+
+		for (int x = -padding; x < image.width + padding; ++x) {
+			int srcX = std::min(std::max(x, 0), image.width - 1);
+			int dstX = image.x + x;
+			if (dstX < 0 || dstX >= pageSize)
+				continue;
+			std::memcpy(&page[((size_t)dstY * pageSize + dstX) * 4], &image.pixels[((size_t)srcY * image.width + srcX) * 4], 4);
+		}
+	}
+}
+
+// Let go of the queued pixels the atlas owns once they are packed or given up on
+static void releaseAtlasImages(TextureAtlas& atlas) {
+	for (AtlasImage& image : atlas.images) {
+		if (image.ownsPixels)
+			freeImage((unsigned char*)image.pixels);
+		image.pixels = NULL;
+		image.ownsPixels = false;
+		image.blocks = NULL;
+	}
+}
+
+// Copy one level of an image's blocks into the same level of its page, whole rows of blocks at a time
+static void copyAtlasBlocks(unsigned char* pageLevel, int pageSize, const AtlasImage& image, int level) {
+	size_t blockBytes = image.format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+	const unsigned char* source = image.blocks + textureChainBytes(image.format, image.width, image.height, level);
+	int levelWidth = std::max(1, image.width >> level), levelHeight = std::max(1, image.height >> level);
+	int blocksWide = (levelWidth + 3) / 4, blocksHigh = (levelHeight + 3) / 4;
+	int pageBlocksWide = (std::max(1, pageSize >> level) + 3) / 4;
+	int left = (image.x >> level) / 4, bottom = (image.y >> level) / 4;
+	for (int row = 0; row < blocksHigh; ++row)
+		std::memcpy(pageLevel + ((size_t)(bottom + row) * pageBlocksWide + left) * blockBytes, source + (size_t)row * blocksWide * blockBytes,
+			blocksWide * blockBytes);
+}
+
+// A block whose texels are all transparent black, for the space between images
+static void clearAtlasBlocks(std::vector<unsigned char>& blocks, TextureFormat format) {
+	if (format == TEXTURE_FORMAT_BC3) {
+		std::fill(blocks.begin(), blocks.end(), 0);
+		return;
+	}
+	// Equal endpoints pick the three color mode, index 3 of which is transparent
+	const unsigned char transparent[8] = { 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF };
+	for (size_t offset = 0; offset + 8 <= blocks.size(); offset += 8)
+		std::memcpy(&blocks[offset], transparent, 8);
+}
+
+bool buildTextureAtlas(TextureAtlas& atlas, int pageSize, int padding, bool compress, int threadCount) {
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	atlas.pageSize = std::min(pageSize, (int)maxTextureSize);
+	atlas.padding = padding;
+
+	// Block pages take every image as blocks, other pages as pixels; whatever came the other way is converted
+	bool blockPages = compress && textureCompressionSupported();
+	if (blockPages)
+		atlas.pageSize -= atlas.pageSize % ATLAS_BLOCK_ALIGN;
+	std::vector<std::vector<unsigned char>> encoded(atlas.images.size());
+	for (size_t i = 0; i < atlas.images.size(); ++i) {
+		AtlasImage& image = atlas.images[i];
+		if (blockPages && image.pixels && !image.blocks) {
+			image.format = chooseBlockFormat(image.pixels, image.width, image.height);
+			image.mipLevels = mipLevelCount(image.width, image.height);
+			encoded[i] = compressMipChain(image.pixels, image.width, image.height, image.format, threadCount);
+			image.blocks = encoded[i].data();
+		}
+		else if (!blockPages && image.blocks && !image.pixels) {
+			unsigned char* decoded = (unsigned char*)std::malloc((size_t)image.width * image.height * 4);  // freeImage releases with free
+			decompressImage(image.blocks, image.width, image.height, image.format, decoded);
+			setAtlasImage(atlas, (int)i, decoded, image.width, image.height, true);
+		}
+	}
+
+	// Tallest first packs noticeably tighter with a skyline; block pages hold one format, so those go by format first
+	std::vector<size_t> order(atlas.images.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		const AtlasImage& imageA = atlas.images[a];
+		const AtlasImage& imageB = atlas.images[b];
+		if (blockPages && imageA.format != imageB.format)
+			return imageA.format < imageB.format;
+		return imageA.height > imageB.height;
+	});
+
+	std::vector<std::vector<SkylineNode>> skylines;
+	std::vector<TextureFormat> formats;
+	for (size_t index : order) {
+		AtlasImage& image = atlas.images[index];
+		if (blockPages ? !image.blocks : !image.pixels)
+			continue;
+
+		// Block pages keep images on aligned cells with the padding on the right and top only, other pages
+		// extrude the padding on every side
+		int paddedWidth = image.width + 2 * padding;
+		int paddedHeight = image.height + 2 * padding;
+		TextureFormat format = blockPages ? image.format : TEXTURE_FORMAT_RGBA8;
+		if (blockPages) {
+			paddedWidth = (image.width + padding + ATLAS_BLOCK_ALIGN - 1) / ATLAS_BLOCK_ALIGN * ATLAS_BLOCK_ALIGN;
+			paddedHeight = (image.height + padding + ATLAS_BLOCK_ALIGN - 1) / ATLAS_BLOCK_ALIGN * ATLAS_BLOCK_ALIGN;
+		}
+		if (paddedWidth > atlas.pageSize || paddedHeight > atlas.pageSize) {
+			// Every region falls back to texture 0, like a sheet that failed to load, so callers can still index them
+			std::cerr << "ERROR::ATLAS::IMAGE_TOO_LARGE " << image.width << "x" << image.height << std::endl;
+			AtlasRegion missing = { 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), -1 };
+			atlas.regions.assign(atlas.images.size(), missing);
+			releaseAtlasImages(atlas);
+			return false;
+		}
+
+		int x = 0, y = 0;
+		size_t page = 0;
+		while (page < skylines.size()
+			&& (formats[page] != format || !skylinePlace(skylines[page], paddedWidth, paddedHeight, atlas.pageSize, x, y)))
+			++page;
+		if (page == skylines.size()) {
+			skylines.push_back({ { 0, 0, atlas.pageSize } });
+			formats.push_back(format);
+			skylinePlace(skylines[page], paddedWidth, paddedHeight, atlas.pageSize, x, y);
+		}
+
+		image.x = blockPages ? x : x + padding;
+		image.y = blockPages ? y : y + padding;
+		image.page = (int)page;
+	}
+
+	// Upload pages and work out each image's uv rect
+	std::vector<unsigned char> data;
+	for (size_t page = 0; page < skylines.size(); ++page) {
+		TextureFormat format = formats[page];
+		int levels = format == TEXTURE_FORMAT_RGBA8 ? mipLevelCount(atlas.pageSize, atlas.pageSize) : ATLAS_BLOCK_LEVELS;
+		if (format == TEXTURE_FORMAT_RGBA8) {
+			data.assign((size_t)atlas.pageSize * atlas.pageSize * 4, 0);
+			for (const AtlasImage& image : atlas.images) {
+				if (image.pixels && image.page == (int)page)
+					blitPadded(data, atlas.pageSize, image, padding);
+			}
+			atlas.pages.push_back(createTexture(data.data(), atlas.pageSize, atlas.pageSize));
+		}
+		else {
+			// Each level of each sheet is copied as cooked, nothing is decoded or encoded again
+			data.resize(textureChainBytes(format, atlas.pageSize, atlas.pageSize, levels));
+			clearAtlasBlocks(data, format);
+			size_t levelOffset = 0;
+			for (int level = 0; level < levels; ++level) {
+				for (const AtlasImage& image : atlas.images) {
+					if (image.blocks && image.page == (int)page && level < image.mipLevels)
+						copyAtlasBlocks(&data[levelOffset], atlas.pageSize, image, level);
+				}
+				int levelSize = std::max(1, atlas.pageSize >> level);
+				levelOffset += textureLevelBytes(format, levelSize, levelSize);
+			}
+			atlas.pages.push_back(createTextureLevels(data.data(), atlas.pageSize, atlas.pageSize, levels, format));
+		}
+		atlas.pageFormats.push_back(format);
+		atlas.pageLevels.push_back(levels);
+	}
+
+	float size = (float)atlas.pageSize;
+	atlas.regions.clear();
+	for (AtlasImage& image : atlas.images) {
+		AtlasRegion region;
+		region.page = image.page;
+		if (blockPages ? image.blocks != NULL : image.pixels != NULL) {
+			region.textureID = atlas.pages[image.page];
+			region.uvRect = glm::vec4(image.x / size, image.y / size, (image.x + image.width) / size, (image.y + image.height) / size);
+		}
+		else {
+			region.textureID = 0;
+			region.uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		}
+		atlas.regions.push_back(region);
+	}
+	releaseAtlasImages(atlas);
+
+	std::cout << "Texture atlas: " << atlas.images.size() << " images in " << atlas.pages.size() << " page(s) of "
+		<< atlas.pageSize << "x" << atlas.pageSize;
+	for (TextureFormat format : atlas.pageFormats)
+		std::cout << " " << textureFormatName(format);
+	std::cout << std::endl;
+	return true;
+}
+
+size_t textureAtlasBytes(const TextureAtlas& atlas) {
+	size_t bytes = 0;
+	for (size_t page = 0; page < atlas.pageFormats.size(); ++page)
+		bytes += textureChainBytes(atlas.pageFormats[page], atlas.pageSize, atlas.pageSize, atlas.pageLevels[page]);
+	return bytes;
+}
+
+void destroyTextureAtlas(TextureAtlas& atlas) {
+	if (!atlas.pages.empty())
+		glDeleteTextures((GLsizei)atlas.pages.size(), atlas.pages.data());
+	atlas.pages.clear();
+	atlas.pageFormats.clear();
+	atlas.pageLevels.clear();
+	atlas.regions.clear();
+	atlas.images.clear();
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "TexturePack.h"
+
+// Where a source image ended up after packing
+struct AtlasRegion {
+	GLuint textureID;   // Atlas page texture
+	glm::vec4 uvRect;   // u0, v0, u1, v1 of the image inside the page
+	int page;
+};
+
+// Color keyed source image waiting to be packed, as RGBA pixels or as a cooked block compressed mip chain
+struct AtlasImage {
+	const unsigned char* pixels;
+	bool ownsPixels;    // False when the pixels live in a mapped texture pack
+	const unsigned char* blocks;  // Levels of a cooked BC1/BC3 sheet in a mapped pack, NULL for none
+	TextureFormat format;         // Of blocks
+	int mipLevels;                // In blocks
+	int width, height;
+	int x, y, page;     // Placement inside the atlas, excluding padding
+};
+
+// Levels of a block compressed page. Images start on a multiple of 4 << (levels - 1) texels so every level
+// of a sheet lands on whole blocks and is copied in as it was cooked.
+const int ATLAS_BLOCK_LEVELS = 3;
+const int ATLAS_BLOCK_ALIGN = 4 << (ATLAS_BLOCK_LEVELS - 1);
+
+// Skyline segment, the top edge of the packed area over [x, x + width)
+struct SkylineNode {
+	int x, y, width;
+};
+
+// Packs many sprite sheets into a few large textures so a scene needs only a handful of binds
+struct TextureAtlas {
+	int pageSize, padding;
+	std::vector<AtlasImage> images;
+	std::vector<AtlasRegion> regions;   // One per added image, valid after buildTextureAtlas
+	std::vector<GLuint> pages;
+	std::vector<TextureFormat> pageFormats;  // As uploaded
+	std::vector<int> pageLevels;             // Mip levels of each page
+};
+
+// Reserve a slot for an image whose pixels arrive later through setAtlasImage, returns its index in atlas.regions
+int reserveAtlasImage(TextureAtlas& atlas);
+
+// Hand the pixels of a reserved image to the atlas, NULL pixels leave the slot empty
+void setAtlasImage(TextureAtlas& atlas, int index, const unsigned char* pixels, int width, int height, bool ownsPixels);
+
+// Hand a reserved image the block compressed mip chain of a cooked sheet; the blocks must stay valid until
+// buildTextureAtlas
+void setAtlasBlocks(TextureAtlas& atlas, int index, const unsigned char* blocks, int width, int height, int mipLevels, TextureFormat format);
+
+// Queue an image for packing, returns its index in atlas.regions
+int addAtlasImage(TextureAtlas& atlas, const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Queue an image for packing, taking its pixels from a cooked pack when it has them
+int addAtlasImage(TextureAtlas& atlas, const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Pack the queued images into pages with a skyline bottom-left packer and upload them. With compress and a
+// driver that has S3TC, pages hold one block format each and take the cooked blocks of each sheet as they
+// are, only sheets that came as pixels are encoded (on threadCount threads); otherwise blocks are decoded
+// and pages are RGBA8.
+// Returns false if an image can't fit a page; every region is then texture 0 and the queued pixels are freed.
+bool buildTextureAtlas(TextureAtlas& atlas, int pageSize = 2048, int padding = 2, bool compress = false, int threadCount = 1);
+
+// Texture memory of the pages with their mip chains
+size_t textureAtlasBytes(const TextureAtlas& atlas);
+
+// Release the atlas pages
+void destroyTextureAtlas(TextureAtlas& atlas);
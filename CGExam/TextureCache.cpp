@@ -0,0 +1,208 @@
+#include "TextureCache.h"
+#include "GLUtils.h"
+#include "Image.h"
+#include <algorithm>
+#include <iostream>
+
+// Path and color key settings as one string; the key color only matters when it is applied
+static std::string textureKey(const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	std::string key = filepath;
+	if (applyColorKey) {
+		key += '|';
+		key += std::to_string((int)colorKey.r) + ',' + std::to_string((int)colorKey.g) + ',' + std::to_string((int)colorKey.b);
+	}
+	return key;
+}
+
+void initTextureCache(TextureCache& cache, const TexturePack* pack, size_t budget) {
+	cache.pack = pack;
+	cache.budget = budget;
+	cache.pinnedBytes = 0;
+	cache.clock = 0;
+	cache.nextGeneration = 1;
+	cache.textures.clear();
+	cache.freeSlots.clear();
+	cache.slots.clear();
+	cache.stats = TextureCacheStats();
+}
+
+static void updateBudgetStats(TextureCache& cache) {
+	cache.stats.peakBytes = std::max(cache.stats.peakBytes, cache.stats.bytes);
+	cache.stats.overBudget = cache.budget > 0 && cache.stats.bytes + cache.pinnedBytes > cache.budget;
+}
+
+// Delete a texture and free its slot, stale handles to it no longer match
+static void evictTexture(TextureCache& cache, uint32_t slot) {
+	CachedTexture& texture = cache.textures[slot];
+	glDeleteTextures(1, &texture.textureID);
+	cache.slots.erase(texture.key);
+	cache.stats.bytes -= texture.bytes;
+	cache.stats.textures--;
+	cache.stats.evictions++;
+	texture = CachedTexture();
+	cache.freeSlots.push_back(slot);
+}
+
+// Evict unreferenced textures, least recently used first, until the budget is met or none are left
+static void trimTextureCache(TextureCache& cache) {
+	while (cache.budget > 0 && cache.stats.bytes + cache.pinnedBytes > cache.budget) {
+		uint32_t oldest = 0;
+		bool found = false;
+		for (uint32_t slot = 0; slot < cache.textures.size(); ++slot) {
+			const CachedTexture& texture = cache.textures[slot];
+			if (texture.generation != 0 && texture.refs == 0 && (!found || texture.lastUse < cache.textures[oldest].lastUse)) {
+				oldest = slot;
+				found = true;
+			}
+		}
+		if (!found)
+			break;
+		evictTexture(cache, oldest);
+	}
+	updateBudgetStats(cache);
+}
+
+// Put a loaded texture in a free slot, referenced once
+static TextureHandle insertTexture(TextureCache& cache, const std::string& key, const char* filepath, GLuint textureID,
+	int width, int height, int mipLevels, TextureFormat format) {
+	uint32_t slot;
+	if (!cache.freeSlots.empty()) {
+		slot = cache.freeSlots.back();
+		cache.freeSlots.pop_back();
+	}
+	else {
+		slot = (uint32_t)cache.textures.size();
+		cache.textures.push_back(CachedTexture());
+	}
+	// Generations count up across the whole cache, so a reused slot never matches an old handle
+	uint32_t generation = cache.nextGeneration++;
+	if (cache.nextGeneration == 0)
+		cache.nextGeneration = 1;
+
+	CachedTexture& texture = cache.textures[slot];
+	texture.key = key;
+	texture.filepath = filepath;
+	texture.textureID = textureID;
+	texture.width = width;
+	texture.height = height;
+	texture.mipLevels = mipLevels;
+	texture.format = format;
+	texture.bytes = textureChainBytes(format, width, height, mipLevels);
+	texture.refs = 1;
+	texture.lastUse = ++cache.clock;
+	texture.generation = generation;
+	cache.slots[key] = slot;
+	cache.stats.bytes += texture.bytes;
+	cache.stats.textures++;
+	trimTextureCache(cache);
+	return { slot, generation };
+}
+
+// Reference a texture already in the cache
+static TextureHandle referenceTexture(TextureCache& cache, uint32_t slot) {
+	CachedTexture& texture = cache.textures[slot];
+	texture.refs++;
+	texture.lastUse = ++cache.clock;
+	cache.stats.hits++;
+	return { slot, texture.generation };
+}
+
+// Upload from the pack when it has the texture, otherwise decode the source image
+static GLuint loadCachedTexture(const TextureCache& cache, const char* filepath, const glm::vec3& colorKey, bool applyColorKey,
+	int& width, int& height, int& mipLevels, TextureFormat& format) {
+	const PackedTexture* packed = cache.pack ? findPackedTexture(*cache.pack, filepath, colorKey, applyColorKey) : NULL;
+	if (packed) {
+		width = (int)packed->width;
+		height = (int)packed->height;
+		mipLevels = (int)packed->mipCount;
+		format = gpuTextureFormat((TextureFormat)packed->format);
+		return createPackedTexture(*cache.pack, *packed);
+	}
+	unsigned char* pixels = loadImage(filepath, colorKey, applyColorKey, width, height);
+	if (!pixels)
+		return 0;
+	GLuint textureID = createTexture(pixels, width, height);
+	freeImage(pixels);
+	mipLevels = mipLevelCount(width, height);
+	format = TEXTURE_FORMAT_RGBA8;
+	return textureID;
+}
+
+TextureHandle acquireTexture(TextureCache& cache, const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	std::string key = textureKey(filepath, colorKey, applyColorKey);
+	std::unordered_map<std::string, uint32_t>::const_iterator found = cache.slots.find(key);
+	if (found != cache.slots.end())
+		return referenceTexture(cache, found->second);
+
+	int width = 0, height = 0, mipLevels = 0;
+	TextureFormat format = TEXTURE_FORMAT_RGBA8;
+	GLuint textureID = loadCachedTexture(cache, filepath, colorKey, applyColorKey, width, height, mipLevels, format);
+	if (!textureID) {
+		std::cerr << "ERROR::TEXTURE_CACHE::LOAD_FAILED " << filepath << std::endl;
+		cache.stats.failed++;
+		return NULL_TEXTURE_HANDLE;
+	}
+	cache.stats.loads++;
+	return insertTexture(cache, key, filepath, textureID, width, height, mipLevels, format);
+}
+
+TextureHandle adoptTexture(TextureCache& cache, const char* filepath, const glm::vec3& colorKey, bool applyColorKey, GLuint textureID,
+	int width, int height, int mipLevels, TextureFormat format) {
+	if (!textureID)
+		return NULL_TEXTURE_HANDLE;
+	std::string key = textureKey(filepath, colorKey, applyColorKey);
+	std::unordered_map<std::string, uint32_t>::const_iterator found = cache.slots.find(key);
+	if (found != cache.slots.end()) {
+		glDeleteTextures(1, &textureID);
+		return referenceTexture(cache, found->second);
+	}
+	cache.stats.loads++;
+	return insertTexture(cache, key, filepath, textureID, width, height, mipLevels, format);
+}
+
+static bool textureAlive(const TextureCache& cache, TextureHandle handle) {
+	return handle.generation != 0 && handle.slot < cache.textures.size() && cache.textures[handle.slot].generation == handle.generation;
+}
+
+void releaseTexture(TextureCache& cache, TextureHandle handle) {
+	if (!textureAlive(cache, handle) || cache.textures[handle.slot].refs == 0)
+		return;
+	CachedTexture& texture = cache.textures[handle.slot];
+	texture.lastUse = ++cache.clock;
+	if (--texture.refs == 0)
+		trimTextureCache(cache);
+}
+
+GLuint cachedTextureID(const TextureCache& cache, TextureHandle handle) {
+	return textureAlive(cache, handle) ? cache.textures[handle.slot].textureID : 0;
+}
+
+bool cachedTextureSize(const TextureCache& cache, TextureHandle handle, int& width, int& height) {
+	if (!textureAlive(cache, handle))
+		return false;
+	width = cache.textures[handle.slot].width;
+	height = cache.textures[handle.slot].height;
+	return true;
+}
+
+void setTextureBudget(TextureCache& cache, size_t budget) {
+	cache.budget = budget;
+	trimTextureCache(cache);
+}
+
+void setPinnedTextureBytes(TextureCache& cache, size_t bytes) {
+	cache.pinnedBytes = bytes;
+	trimTextureCache(cache);
+}
+
+void destroyTextureCache(TextureCache& cache) {
+	for (const CachedTexture& texture : cache.textures) {
+		if (texture.generation != 0)
+			glDeleteTextures(1, &texture.textureID);
+	}
+	cache.textures.clear();
+	cache.freeSlots.clear();
+	cache.slots.clear();
+	cache.stats.bytes = 0;
+	cache.stats.textures = 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TexturePack.h"
+
+// Names a texture held in a cache. A slot reused after an eviction gets a new generation, so a handle
+// kept past its release no longer matches once the texture is gone. A zeroed handle is always null.
+struct TextureHandle {
+	uint32_t slot;
+	uint32_t generation;
+};
+
+const TextureHandle NULL_TEXTURE_HANDLE = { 0, 0 };
+
+// A loaded texture, shared by everyone who acquired the same path and color key settings
+struct CachedTexture {
+	std::string key;       // Path and color key settings, as in TextureCache::slots
+	std::string filepath;
+	GLuint textureID;
+	int width, height, mipLevels;
+	TextureFormat format;  // On the GPU
+	size_t bytes;          // Every mip level
+	int refs;              // Unreferenced textures stay loaded until the budget needs their memory
+	uint64_t lastUse;      // cache.clock at the last acquire or release, oldest is evicted first
+	uint32_t generation;   // 0 while the slot is free
+};
+
+struct TextureCacheStats {
+	size_t bytes;          // Textures held by the cache
+	size_t peakBytes;
+	int textures;
+	int hits;              // Acquires served by a texture already loaded
+	int loads;
+	int evictions;
+	int failed;            // Loads that found no image
+	bool overBudget;       // Referenced textures alone don't fit, nothing more can be evicted
+};
+
+// Texture cache keyed by path and color key settings with reference counted handles. Textures nobody
+// references are kept for the next acquire and evicted least recently used first when the textures
+// plus the pinned bytes go over the budget; referenced ones are never evicted, so their GL names stay valid.
+struct TextureCache {
+	const TexturePack* pack;  // Cooked textures come from here, NULL to always decode
+	size_t budget;            // Bytes, 0 for no limit
+	size_t pinnedBytes;       // Texture memory the cache doesn't own (atlas pages), counted against the budget
+	uint64_t clock;
+	uint32_t nextGeneration;  // Of the next texture loaded, never 0
+	std::vector<CachedTexture> textures;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, uint32_t> slots;
+	TextureCacheStats stats;
+};
+
+// Start an empty cache loading from pack (may be NULL) under budget bytes, 0 for no limit
+void initTextureCache(TextureCache& cache, const TexturePack* pack, size_t budget);
+
+// Delete every texture, referenced or not
+void destroyTextureCache(TextureCache& cache);
+
+// Reference the texture of a path and color key settings, loading it on first use. The null handle
+// if the image can't be loaded.
+TextureHandle acquireTexture(TextureCache& cache, const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Hand a texture something else already uploaded (e.g. the TextureLoader) to the cache, referenced
+// once. If the cache already has it the copy is deleted and the cached one referenced instead.
+TextureHandle adoptTexture(TextureCache& cache, const char* filepath, const glm::vec3& colorKey, bool applyColorKey, GLuint textureID,
+	int width, int height, int mipLevels, TextureFormat format);
+
+// Drop a reference; the handle must not be used after
+void releaseTexture(TextureCache& cache, TextureHandle handle);
+
+// GL name of a referenced texture, 0 for a stale handle
+GLuint cachedTextureID(const TextureCache& cache, TextureHandle handle);
+
+// Size of level 0 of a referenced texture, false for a stale handle
+bool cachedTextureSize(const TextureCache& cache, TextureHandle handle, int& width, int& height);
+
+// Change the budget, evicting what no longer fits
+void setTextureBudget(TextureCache& cache, size_t budget);
+
+// Count texture memory the cache doesn't own against its budget
+void setPinnedTextureBytes(TextureCache& cache, size_t bytes);
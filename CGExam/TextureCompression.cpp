@@ -0,0 +1,549 @@
+#include "TextureCompression.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include "CpuFeatures.h"
+#include "TexturePack.h"
+
+// Nearest of paletteSize RGBA palette colors for each of 16 RGBA texels by squared RGB distance, ties to
+// the lower index. Texels in skipMask get no index. Returns the summed squared error.
+typedef int (*SelectColorsKernel)(const unsigned char* texels, const unsigned char* palette, int paletteSize, unsigned int skipMask,
+	unsigned char* indices);
+
+static int selectColorsScalar(const unsigned char* texels, const unsigned char* palette, int paletteSize, unsigned int skipMask,
+	unsigned char* indices) {
+	int error = 0;
+	for (int i = 0; i < 16; ++i) {
+		if (skipMask & (1u << i))
+			continue;
+		const unsigned char* texel = texels + i * 4;
+		int best = INT_MAX, bestIndex = 0;
+		for (int p = 0; p < paletteSize; ++p) {
+			int r = texel[0] - palette[p * 4 + 0];
+			int g = texel[1] - palette[p * 4 + 1];
+			int b = texel[2] - palette[p * 4 + 2];
+			int distance = r * r + g * g + b * b;
+			if (distance < best) {
+				best = distance;
+				bestIndex = p;
+			}
+		}
+		indices[i] = (unsigned char)bestIndex;
+		error += best;
+	}
+	return error;
+}
+
+#ifdef CPU_X86
+
+// 4 texels per step: widened to 16 bits with alpha masked off, madd squares and sums r,g and b,a pairs
+static int selectColorsSSE2(const unsigned char* texels, const unsigned char* palette, int paletteSize, unsigned int skipMask,
+	unsigned char* indices) {
+	const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i entries[4];
+	for (int p = 0; p < paletteSize; ++p) {
+		uint32_t color;
+		std::memcpy(&color, palette + p * 4, 4);
+		entries[p] = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color & 0x00FFFFFF)), zero);
+	}
+
+	int error = 0;
+	for (int group = 0; group < 4; ++group) {
+		__m128i quad = _mm_and_si128(_mm_loadu_si128((const __m128i*)(texels + group * 16)), rgbMask);
+		__m128i low = _mm_unpacklo_epi8(quad, zero);
+		__m128i high = _mm_unpackhi_epi8(quad, zero);
+		__m128i best = _mm_set1_epi32(INT_MAX);
+		__m128i bestIndex = zero;
+		for (int p = 0; p < paletteSize; ++p) {
+			__m128i lowDelta = _mm_sub_epi16(low, entries[p]);
+			__m128i highDelta = _mm_sub_epi16(high, entries[p]);
+			__m128 lowSquares = _mm_castsi128_ps(_mm_madd_epi16(lowDelta, lowDelta));
+			__m128 highSquares = _mm_castsi128_ps(_mm_madd_epi16(highDelta, highDelta));
+			__m128i distance = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lowSquares, highSquares, _MM_SHUFFLE(2, 0, 2, 0))),
+				_mm_castps_si128(_mm_shuffle_ps(lowSquares, highSquares, _MM_SHUFFLE(3, 1, 3, 1))));
+			__m128i closer = _mm_cmplt_epi32(distance, best);
+			best = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+		}
+
+		int distances[4], closest[4];
+		_mm_storeu_si128((__m128i*)distances, best);
+		_mm_storeu_si128((__m128i*)closest, bestIndex);
+		for (int lane = 0; lane < 4; ++lane) {
+			int i = group * 4 + lane;
+			if (skipMask & (1u << i))
+				continue;
+			indices[i] = (unsigned char)closest[lane];
+			error += distances[lane];
+		}
+	}
+	return error;
+}
+
+#endif
+
+BlockKernel bestBlockKernel() {
+#ifdef CPU_X86
+	return BLOCK_KERNEL_SSE2;
+#else
+	return BLOCK_KERNEL_SCALAR;
+#endif
+}
+
+const char* blockKernelName(BlockKernel kernel) {
+	switch (kernel == BLOCK_KERNEL_BEST ? bestBlockKernel() : kernel) {
+	case BLOCK_KERNEL_SSE2: return "SSE2";
+	default: return "scalar";
+	}
+}
+
+const char* textureFormatName(TextureFormat format) {
+	switch (format) {
+	case TEXTURE_FORMAT_BC1: return "BC1";
+	case TEXTURE_FORMAT_BC3: return "BC3";
+	default: return "RGBA8";
+	}
+}
+
+static SelectColorsKernel selectColorsKernel(BlockKernel kernel) {
+#ifdef CPU_X86
+	if (kernel != BLOCK_KERNEL_SCALAR)
+		return selectColorsSSE2;
+#endif
+	return selectColorsScalar;
+}
+
+size_t textureLevelBytes(TextureFormat format, int width, int height) {
+	if (format == TEXTURE_FORMAT_RGBA8)
+		return (size_t)width * height * 4;
+	size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	return blocks * (format == TEXTURE_FORMAT_BC1 ? 8 : 16);
+}
+
+size_t textureChainBytes(TextureFormat format, int width, int height, int mipLevels) {
+	size_t bytes = 0;
+	for (int level = 0; level < mipLevels; ++level) {
+		bytes += textureLevelBytes(format, width, height);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return bytes;
+}
+
+TextureFormat chooseBlockFormat(const unsigned char* rgba, int width, int height) {
+	size_t texels = (size_t)width * height;
+	for (size_t i = 0; i < texels; ++i) {
+		unsigned char alpha = rgba[i * 4 + 3];
+		if (alpha != 0 && alpha != 255)
+			return TEXTURE_FORMAT_BC3;
+	}
+	return TEXTURE_FORMAT_BC1;
+}
+
+void downsampleImage(const unsigned char* src, int srcWidth, int srcHeight, unsigned char* dst, int dstWidth, int dstHeight) {
+	for (int y = 0; y < dstHeight; ++y) {
+		int y0 = std::min(2 * y, srcHeight - 1);
+		int y1 = std::min(2 * y + 1, srcHeight - 1);
+		for (int x = 0; x < dstWidth; ++x) {
+			int x0 = std::min(2 * x, srcWidth - 1);
+			int x1 = std::min(2 * x + 1, srcWidth - 1);
+			const unsigned char* a = &src[((size_t)y0 * srcWidth + x0) * 4];
+			const unsigned char* b = &src[((size_t)y0 * srcWidth + x1) * 4];
+			const unsigned char* c = &src[((size_t)y1 * srcWidth + x0) * 4];
+			const unsigned char* d = &src[((size_t)y1 * srcWidth + x1) * 4];
+			unsigned char* out = &dst[((size_t)y * dstWidth + x) * 4];
+			for (int channel = 0; channel < 4; ++channel)
+				out[channel] = (unsigned char)((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+		}
+	}
+}
+
+static uint16_t packColor565(const float* color) {
+	int r = std::min(31, std::max(0, (int)(color[0] * 31.0f / 255.0f + 0.5f)));
+	int g = std::min(63, std::max(0, (int)(color[1] * 63.0f / 255.0f + 0.5f)));
+	int b = std::min(31, std::max(0, (int)(color[2] * 31.0f / 255.0f + 0.5f)));
+	return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void unpackColor565(uint16_t color, unsigned char* out) {
+	int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+	out[0] = (unsigned char)(r << 3 | r >> 2);
+	out[1] = (unsigned char)(g << 2 | g >> 4);
+	out[2] = (unsigned char)(b << 3 | b >> 2);
+	out[3] = 255;
+}
+
+// The four colors of a block; c0 > c1 or a BC3 block interpolates two, otherwise one and a transparent black
+static void colorPalette(uint16_t c0, uint16_t c1, bool fourColors, unsigned char* palette) {
+	unpackColor565(c0, palette);
+	unpackColor565(c1, palette + 4);
+	for (int channel = 0; channel < 3; ++channel) {
+		int a = palette[channel], b = palette[4 + channel];
+		if (fourColors) {
+			palette[8 + channel] = (unsigned char)((2 * a + b) / 3);
+			palette[12 + channel] = (unsigned char)((a + 2 * b) / 3);
+		}
+		else {
+			palette[8 + channel] = (unsigned char)((a + b) / 2);
+			palette[12 + channel] = 0;
+		}
+	}
+	palette[11] = 255;
+	palette[15] = fourColors ? 255 : 0;
+}
+
+// Ends of the line through the texels outside skipMask: the principal axis of their covariance, found by
+// power iteration, clipped to the extreme texels and inset a little as the interpolated colors cover the middle
+static void fitColorLine(const unsigned char* texels, unsigned int skipMask, float* start, float* end) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	float low[3] = { 255.0f, 255.0f, 255.0f }, high[3] = { 0.0f, 0.0f, 0.0f };
+	int count = 0;
+	for (int i = 0; i < 16; ++i) {
+		if (skipMask & (1u << i))
+			continue;
+		for (int channel = 0; channel < 3; ++channel) {
+			float value = texels[i * 4 + channel];
+			mean[channel] += value;
+			low[channel] = std::min(low[channel], value);
+			high[channel] = std::max(high[channel], value);
+		}
+		++count;
+	}
+	for (int channel = 0; channel < 3; ++channel)
+		mean[channel] /= (float)count;
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };  // rr rg rb gg gb bb
+	for (int i = 0; i < 16; ++i) {
+		if (skipMask & (1u << i))
+			continue;
+		float r = texels[i * 4 + 0] - mean[0], g = texels[i * 4 + 1] - mean[1], b = texels[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	float axis[3] = { high[0] - low[0], high[1] - low[1], high[2] - low[2] };
+	for (int iteration = 0; iteration < 4; ++iteration) {
+		float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+		float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+		float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+		float largest = std::max(std::fabs(r), std::max(std::fabs(g), std::fabs(b)));
+		if (largest < 1e-6f)
+			break;
+		axis[0] = r / largest;
+		axis[1] = g / largest;
+		axis[2] = b / largest;
+	}
+
+	float lowest = std::numeric_limits<float>::max(), highest = -lowest;
+	int lowIndex = 0, highIndex = 0;
+	for (int i = 0; i < 16; ++i) {
+		if (skipMask & (1u << i))
+			continue;
+		float projection = texels[i * 4 + 0] * axis[0] + texels[i * 4 + 1] * axis[1] + texels[i * 4 + 2] * axis[2];
+		if (projection < lowest) {
+			lowest = projection;
+			lowIndex = i;
+		}
+		if (projection > highest) {
+			highest = projection;
+			highIndex = i;
+		}
+	}
+	for (int channel = 0; channel < 3; ++channel) {
+		float a = texels[highIndex * 4 + channel], b = texels[lowIndex * 4 + channel];
+		float inset = (a - b) / 16.0f;
+		start[channel] = a - inset;
+		end[channel] = b + inset;
+	}
+}
+
+// Least squares endpoints for the indices picked, weight of c0 per index
+static bool refitColorLine(const unsigned char* texels, unsigned int skipMask, const unsigned char* indices, bool fourColors,
+	float* start, float* end) {
+	const float fourWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	const float threeWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+	const float* weights = fourColors ? fourWeights : threeWeights;
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; ++i) {
+		if (skipMask & (1u << i))
+			continue;
+		float a = weights[indices[i]], b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int channel = 0; channel < 3; ++channel) {
+			ax[channel] += a * texels[i * 4 + channel];
+			bx[channel] += b * texels[i * 4 + channel];
+		}
+	}
+	float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+		return false;
+	for (int channel = 0; channel < 3; ++channel) {
+		start[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+		end[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+	}
+	return true;
+}
+
+// Endpoints in the order the mode needs, the palette and the indices and error that go with them
+static int fitColorEndpoints(const unsigned char* texels, unsigned int skipMask, bool threeColors, SelectColorsKernel select,
+	const float* start, const float* end, uint16_t& c0, uint16_t& c1, unsigned char* indices) {
+	c0 = packColor565(start);
+	c1 = packColor565(end);
+	if (threeColors ? c0 > c1 : c0 < c1)
+		std::swap(c0, c1);
+	// A single color reads the same in either mode on index 0, so it is the only one offered
+	bool single = !threeColors && c0 == c1;
+	unsigned char palette[16];
+	colorPalette(c0, c1, !threeColors, palette);
+	return select(texels, palette, single ? 1 : threeColors ? 3 : 4, skipMask, indices);
+}
+
+// 8-byte color block. Texels in transparentMask go on index 3 of the three color mode; a BC3 block always
+// decodes four colors and has none.
+static void encodeColorBlock(const unsigned char* texels, unsigned int transparentMask, SelectColorsKernel select, unsigned char* out) {
+	uint16_t c0 = 0, c1 = 0;
+	unsigned char indices[16];
+	std::memset(indices, 3, 16);
+	if (transparentMask != 0xFFFF) {
+		bool threeColors = transparentMask != 0;
+		float start[3], end[3];
+		fitColorLine(texels, transparentMask, start, end);
+		int error = fitColorEndpoints(texels, transparentMask, threeColors, select, start, end, c0, c1, indices);
+
+		// One least squares pass over the picked indices, kept if it lowers the error
+		uint16_t refitC0, refitC1;
+		unsigned char refitIndices[16];
+		std::memset(refitIndices, 3, 16);
+		bool single = !threeColors && c0 == c1;
+		if (error > 0 && !single && refitColorLine(texels, transparentMask, indices, !threeColors, start, end)) {
+			int refitError = fitColorEndpoints(texels, transparentMask, threeColors, select, start, end, refitC0, refitC1, refitIndices);
+			if (refitError < error) {
+				c0 = refitC0;
+				c1 = refitC1;
+				std::memcpy(indices, refitIndices, 16);
+			}
+		}
+	}
+
+	uint32_t bits = 0;
+	for (int i = 0; i < 16; ++i)
+		bits |= (uint32_t)indices[i] << (2 * i);
+	out[0] = (unsigned char)(c0 & 0xFF);
+	out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)(c1 & 0xFF);
+	out[3] = (unsigned char)(c1 >> 8);
+	std::memcpy(out + 4, &bits, 4);
+}
+
+// The eight alphas of a block, interpolated between a0 > a1, or six plus 0 and 255 otherwise
+static void alphaPalette(int a0, int a1, int* palette) {
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1) {
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	}
+	else {
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// 8-byte BC3 alpha block spanning the block's lowest and highest alpha
+static void encodeAlphaBlock(const unsigned char* texels, unsigned char* out) {
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; ++i) {
+		low = std::min(low, (int)texels[i * 4 + 3]);
+		high = std::max(high, (int)texels[i * 4 + 3]);
+	}
+	std::memset(out, 0, 8);
+	out[0] = (unsigned char)high;
+	out[1] = (unsigned char)low;
+	if (high == low)
+		return;
+
+	int palette[8];
+	alphaPalette(high, low, palette);
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; ++i) {
+		int alpha = texels[i * 4 + 3];
+		int best = INT_MAX, bestIndex = 0;
+		for (int p = 0; p < 8; ++p) {
+			int distance = std::abs(alpha - palette[p]);
+			if (distance < best) {
+				best = distance;
+				bestIndex = p;
+			}
+		}
+		bits |= (uint64_t)bestIndex << (3 * i);
+	}
+	for (int i = 0; i < 6; ++i)
+		out[2 + i] = (unsigned char)(bits >> (8 * i));
+}
+
+// Copy a 4x4 block out of the image, edge blocks repeating the last row/column
+static void gatherBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, unsigned char* texels) {
+	for (int y = 0; y < 4; ++y) {
+		int sourceY = std::min(blockY * 4 + y, height - 1);
+		for (int x = 0; x < 4; ++x) {
+			int sourceX = std::min(blockX * 4 + x, width - 1);
+			std::memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+		}
+	}
+}
+
+static void encodeBlock(unsigned char* texels, TextureFormat format, SelectColorsKernel select, unsigned char* out) {
+	if (format == TEXTURE_FORMAT_BC3) {
+		encodeAlphaBlock(texels, out);
+		encodeColorBlock(texels, 0, select, out + 8);
+		return;
+	}
+
+	// BC1 opaque texels have alpha 1, so the premultiplied color of a partly covered mip texel is scaled back up
+	unsigned int transparentMask = 0;
+	for (int i = 0; i < 16; ++i) {
+		unsigned char* texel = texels + i * 4;
+		int alpha = texel[3];
+		if (alpha < 128)
+			transparentMask |= 1u << i;
+		else if (alpha < 255) {
+			for (int channel = 0; channel < 3; ++channel)
+				texel[channel] = (unsigned char)std::min(255, (texel[channel] * 255 + alpha / 2) / alpha);
+		}
+	}
+	encodeColorBlock(texels, transparentMask, select, out);
+}
+
+struct CompressJob {
+	const unsigned char* rgba;
+	int width, height;
+	TextureFormat format;
+	unsigned char* blocks;
+	SelectColorsKernel select;
+	std::atomic<int> nextRow;
+};
+
+// Encode rows of blocks until none are left
+static void compressRows(CompressJob& job) {
+	int blocksWide = (job.width + 3) / 4, blocksHigh = (job.height + 3) / 4;
+	size_t blockBytes = job.format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+	unsigned char texels[64];
+	for (int row = job.nextRow.fetch_add(1); row < blocksHigh; row = job.nextRow.fetch_add(1)) {
+		unsigned char* out = job.blocks + (size_t)row * blocksWide * blockBytes;
+		for (int column = 0; column < blocksWide; ++column, out += blockBytes) {
+			gatherBlock(job.rgba, job.width, job.height, column, row, texels);
+			encodeBlock(texels, job.format, job.select, out);
+		}
+	}
+}
+
+void compressImage(const unsigned char* rgba, int width, int height, TextureFormat format, unsigned char* blocks, int threadCount,
+	BlockKernel kernel) {
+	CompressJob job;
+	job.rgba = rgba;
+	job.width = width;
+	job.height = height;
+	job.format = format;
+	job.blocks = blocks;
+	job.select = selectColorsKernel(kernel);
+	job.nextRow = 0;
+
+	// At least 16 rows of blocks per thread, small mip levels aren't worth waking anyone for
+	int blocksHigh = (height + 3) / 4;
+	int threads = std::max(1, std::min(threadCount, blocksHigh / 16));
+	std::vector<std::thread> workers;
+	for (int i = 1; i < threads; ++i)
+		workers.emplace_back(compressRows, std::ref(job));
+	compressRows(job);
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+static void decodeColorBlock(const unsigned char* block, bool alwaysFourColors, unsigned char* texels) {
+	uint16_t c0 = (uint16_t)(block[0] | block[1] << 8);
+	uint16_t c1 = (uint16_t)(block[2] | block[3] << 8);
+	unsigned char palette[16];
+	colorPalette(c0, c1, alwaysFourColors || c0 > c1, palette);
+	uint32_t bits;
+	std::memcpy(&bits, block + 4, 4);
+	for (int i = 0; i < 16; ++i)
+		std::memcpy(texels + i * 4, palette + ((bits >> (2 * i)) & 3) * 4, 4);
+}
+
+static void decodeAlphaBlock(const unsigned char* block, unsigned char* texels) {
+	int palette[8];
+	alphaPalette(block[0], block[1], palette);
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; ++i)
+		bits |= (uint64_t)block[2 + i] << (8 * i);
+	for (int i = 0; i < 16; ++i)
+		texels[i * 4 + 3] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+}
+
+void decompressImage(const unsigned char* blocks, int width, int height, TextureFormat format, unsigned char* rgba) {
+	int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+	size_t blockBytes = format == TEXTURE_FORMAT_BC1 ? 8 : 16;
+	unsigned char texels[64];
+	for (int row = 0; row < blocksHigh; ++row) {
+		for (int column = 0; column < blocksWide; ++column, blocks += blockBytes) {
+			if (format == TEXTURE_FORMAT_BC3) {
+				decodeColorBlock(blocks + 8, true, texels);
+				decodeAlphaBlock(blocks, texels);
+			}
+			else
+				decodeColorBlock(blocks, false, texels);
+
+			for (int y = 0; y < 4 && row * 4 + y < height; ++y) {
+				int columns = std::min(4, width - column * 4);
+				std::memcpy(rgba + ((size_t)(row * 4 + y) * width + column * 4) * 4, texels + y * 16, (size_t)columns * 4);
+			}
+		}
+	}
+}
+
+std::vector<unsigned char> compressMipChain(const unsigned char* rgba, int width, int height, TextureFormat format, int threadCount) {
+	int mipLevels = mipLevelCount(width, height);
+	std::vector<unsigned char> blocks(textureChainBytes(format, width, height, mipLevels));
+	compressImage(rgba, width, height, format, blocks.data(), threadCount);
+
+	// Each level is filtered from the uncompressed one before it, not from blocks
+	std::vector<unsigned char> level(rgba, rgba + (size_t)width * height * 4), next;
+	size_t offset = textureLevelBytes(format, width, height);
+	for (int i = 1; i < mipLevels; ++i) {
+		int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+		next.resize((size_t)nextWidth * nextHeight * 4);
+		downsampleImage(level.data(), width, height, next.data(), nextWidth, nextHeight);
+		compressImage(next.data(), nextWidth, nextHeight, format, blocks.data() + offset, threadCount);
+		offset += textureLevelBytes(format, nextWidth, nextHeight);
+		level.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+	return blocks;
+}
+
+double imagePsnr(const unsigned char* a, const unsigned char* b, int width, int height) {
+	size_t values = (size_t)width * height * 4;
+	double squares = 0.0;
+	for (size_t i = 0; i < values; ++i) {
+		double delta = (double)a[i] - b[i];
+		squares += delta * delta;
+	}
+	if (squares == 0.0)
+		return std::numeric_limits<double>::infinity();
+	return 10.0 * std::log10(255.0 * 255.0 * values / squares);
+}
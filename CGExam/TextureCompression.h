@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a texture's levels are stored, in packs and on the GPU
+enum TextureFormat {
+	TEXTURE_FORMAT_RGBA8,  // 4 bytes per texel, premultiplied
+	TEXTURE_FORMAT_BC1,    // 8 bytes per 4x4 block, 1-bit punch-through alpha; opaque texels are stored unpremultiplied
+	TEXTURE_FORMAT_BC3     // 16 bytes per 4x4 block, 8-bit alpha, premultiplied
+};
+
+// Block encoders, picked at runtime from what the CPU supports; both write the same blocks
+enum BlockKernel {
+	BLOCK_KERNEL_SCALAR,
+	BLOCK_KERNEL_SSE2,
+	BLOCK_KERNEL_BEST
+};
+
+// Best kernel this CPU can run
+BlockKernel bestBlockKernel();
+
+// Printable names
+const char* blockKernelName(BlockKernel kernel);
+const char* textureFormatName(TextureFormat format);
+
+// Bytes of one level in a format, and of a level and every smaller one after it
+size_t textureLevelBytes(TextureFormat format, int width, int height);
+size_t textureChainBytes(TextureFormat format, int width, int height, int mipLevels);
+
+// BC1 when every texel is fully opaque or fully transparent, which is all a color keyed sheet has, else BC3
+TextureFormat chooseBlockFormat(const unsigned char* rgba, int width, int height);
+
+// 2x2 box filter of a premultiplied RGBA image into the next mip level; odd edges reuse the last row/column
+void downsampleImage(const unsigned char* src, int srcWidth, int srcHeight, unsigned char* dst, int dstWidth, int dstHeight);
+
+// Encode a premultiplied RGBA image into BC1 or BC3 blocks, rows of blocks split over threadCount threads.
+// Texels under half alpha become transparent in BC1. blocks must hold textureLevelBytes.
+void compressImage(const unsigned char* rgba, int width, int height, TextureFormat format, unsigned char* blocks, int threadCount,
+	BlockKernel kernel = BLOCK_KERNEL_BEST);
+
+// Decode BC1 or BC3 blocks back to premultiplied RGBA, for drivers without S3TC and for quality checks
+void decompressImage(const unsigned char* blocks, int width, int height, TextureFormat format, unsigned char* rgba);
+
+// Encode level 0 and every mip level filtered down from it into one buffer, level 0 first
+std::vector<unsigned char> compressMipChain(const unsigned char* rgba, int width, int height, TextureFormat format, int threadCount);
+
+// Peak signal to noise ratio of b against a over all four channels, in dB; infinite when they match
+double imagePsnr(const unsigned char* a, const unsigned char* b, int width, int height);
@@ -0,0 +1,166 @@
+#include "TextureLoader.h"
+#include "GLUtils.h"
+#include "Image.h"
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock LoaderClock;
+
+static double millisecondsSince(LoaderClock::time_point start) {
+	return std::chrono::duration<double, std::milli>(LoaderClock::now() - start).count();
+}
+
+int requestTexture(TextureLoader& loader, const char* filepath, const glm::vec3& colorKey, bool applyColorKey, CollisionMask* mask) {
+	TextureRequest request = { filepath, colorKey, applyColorKey, NULL, -1, 0, 0, 0, 0, TEXTURE_FORMAT_RGBA8, mask };
+	loader.requests.push_back(request);
+	return (int)loader.requests.size() - 1;
+}
+
+int requestAtlasImage(TextureLoader& loader, TextureAtlas& atlas, const char* filepath, const glm::vec3& colorKey, bool applyColorKey,
+	CollisionMask* mask) {
+	int index = reserveAtlasImage(atlas);
+	TextureRequest request = { filepath, colorKey, applyColorKey, &atlas, index, 0, 0, 0, 0, TEXTURE_FORMAT_RGBA8, mask };
+	loader.requests.push_back(request);
+	return index;
+}
+
+TextureHandle adoptLoadedTexture(TextureCache& cache, const TextureRequest& request) {
+	return adoptTexture(cache, request.filepath.c_str(), request.colorKey, request.applyColorKey, request.textureID, request.width,
+		request.height, request.mipLevels, request.format);
+}
+
+int defaultLoaderThreads() {
+	int cores = (int)std::thread::hardware_concurrency();
+	return std::max(1, cores - 1);
+}
+
+// Decode requests until none are left, publishing each into the next queue slot
+static void decodeWorker(TextureLoader& loader) {
+	for (;;) {
+		size_t next = loader.nextDecode.fetch_add(1);
+		if (next >= loader.pendingDecodes.size())
+			break;
+
+		int requestIndex = loader.pendingDecodes[next];
+		const TextureRequest& request = loader.requests[requestIndex];
+
+		LoaderClock::time_point start = LoaderClock::now();
+		int width = 0, height = 0;
+		unsigned char* pixels = loadImage(request.filepath.c_str(), request.colorKey, request.applyColorKey, width, height);
+		if (pixels && request.mask)
+			buildCollisionMask(*request.mask, pixels, width, height);
+		loader.decodeTicks += (LoaderClock::now() - start).count();
+
+		DecodedImage& slot = loader.decoded[loader.nextSlot.fetch_add(1)];
+		slot.request = requestIndex;
+		slot.pixels = pixels;
+		slot.width = width;
+		slot.height = height;
+		slot.ready.store(true, std::memory_order_release);
+	}
+}
+
+// GL thread side: upload a standalone texture or hand the pixels to its atlas
+static void deliverImage(TextureRequest& request, unsigned char* pixels, int width, int height) {
+	request.width = width;
+	request.height = height;
+	if (request.atlas) {
+		setAtlasImage(*request.atlas, request.atlasImage, pixels, width, height, true);
+		return;
+	}
+	request.textureID = pixels ? createTexture(pixels, width, height) : 0;
+	request.mipLevels = pixels ? mipLevelCount(width, height) : 0;
+	freeImage(pixels);
+}
+
+void loadTextures(TextureLoader& loader, const TexturePack& pack, int threadCount) {
+	LoaderClock::time_point start = LoaderClock::now();
+	loader.stats = TextureLoaderStats();
+	loader.stats.images = (int)loader.requests.size();
+
+	// Anything cooked needs no decode, so only the rest goes to the workers
+	std::vector<const PackedTexture*> cooked(loader.requests.size(), NULL);
+	loader.pendingDecodes.clear();
+	for (size_t i = 0; i < loader.requests.size(); ++i) {
+		const TextureRequest& request = loader.requests[i];
+		cooked[i] = findPackedTexture(pack, request.filepath.c_str(), request.colorKey, request.applyColorKey);
+		if (!cooked[i])
+			loader.pendingDecodes.push_back((int)i);
+	}
+
+	size_t decodeCount = loader.pendingDecodes.size();
+	loader.decoded.reset(new DecodedImage[decodeCount]);
+	for (size_t i = 0; i < decodeCount; ++i)
+		loader.decoded[i].ready.store(false, std::memory_order_relaxed);
+	loader.nextDecode = 0;
+	loader.nextSlot = 0;
+	loader.decodeTicks = 0;
+
+	threadCount = std::max(1, std::min(threadCount, (int)decodeCount));
+	std::vector<std::thread> workers;
+	if (decodeCount > 0) {
+		for (int i = 0; i < threadCount; ++i)
+			workers.emplace_back(decodeWorker, std::ref(loader));
+	}
+
+	// Cooked uploads overlap with the workers decoding
+	double uploadMs = 0.0;
+	for (size_t i = 0; i < loader.requests.size(); ++i) {
+		if (!cooked[i])
+			continue;
+
+		LoaderClock::time_point uploadStart = LoaderClock::now();
+		TextureRequest& request = loader.requests[i];
+		TextureFormat format = (TextureFormat)cooked[i]->format;
+		request.width = (int)cooked[i]->width;
+		request.height = (int)cooked[i]->height;
+
+		// Only the atlas and masks read the levels here. The atlas takes them as cooked; masks work on texels,
+		// so a compressed level 0 is decoded for them. freeImage releases with free.
+		if (request.mask || request.atlas) {
+			int width, height;
+			const unsigned char* data = packedMipLevel(pack, *cooked[i], 0, width, height);
+			if (request.atlas && format != TEXTURE_FORMAT_RGBA8)
+				setAtlasBlocks(*request.atlas, request.atlasImage, data, width, height, (int)cooked[i]->mipCount, format);
+			else if (request.atlas)
+				setAtlasImage(*request.atlas, request.atlasImage, data, width, height, false);
+			if (request.mask && format != TEXTURE_FORMAT_RGBA8) {
+				unsigned char* decoded = (unsigned char*)std::malloc((size_t)width * height * 4);
+				decompressImage(data, width, height, format, decoded);
+				buildCollisionMask(*request.mask, decoded, width, height);
+				freeImage(decoded);
+			}
+			else if (request.mask)
+				buildCollisionMask(*request.mask, data, width, height);
+		}
+		if (!request.atlas) {
+			request.textureID = createPackedTexture(pack, *cooked[i]);
+			request.mipLevels = (int)cooked[i]->mipCount;
+			request.format = gpuTextureFormat(format);
+		}
+		uploadMs += millisecondsSince(uploadStart);
+		loader.stats.cooked++;
+	}
+
+	// Drain the queue in the order images finish decoding
+	for (size_t consumed = 0; consumed < decodeCount; ++consumed) {
+		DecodedImage& slot = loader.decoded[consumed];
+		while (!slot.ready.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		LoaderClock::time_point uploadStart = LoaderClock::now();
+		deliverImage(loader.requests[slot.request], slot.pixels, slot.width, slot.height);
+		uploadMs += millisecondsSince(uploadStart);
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+	loader.decoded.reset();
+
+	loader.stats.threads = decodeCount > 0 ? threadCount : 0;
+	loader.stats.uploadMs = uploadMs;
+	loader.stats.decodeMs = std::chrono::duration<double, std::milli>(LoaderClock::duration(loader.decodeTicks.load())).count();
+	loader.stats.totalMs = millisecondsSince(start);
+}
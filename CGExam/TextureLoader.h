@@ -0,0 +1,70 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "CollisionMask.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "TexturePack.h"
+
+// A standalone texture or atlas sheet the loader fills in
+struct TextureRequest {
+	std::string filepath;
+	glm::vec3 colorKey;
+	bool applyColorKey;
+	TextureAtlas* atlas;  // Destination atlas, NULL for a standalone texture
+	int atlasImage;       // Index in atlas->images
+	GLuint textureID;     // Standalone texture, valid after loadTextures
+	int width, height;    // Of the image, and the mip levels and format uploaded for a standalone texture
+	int mipLevels;
+	TextureFormat format;
+	CollisionMask* mask;  // Built from the image's alpha while loading when not NULL
+};
+
+// Slot a worker publishes a decoded image into, in completion order
+struct DecodedImage {
+	std::atomic<bool> ready;
+	int request;
+	unsigned char* pixels;
+	int width, height;
+};
+
+// Timings of the last loadTextures call
+struct TextureLoaderStats {
+	int images, cooked, threads;
+	double totalMs;    // Wall time until the last upload
+	double decodeMs;   // CPU time summed over all workers
+	double uploadMs;   // GL thread time spent uploading
+};
+
+// Decodes images on a worker pool and hands them to the GL thread through a lock-free queue
+struct TextureLoader {
+	std::vector<TextureRequest> requests;
+	std::unique_ptr<DecodedImage[]> decoded;  // Queue storage, one slot per request sent to the workers
+	std::vector<int> pendingDecodes;          // Requests that weren't in the cooked pack
+	std::atomic<size_t> nextDecode;           // Next entry of pendingDecodes a worker takes
+	std::atomic<size_t> nextSlot;             // Next free queue slot
+	std::atomic<long long> decodeTicks;
+	TextureLoaderStats stats;
+};
+
+// Queue a standalone texture, returns its index in loader.requests. A mask, if given, must outlive loadTextures.
+int requestTexture(TextureLoader& loader, const char* filepath, const glm::vec3& colorKey, bool applyColorKey, CollisionMask* mask = NULL);
+
+// Queue a sheet for an atlas, returns its index in atlas.regions once the atlas is built
+int requestAtlasImage(TextureLoader& loader, TextureAtlas& atlas, const char* filepath, const glm::vec3& colorKey, bool applyColorKey,
+	CollisionMask* mask = NULL);
+
+// Load every queued request. Cooked textures come straight from the pack, the rest are decoded on
+// threadCount workers while the calling (GL) thread uploads them as they arrive. Block compressed
+// sheets are uploaded as they are; atlas sheets and masks get their level 0 decoded to RGBA.
+void loadTextures(TextureLoader& loader, const TexturePack& pack, int threadCount);
+
+// Hand a loaded standalone texture to a cache, which owns it from then on
+TextureHandle adoptLoadedTexture(TextureCache& cache, const TextureRequest& request);
+
+// Worker count matching the machine, keeping one core for the GL thread
+int defaultLoaderThreads();
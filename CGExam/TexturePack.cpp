@@ -0,0 +1,241 @@
+#include "TexturePack.h"
+#include "Image.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+std::string packTextureName(const char* filepath) {
+	std::string name(filepath);
+	size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos)
+		name = name.substr(slash + 1);
+	size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos)
+		name = name.substr(0, dot);
+	return name;
+}
+
+int mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		++levels;
+	}
+	return levels;
+}
+
+bool cookTexturePack(const std::vector<std::string>& filepaths, const std::vector<bool>& keyed, const glm::vec3& colorKey, const char* outputPath,
+	bool compress, int threadCount, std::vector<CookedTextureStats>* stats) {
+	std::vector<PackedTexture> textures;
+	std::vector<unsigned char> data;
+	size_t dataStart = sizeof(PackHeader) + filepaths.size() * sizeof(PackedTexture);
+
+	for (size_t i = 0; i < filepaths.size(); ++i) {
+		bool applyColorKey = i < keyed.size() && keyed[i];
+		int width, height;
+		unsigned char* image = loadImage(filepaths[i].c_str(), colorKey, applyColorKey, width, height);
+		if (!image)
+			return false;
+
+		PackedTexture texture;
+		std::memset(&texture, 0, sizeof(texture));
+		std::string name = packTextureName(filepaths[i].c_str());
+		std::memcpy(texture.name, name.c_str(), std::min(name.size(), sizeof(texture.name) - 1));
+		texture.colorKey[0] = static_cast<uint8_t>(colorKey.r);
+		texture.colorKey[1] = static_cast<uint8_t>(colorKey.g);
+		texture.colorKey[2] = static_cast<uint8_t>(colorKey.b);
+		texture.keyed = applyColorKey ? 1 : 0;
+		texture.width = width;
+		texture.height = height;
+		texture.mipCount = mipLevelCount(width, height);
+		texture.dataOffset = dataStart + data.size();
+
+		TextureFormat format = compress ? chooseBlockFormat(image, width, height) : TEXTURE_FORMAT_RGBA8;
+		texture.format = format;
+		CookedTextureStats cooked = { name, format, width, height, textureChainBytes(TEXTURE_FORMAT_RGBA8, width, height, texture.mipCount), 0,
+			std::numeric_limits<double>::infinity() };
+
+		if (format != TEXTURE_FORMAT_RGBA8) {
+			std::vector<unsigned char> blocks = compressMipChain(image, width, height, format, threadCount);
+			std::vector<unsigned char> decoded((size_t)width * height * 4);
+			decompressImage(blocks.data(), width, height, format, decoded.data());
+			cooked.psnr = imagePsnr(image, decoded.data(), width, height);
+			data.insert(data.end(), blocks.begin(), blocks.end());
+			freeImage(image);
+		}
+		else {
+			// Level 0 is the keyed image, each further level is filtered from the one before it
+			size_t levelOffset = data.size();
+			data.insert(data.end(), image, image + (size_t)width * height * 4);
+			freeImage(image);
+
+			int levelWidth = width, levelHeight = height;
+			for (uint32_t level = 1; level < texture.mipCount; ++level) {
+				int nextWidth = std::max(1, levelWidth / 2);
+				int nextHeight = std::max(1, levelHeight / 2);
+				size_t nextOffset = data.size();
+				data.resize(nextOffset + (size_t)nextWidth * nextHeight * 4);
+				downsampleImage(&data[levelOffset], levelWidth, levelHeight, &data[nextOffset], nextWidth, nextHeight);
+				levelOffset = nextOffset;
+				levelWidth = nextWidth;
+				levelHeight = nextHeight;
+			}
+		}
+
+		texture.dataSize = dataStart + data.size() - texture.dataOffset;
+		textures.push_back(texture);
+		if (stats) {
+			cooked.bytes = (size_t)texture.dataSize;
+			stats->push_back(cooked);
+		}
+	}
+
+	std::ofstream out(outputPath, std::ios::binary);
+	if (!out.is_open()) {
+		std::cerr << "Error Opening file " << outputPath << std::endl;
+		return false;
+	}
+
+	PackHeader header = { TEXTURE_PACK_MAGIC, TEXTURE_PACK_VERSION, (uint32_t)textures.size(), 0 };
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)textures.data(), textures.size() * sizeof(PackedTexture));
+	out.write((const char*)data.data(), data.size());
+	return out.good();
+}
+
+// Largest width or height a pack may hold, keeps level sizes well inside size_t and int
+const uint32_t PACKED_TEXTURE_MAX_SIZE = 32768;
+
+// Whether a texture's name, size and mip chain are sane and its levels lie inside the file
+static bool validPackedTexture(const TexturePack& pack, const PackedTexture& texture) {
+	if (std::memchr(texture.name, 0, sizeof(texture.name)) == NULL)
+		return false;
+	if (texture.width == 0 || texture.height == 0 || texture.width > PACKED_TEXTURE_MAX_SIZE || texture.height > PACKED_TEXTURE_MAX_SIZE)
+		return false;
+	if (texture.mipCount == 0 || texture.mipCount > (uint32_t)mipLevelCount((int)texture.width, (int)texture.height))
+		return false;
+	if (texture.dataOffset > pack.size || texture.dataSize > pack.size - texture.dataOffset || texture.format > TEXTURE_FORMAT_BC3)
+		return false;
+	// Readers, block decoders and uploads walk the whole chain from dataOffset in the texture's format
+	return texture.dataSize >= textureChainBytes((TextureFormat)texture.format, (int)texture.width, (int)texture.height, (int)texture.mipCount);
+}
+
+// Check the header and every texture
+static bool validateTexturePack(TexturePack& pack) {
+	if (pack.size < sizeof(PackHeader))
+		return false;
+
+	const PackHeader* header = (const PackHeader*)pack.data;
+	if (header->magic != TEXTURE_PACK_MAGIC || header->version != TEXTURE_PACK_VERSION)
+		return false;
+	if (sizeof(PackHeader) + (size_t)header->textureCount * sizeof(PackedTexture) > pack.size)
+		return false;
+
+	pack.textures = (const PackedTexture*)(pack.data + sizeof(PackHeader));
+	pack.textureCount = header->textureCount;
+	for (uint32_t i = 0; i < pack.textureCount; ++i) {
+		if (!validPackedTexture(pack, pack.textures[i]))
+			return false;
+	}
+	return true;
+}
+
+bool openTexturePack(TexturePack& pack, const char* filepath) {
+	std::memset(&pack, 0, sizeof(pack));
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	pack.data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	pack.size = (size_t)fileSize.QuadPart;
+	pack.fileHandle = file;
+	pack.mappingHandle = mapping;
+#else
+	int file = open(filepath, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	fstat(file, &info);
+	void* mapped = info.st_size > 0 ? mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	close(file);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	pack.data = (const unsigned char*)mapped;
+	pack.size = (size_t)info.st_size;
+#endif
+
+	if (!pack.data || !validateTexturePack(pack)) {
+		std::cerr << "Invalid or outdated texture pack, run AssetCooker again: " << filepath << std::endl;
+		closeTexturePack(pack);
+		return false;
+	}
+	return true;
+}
+
+void closeTexturePack(TexturePack& pack) {
+#ifdef _WIN32
+	if (pack.data)
+		UnmapViewOfFile(pack.data);
+	if (pack.mappingHandle)
+		CloseHandle((HANDLE)pack.mappingHandle);
+	if (pack.fileHandle)
+		CloseHandle((HANDLE)pack.fileHandle);
+#else
+	if (pack.data)
+		munmap((void*)pack.data, pack.size);
+#endif
+	std::memset(&pack, 0, sizeof(pack));
+}
+
+const PackedTexture* findPackedTexture(const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey) {
+	std::string name = packTextureName(filepath);
+	for (uint32_t i = 0; i < pack.textureCount; ++i) {
+		const PackedTexture& texture = pack.textures[i];
+		if (name != texture.name || (texture.keyed != 0) != applyColorKey)
+			continue;
+		if (applyColorKey && (texture.colorKey[0] != static_cast<uint8_t>(colorKey.r) ||
+			texture.colorKey[1] != static_cast<uint8_t>(colorKey.g) ||
+			texture.colorKey[2] != static_cast<uint8_t>(colorKey.b)))
+			continue;
+		return &texture;
+	}
+	return NULL;
+}
+
+const unsigned char* packedMipLevel(const TexturePack& pack, const PackedTexture& texture, int level, int& width, int& height) {
+	size_t offset = (size_t)texture.dataOffset;
+	width = (int)texture.width;
+	height = (int)texture.height;
+	for (int i = 0; i < level; ++i) {
+		offset += textureLevelBytes((TextureFormat)texture.format, width, height);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return pack.data + offset;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "TextureCompression.h"
+
+// Cooked texture pack: every sheet already color keyed, premultiplied and mipped, read straight from a memory map
+//
+// File layout
+//   PackHeader
+//   PackedTexture[textureCount]
+//   Mip levels in the texture's format, level 0 first, each texture's chain contiguous at dataOffset
+
+const uint32_t TEXTURE_PACK_MAGIC = 0x50544743; // "CGTP"
+const uint32_t TEXTURE_PACK_VERSION = 2;
+
+struct PackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t textureCount;
+	uint32_t reserved;
+};
+
+struct PackedTexture {
+	char name[64];          // File name without directory or extension, e.g. "LonerA"
+	uint8_t colorKey[3];
+	uint8_t keyed;
+	uint32_t width, height;
+	uint32_t mipCount;
+	uint32_t format;        // TextureFormat of every level
+	uint32_t reserved;
+	uint64_t dataOffset;    // From the start of the file
+	uint64_t dataSize;      // All mip levels
+};
+
+// Memory mapped pack opened at runtime
+struct TexturePack {
+	const unsigned char* data;
+	size_t size;
+	const PackedTexture* textures;
+	uint32_t textureCount;
+	void* fileHandle;
+	void* mappingHandle;
+};
+
+// Texture name used in packs, the file name without directory or extension
+std::string packTextureName(const char* filepath);
+
+// Number of levels in a full mip chain down to 1x1
+int mipLevelCount(int width, int height);
+
+// What cooking did to one texture
+struct CookedTextureStats {
+	std::string name;
+	TextureFormat format;
+	int width, height;
+	size_t rgbaBytes;  // The mip chain uncompressed
+	size_t bytes;      // As stored
+	double psnr;       // Level 0 decoded against the source, in dB
+};
+
+// Decode, key and mip every image, then write them into one pack file. With compress, each texture is block
+// compressed on threadCount threads, BC1 when its alpha is all on or off and BC3 otherwise.
+bool cookTexturePack(const std::vector<std::string>& filepaths, const std::vector<bool>& keyed, const glm::vec3& colorKey, const char* outputPath,
+	bool compress = false, int threadCount = 1, std::vector<CookedTextureStats>* stats = NULL);
+
+// Memory map a cooked pack, returns false if it is missing or not a valid pack
+bool openTexturePack(TexturePack& pack, const char* filepath);
+
+// Unmap a pack opened with openTexturePack
+void closeTexturePack(TexturePack& pack);
+
+// Find a cooked texture matching the source path and color key settings
+const PackedTexture* findPackedTexture(const TexturePack& pack, const char* filepath, const glm::vec3& colorKey, bool applyColorKey);
+
+// Data of one mip level of a cooked texture, in its format
+const unsigned char* packedMipLevel(const TexturePack& pack, const PackedTexture& texture, int level, int& width, int& height);
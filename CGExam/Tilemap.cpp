@@ -0,0 +1,233 @@
+#include "Tilemap.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+static const char* tilemapVertexShaderSource = "#version 330 core\n" CAMERA_BLOCK_GLSL R"(
+    layout (location = 0) in vec2 position;
+    layout (location = 1) in vec2 texCoord;
+    out vec2 TexCoord;
+    uniform vec2 scroll;
+    void main() {
+        TexCoord = texCoord;
+        gl_Position = projection * view * vec4(position - scroll, 0.0, 1.0);
+    })";
+
+static const char* tilemapFragmentShaderSource = R"(#version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoord;
+    uniform sampler2D texture1;
+    void main() {
+        FragColor = texture(texture1, TexCoord);
+    })";
+
+const int TILEMAP_CHUNK_QUADS = TILEMAP_CHUNK_TILES * TILEMAP_CHUNK_TILES;
+
+bool loadTilemapLevel(TilemapLevel& level, const char* filepath) {
+	std::ifstream in(filepath);
+	if (!in) {
+		std::cerr << "ERROR::TILEMAP::LEVEL_NOT_FOUND " << filepath << std::endl;
+		return false;
+	}
+
+	char comma;
+	if (!(in >> level.width >> comma >> level.height) || level.width <= 0 || level.height <= 0) {
+		std::cerr << "ERROR::TILEMAP::BAD_LEVEL_SIZE " << filepath << std::endl;
+		return false;
+	}
+
+	level.tiles.assign((size_t)level.width * level.height, TILE_EMPTY);
+	for (size_t i = 0; i < level.tiles.size(); ++i) {
+		int tile;
+		if (!(in >> tile)) {
+			std::cerr << "ERROR::TILEMAP::LEVEL_TRUNCATED " << filepath << std::endl;
+			return false;
+		}
+		if (tile < -1 || tile >= TILE_EMPTY) {
+			std::cerr << "ERROR::TILEMAP::BAD_TILE " << tile << " at " << i % level.width << "," << i / level.width << " in " << filepath
+				<< std::endl;
+			return false;
+		}
+		level.tiles[i] = tile < 0 ? TILE_EMPTY : (GLushort)tile;
+		in >> std::ws;
+		if (in.peek() == ',')
+			in.get();
+	}
+	return true;
+}
+
+bool initTilemap(Tilemap& map, const TilemapLevel& level, GLuint texture, int textureWidth, int textureHeight, int tilePixels,
+	float tileSize, const glm::vec2& origin) {
+	// Every tile has to name a cell of the sheet, mirrored or not
+	int sheetTiles = (textureWidth / tilePixels) * (textureHeight / tilePixels);
+	for (size_t i = 0; i < level.tiles.size(); ++i) {
+		GLushort tile = level.tiles[i];
+		if (tile != TILE_EMPTY && (tile & ~TILE_FLIP_X) >= sheetTiles) {
+			std::cerr << "ERROR::TILEMAP::TILE_OUT_OF_RANGE " << (tile & ~TILE_FLIP_X) << " at " << i % level.width << "," << i / level.width
+				<< ", the sheet has " << sheetTiles << " tiles" << std::endl;
+			return false;
+		}
+	}
+
+	if (!createShaderProgram(map.program, tilemapVertexShaderSource, tilemapFragmentShaderSource))
+		return false;
+	map.scrollLocation = uniformLocation(map.program, "scroll");
+
+	map.level = level;
+	map.texture = texture;
+	map.textureWidth = textureWidth;
+	map.textureHeight = textureHeight;
+	map.tilePixels = tilePixels;
+	map.sheetColumns = textureWidth / tilePixels;
+	map.tileSize = tileSize;
+	map.origin = origin;
+
+	map.chunksX = (level.width + TILEMAP_CHUNK_TILES - 1) / TILEMAP_CHUNK_TILES;
+	map.chunksY = (level.height + TILEMAP_CHUNK_TILES - 1) / TILEMAP_CHUNK_TILES;
+	map.chunks.assign((size_t)map.chunksX * map.chunksY, TilemapChunk());
+
+	// Every chunk draws a prefix of the same quad list
+	std::vector<GLuint> indices(TILEMAP_CHUNK_QUADS * 6);
+	for (GLuint quad = 0; quad < TILEMAP_CHUNK_QUADS; ++quad) {
+		const GLuint corners[] = { 0, 1, 2, 2, 3, 0 };
+		for (int i = 0; i < 6; ++i)
+			indices[quad * 6 + i] = quad * 4 + corners[i];
+	}
+
+	glGenVertexArrays(1, &map.VAO);
+	glGenBuffers(1, &map.EBO);
+	glBindVertexArray(map.VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, map.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glBindVertexArray(0);
+
+	map.stats = TilemapStats();
+	return true;
+}
+
+static void releaseChunk(TilemapChunk& chunk) {
+	if (chunk.VBO)
+		glDeleteBuffers(1, &chunk.VBO);
+	chunk = TilemapChunk();
+}
+
+void destroyTilemap(Tilemap& map) {
+	for (int index : map.residentChunks)
+		releaseChunk(map.chunks[index]);
+	map.residentChunks.clear();
+	glDeleteVertexArrays(1, &map.VAO);
+	glDeleteBuffers(1, &map.EBO);
+	destroyShaderProgram(map.program);
+}
+
+// Build the quads of a chunk's non-empty tiles into a static buffer
+static size_t buildChunk(Tilemap& map, int chunkX, int chunkY, TilemapChunk& chunk) {
+	std::vector<float> vertices;
+	vertices.reserve(TILEMAP_CHUNK_QUADS * 16);
+
+	// Pull the uvs half a texel in so filtering never reaches the neighbouring tile
+	float texelU = 0.5f / map.textureWidth, texelV = 0.5f / map.textureHeight;
+	float tileU = (float)map.tilePixels / map.textureWidth, tileV = (float)map.tilePixels / map.textureHeight;
+
+	for (int y = chunkY * TILEMAP_CHUNK_TILES; y < std::min((chunkY + 1) * TILEMAP_CHUNK_TILES, map.level.height); ++y) {
+		int row = map.level.height - 1 - y;
+		for (int x = chunkX * TILEMAP_CHUNK_TILES; x < std::min((chunkX + 1) * TILEMAP_CHUNK_TILES, map.level.width); ++x) {
+			GLushort tile = map.level.tiles[(size_t)row * map.level.width + x];
+			if (tile == TILE_EMPTY)
+				continue;
+
+			int index = tile & ~TILE_FLIP_X;
+			float u0 = (index % map.sheetColumns) * tileU + texelU;
+			float u1 = u0 + tileU - 2.0f * texelU;
+			float v1 = 1.0f - (index / map.sheetColumns) * tileV - texelV;  // Sheet rows count down from the top
+			float v0 = v1 - tileV + 2.0f * texelV;
+			if (tile & TILE_FLIP_X)
+				std::swap(u0, u1);
+
+			float x0 = map.origin.x + x * map.tileSize, y0 = map.origin.y + y * map.tileSize;
+			float x1 = x0 + map.tileSize, y1 = y0 + map.tileSize;
+			const float quad[] = { x0, y0, u0, v0,  x1, y0, u1, v0,  x1, y1, u1, v1,  x0, y1, u0, v1 };
+			vertices.insert(vertices.end(), quad, quad + 16);
+		}
+	}
+
+	chunk.resident = true;
+	chunk.quadCount = (int)(vertices.size() / 16);
+	if (chunk.quadCount == 0)
+		return 0;
+
+	size_t bytes = vertices.size() * sizeof(float);
+	glGenBuffers(1, &chunk.VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+	glBufferData(GL_ARRAY_BUFFER, bytes, vertices.data(), GL_STATIC_DRAW);
+	return bytes;
+}
+
+// Range of chunks overlapping [low, high] along one axis of the level, empty when last < first
+static void chunkRange(float low, float high, float origin, float chunkSize, int chunkCount, int& first, int& last) {
+	first = std::max(0, (int)std::floor((low - origin) / chunkSize));
+	last = std::min(chunkCount - 1, (int)std::floor((high - origin) / chunkSize));
+}
+
+void drawTilemap(Tilemap& map, const glm::vec2& viewMin, const glm::vec2& viewMax, const glm::vec2& scroll) {
+	map.stats = TilemapStats();
+	float chunkSize = TILEMAP_CHUNK_TILES * map.tileSize;
+
+	// Chunks seen this frame, and the ring around them that is kept built ahead of scrolling
+	int drawX0, drawX1, drawY0, drawY1, keepX0, keepX1, keepY0, keepY1;
+	chunkRange(viewMin.x + scroll.x, viewMax.x + scroll.x, map.origin.x, chunkSize, map.chunksX, drawX0, drawX1);
+	chunkRange(viewMin.y + scroll.y, viewMax.y + scroll.y, map.origin.y, chunkSize, map.chunksY, drawY0, drawY1);
+	chunkRange(viewMin.x + scroll.x - chunkSize, viewMax.x + scroll.x + chunkSize, map.origin.x, chunkSize, map.chunksX, keepX0, keepX1);
+	chunkRange(viewMin.y + scroll.y - chunkSize, viewMax.y + scroll.y + chunkSize, map.origin.y, chunkSize, map.chunksY, keepY0, keepY1);
+
+	// Drop chunks that left the ring, then build the ones that entered it
+	size_t kept = 0;
+	for (int index : map.residentChunks) {
+		int chunkX = index % map.chunksX, chunkY = index / map.chunksX;
+		if (chunkX >= keepX0 && chunkX <= keepX1 && chunkY >= keepY0 && chunkY <= keepY1)
+			map.residentChunks[kept++] = index;
+		else {
+			releaseChunk(map.chunks[index]);
+			map.stats.chunkReleases++;
+		}
+	}
+	map.residentChunks.resize(kept);
+
+	for (int chunkY = keepY0; chunkY <= keepY1; ++chunkY) {
+		for (int chunkX = keepX0; chunkX <= keepX1; ++chunkX) {
+			int index = chunkY * map.chunksX + chunkX;
+			if (map.chunks[index].resident)
+				continue;
+			map.stats.bytesUploaded += buildChunk(map, chunkX, chunkY, map.chunks[index]);
+			map.stats.chunkUploads++;
+			map.residentChunks.push_back(index);
+		}
+	}
+	map.stats.chunksResident = (int)map.residentChunks.size();
+
+	useShaderProgram(map.program);
+	glUniform2f(map.scrollLocation, scroll.x, scroll.y);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, map.texture);
+	glBindVertexArray(map.VAO);
+
+	for (int chunkY = drawY0; chunkY <= drawY1; ++chunkY) {
+		for (int chunkX = drawX0; chunkX <= drawX1; ++chunkX) {
+			const TilemapChunk& chunk = map.chunks[(size_t)chunkY * map.chunksX + chunkX];
+			if (chunk.quadCount == 0)
+				continue;
+			glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+			glDrawElements(GL_TRIANGLES, chunk.quadCount * 6, GL_UNSIGNED_INT, 0);
+			map.stats.chunksDrawn++;
+			map.stats.tilesDrawn += chunk.quadCount;
+		}
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "ShaderProgram.h"
+
+// Tiles per chunk side, a chunk is built and drawn as one piece
+const int TILEMAP_CHUNK_TILES = 16;
+
+// Tile value of an empty cell, and the bit that mirrors a tile horizontally
+const GLushort TILE_EMPTY = 0xFFFF;
+const GLushort TILE_FLIP_X = 0x8000;
+
+// A level as a grid of tile indices into the tileset, row 0 is the top
+struct TilemapLevel {
+	int width, height;
+	std::vector<GLushort> tiles;
+};
+
+// Load a level saved as text: "width,height" on the first line, then one line per row of comma separated
+// tile indices, -1 for empty and the index + 32768 for a mirrored tile
+bool loadTilemapLevel(TilemapLevel& level, const char* filepath);
+
+// GPU side of one chunk, only chunks near the camera have a vertex buffer
+struct TilemapChunk {
+	GLuint VBO;
+	int quadCount;
+	bool resident;
+};
+
+// Counters for the last drawn frame
+struct TilemapStats {
+	int chunksDrawn;
+	int chunksResident;
+	int chunkUploads;     // Chunks built this frame as they came near the camera
+	int chunkReleases;    // Chunks dropped this frame after leaving it
+	int tilesDrawn;
+	size_t bytesUploaded;
+};
+
+// A level drawn from a tileset texture. Chunks are built into static vertex buffers when they come
+// within a chunk of the camera and released once they are further away, so memory and draw cost stay
+// constant however long the level is.
+struct Tilemap {
+	ShaderProgram program;
+	GLint scrollLocation;
+	GLuint VAO, EBO;  // Index buffer for a full chunk of quads, shared by every chunk
+
+	TilemapLevel level;
+	GLuint texture;
+	int textureWidth, textureHeight, tilePixels, sheetColumns;
+	float tileSize;    // World units per tile
+	glm::vec2 origin;  // World position of the level's bottom-left corner
+
+	int chunksX, chunksY;
+	std::vector<TilemapChunk> chunks;  // Row major, chunk row 0 is the bottom
+	std::vector<int> residentChunks;   // Chunks with a built buffer, so streaming never walks the whole level
+	TilemapStats stats;
+};
+
+// Set up a tilemap for a level and a tileset of tilePixels square tiles laid out in rows from the top. Fails if a
+// tile is past the end of the sheet.
+bool initTilemap(Tilemap& map, const TilemapLevel& level, GLuint texture, int textureWidth, int textureHeight, int tilePixels,
+	float tileSize, const glm::vec2& origin);
+
+// Release every chunk and the GL objects owned by the tilemap
+void destroyTilemap(Tilemap& map);
+
+// Draw the chunks overlapping the view rect with the level moved by -scroll, streaming chunks in and out
+void drawTilemap(Tilemap& map, const glm::vec2& viewMin, const glm::vec2& viewMax, const glm::vec2& scroll);
+
+// Height of the level in world units
+inline float tilemapHeight(const Tilemap& map) {
+	return map.level.height * map.tileSize;
+}